@@ -26,6 +26,10 @@ const uint8_t CONSTANT_Fieldref = 9;
 const uint8_t CONSTANT_Methodref = 10;
 const uint8_t CONSTANT_InterfaceMethodref = 11;
 const uint8_t CONSTANT_NameAndType = 12;
+const uint8_t CONSTANT_MethodHandle = 15;
+const uint8_t CONSTANT_MethodType = 16;
+const uint8_t CONSTANT_Dynamic = 17;
+const uint8_t CONSTANT_InvokeDynamic = 18;
 
 // =======================================================================
 // 2. ESTRUTURAS DO ARQUIVO .CLASS
@@ -79,7 +83,13 @@ struct FieldInfo {
     uint16_t name_index;
     uint16_t descriptor_index;
     uint16_t attributes_count;
-    // Poderia adicionar estruturas para atributos como ConstantValue
+    uint16_t constantvalue_index; // Atributo ConstantValue (0 se ausente)
+};
+
+// Entrada do atributo BootstrapMethods (usada pelo invokedynamic)
+struct BootstrapMethod {
+    uint16_t method_ref;                  // CONSTANT_MethodHandle do método de bootstrap
+    std::vector<uint16_t> arguments;      // Argumentos estáticos (índices do CP)
 };
 
 // Estrutura Principal: O ClassFile
@@ -95,7 +105,7 @@ struct ClassFile {
     std::vector<FieldInfo> fields;
     std::vector<MethodInfo> methods;
     uint16_t attributes_count;
-    // Poderia adicionar atributos de classe (SourceFile, InnerClasses)
+    std::vector<BootstrapMethod> bootstrap_methods; // Atributo BootstrapMethods (vazio se ausente)
 };
 
 // =======================================================================
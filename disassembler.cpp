@@ -33,6 +33,13 @@ std::string resolver_indice_cp_completo(const ConstantPool& pool, uint16_t index
             s += "String \"" + get_utf8(pool, c.index1) + "\"";
         } else if (c.tag == CONSTANT_NameAndType) {
             s += "NameAndType \"" + get_utf8(pool, c.index1) + "\":" + get_utf8(pool, c.index2);
+        } else if (c.tag == CONSTANT_MethodHandle) {
+            s += "MethodHandle REF_" + std::to_string(c.index1) + " " + resolver_indice_cp_completo(pool, c.index2);
+        } else if (c.tag == CONSTANT_MethodType) {
+            s += "MethodType " + get_utf8(pool, c.index1);
+        } else if (c.tag == CONSTANT_Dynamic || c.tag == CONSTANT_InvokeDynamic) {
+            const ConstantInfo& nat = pool.at(c.index2);
+            s += "InvokeDynamic #" + std::to_string(c.index1) + ":\"" + get_utf8(pool, nat.index1) + "\":" + get_utf8(pool, nat.index2);
         } else if (c.tag == CONSTANT_Integer) {
             s += "Int " + std::to_string((int32_t)c.bytes4);
         } else if (c.tag == CONSTANT_Float) {
@@ -74,6 +81,10 @@ void exibir_constant_pool(const ConstantPool& pool) {
             case CONSTANT_Methodref: type_str = "Methodref"; value_str = "#" + std::to_string(c.index1) + ".#" + std::to_string(c.index2) + "\t// " + resolver_indice_cp_completo(pool, i); break;
             case CONSTANT_InterfaceMethodref: type_str = "InterfaceMethodref"; value_str = "#" + std::to_string(c.index1) + ".#" + std::to_string(c.index2) + "\t// " + resolver_indice_cp_completo(pool, i); break;
             case CONSTANT_NameAndType: type_str = "NameAndType"; value_str = "#" + std::to_string(c.index1) + ".#" + std::to_string(c.index2) + "\t// " + get_utf8(pool, c.index1) + ":" + get_utf8(pool, c.index2); break;
+            case CONSTANT_MethodHandle: type_str = "MethodHandle"; value_str = std::to_string(c.index1) + ":#" + std::to_string(c.index2) + "\t// " + resolver_indice_cp_completo(pool, c.index2); break;
+            case CONSTANT_MethodType: type_str = "MethodType"; value_str = "#" + std::to_string(c.index1) + "\t\t// " + get_utf8(pool, c.index1); break;
+            case CONSTANT_Dynamic: type_str = "Dynamic"; value_str = "#" + std::to_string(c.index1) + ":#" + std::to_string(c.index2) + "\t// " + resolver_indice_cp_completo(pool, i); break;
+            case CONSTANT_InvokeDynamic: type_str = "InvokeDynamic"; value_str = "#" + std::to_string(c.index1) + ":#" + std::to_string(c.index2) + "\t// " + resolver_indice_cp_completo(pool, i); break;
             case CONSTANT_Integer: type_str = "Integer"; value_str = std::to_string((int32_t)c.bytes4); break;
             case CONSTANT_Float: { float f_val; std::memcpy(&f_val, &c.bytes4, sizeof(float)); type_str = "Float"; value_str = std::to_string(f_val) + "f"; break; }
             case CONSTANT_Long: { type_str = "Long"; value_str = resolver_indice_cp_completo(pool, i); i++; break; } // Ocupa 2 slots
@@ -140,6 +151,18 @@ void exibir_methods(const ClassFile& class_data) {
     }
 }
 
+void exibir_bootstrap_methods(const ClassFile& class_data) {
+    if (class_data.bootstrap_methods.empty()) return;
+    std::cout << "\n--- BootstrapMethods (Contagem: " << class_data.bootstrap_methods.size() << ") ---" << std::endl;
+    for (size_t i = 0; i < class_data.bootstrap_methods.size(); i++) {
+        const BootstrapMethod& bsm = class_data.bootstrap_methods[i];
+        std::cout << "\t" << i << ": #" << bsm.method_ref << " \t// " << resolver_indice_cp_completo(class_data.constant_pool, bsm.method_ref) << std::endl;
+        for (uint16_t arg : bsm.arguments) {
+            std::cout << "\t\t#" << arg << " \t// " << resolver_indice_cp_completo(class_data.constant_pool, arg) << std::endl;
+        }
+    }
+}
+
 // =======================================================================
 // 2. FUNÇÃO DE DESMONTAGEM (DISASSEMBLER)
 // =======================================================================
@@ -168,7 +191,10 @@ void desmontar_bytecode(const std::vector<uint8_t>& code, const ConstantPool& po
         auto get_s4 = [&]() { 
             int32_t s_val; 
             uint32_t u_val;
-            u_val = (uint32_t)(get_u1() << 24 | get_u1() << 16 | get_u1() << 8 | get_u1());
+            u_val = (uint32_t)get_u1() << 24; // Leituras em sequência: a ordem dos operandos de '|' não é definida
+            u_val |= (uint32_t)get_u1() << 16;
+            u_val |= (uint32_t)get_u1() << 8;
+            u_val |= (uint32_t)get_u1();
             std::memcpy(&s_val, &u_val, sizeof(int32_t));
             return s_val;
         };
@@ -285,6 +311,25 @@ void desmontar_bytecode(const std::vector<uint8_t>& code, const ConstantPool& po
                 std::cout << "invokestatic #" << index << " \t// " << resolver_indice_cp_completo(pool, index) << std::endl;
                 break;
             }
+            case 0xba: // invokedynamic (dois bytes reservados, zero)
+            {
+                uint16_t index = get_u2();
+                get_u2();
+                std::cout << "invokedynamic #" << index << ", 0 \t// " << resolver_indice_cp_completo(pool, index) << std::endl;
+                break;
+            }
+            case 0xc0: // checkcast
+            {
+                uint16_t index = get_u2();
+                std::cout << "checkcast #" << index << " \t// " << resolver_indice_cp_completo(pool, index) << std::endl;
+                break;
+            }
+            case 0xc1: // instanceof
+            {
+                uint16_t index = get_u2();
+                std::cout << "instanceof #" << index << " \t// " << resolver_indice_cp_completo(pool, index) << std::endl;
+                break;
+            }
             case 0xa7: // goto
             {
                 int16_t offset_s16 = get_s2();
@@ -315,6 +360,32 @@ void desmontar_bytecode(const std::vector<uint8_t>& code, const ConstantPool& po
                 std::cout << "goto_w " << (offset + offset_s32) << std::endl; 
                 break; 
             }
+            case 0xaa: { /* tableswitch */
+                pc = (offset + 4) & ~(size_t)3; // Padding até o próximo múltiplo de 4
+                int32_t default_offset = get_s4();
+                int32_t low = get_s4();
+                int32_t high = get_s4();
+                std::cout << "tableswitch { // " << low << " a " << high << std::endl;
+                for (int64_t key = low; key <= high; key++) {
+                    int32_t target = get_s4();
+                    std::cout << "\t\t\t\t\t" << std::setw(11) << key << ": " << (offset + target) << std::endl;
+                }
+                std::cout << "\t\t\t\t\t    default: " << (offset + default_offset) << " }" << std::endl;
+                break;
+            }
+            case 0xab: { /* lookupswitch */
+                pc = (offset + 4) & ~(size_t)3;
+                int32_t default_offset = get_s4();
+                int32_t npairs = get_s4();
+                std::cout << "lookupswitch { // " << npairs << std::endl;
+                for (int32_t i = 0; i < npairs; i++) {
+                    int32_t key = get_s4();
+                    int32_t target = get_s4();
+                    std::cout << "\t\t\t\t\t" << std::setw(11) << key << ": " << (offset + target) << std::endl;
+                }
+                std::cout << "\t\t\t\t\t    default: " << (offset + default_offset) << " }" << std::endl;
+                break;
+            }
             
             default:
                 std::cout << "Opcode desconhecido: 0x" << std::hex << (int)opcode << std::dec << std::endl;
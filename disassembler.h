@@ -33,6 +33,12 @@ void exibir_fields(const ClassFile& class_data);
  */
 void exibir_methods(const ClassFile& class_data);
 
+/**
+ * @brief Exibe o atributo BootstrapMethods (métodos de bootstrap do invokedynamic).
+ * @param class_data A estrutura ClassFile completa.
+ */
+void exibir_bootstrap_methods(const ClassFile& class_data);
+
 /**
  * @brief Desmonta o bytecode de um método (opcode para mnemônico) e exibe.
  * @param code O vetor de bytes do atributo Code.
@@ -0,0 +1,1139 @@
+// gc.cpp
+
+#include "gc.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <sys/mman.h>
+
+// =======================================================================
+// 1. MAPAS DE REFERÊNCIAS (análise de fluxo do bytecode)
+// =======================================================================
+
+// Estado abstrato antes de uma instrução: um byte por slot (1: referência, 0: outro valor)
+struct EstadoFluxo {
+    std::vector<uint8_t> locais;
+    std::vector<uint8_t> pilha;
+};
+
+static inline uint16_t ler_u2(const std::vector<uint8_t>& code, uint32_t pos) {
+    return (uint16_t)((code[pos] << 8) | code[pos + 1]);
+}
+
+static inline int32_t ler_s4(const std::vector<uint8_t>& code, uint32_t pos) {
+    return (int32_t)(((uint32_t)code[pos] << 24) | ((uint32_t)code[pos + 1] << 16) |
+                     ((uint32_t)code[pos + 2] << 8) | code[pos + 3]);
+}
+
+static inline bool tipo_referencia(char type) { return type == 'L' || type == '['; }
+
+static void empilhar(EstadoFluxo& e, uint8_t ref, size_t n = 1) {
+    e.pilha.insert(e.pilha.end(), n, ref);
+}
+
+static void desempilhar(EstadoFluxo& e, size_t n) {
+    if (e.pilha.size() < n) throw std::runtime_error("GC: pilha de operandos negativa no mapa de referencias");
+    e.pilha.resize(e.pilha.size() - n);
+}
+
+// Empilha um valor do tipo 'type' (primeiro caractere de um descritor): long/double ocupam 2 slots
+static void empilhar_tipo(EstadoFluxo& e, char type) {
+    if (type == 'V') return;
+    if (type == 'J' || type == 'D') empilhar(e, 0, 2);
+    else empilhar(e, tipo_referencia(type) ? 1 : 0);
+}
+
+// dup, dup_x1, dup2_x2...: copia os 'k' slots do topo para baixo de mais 'n' slots
+static void duplicar(EstadoFluxo& e, size_t k, size_t n) {
+    if (e.pilha.size() < k + n) throw std::runtime_error("GC: dup sem operandos no mapa de referencias");
+    std::vector<uint8_t> topo(e.pilha.end() - k, e.pilha.end());
+    e.pilha.insert(e.pilha.end() - k - n, topo.begin(), topo.end());
+}
+
+static void gravar_local(EstadoFluxo& e, uint16_t index, uint8_t ref, size_t slots) {
+    if ((size_t)index + slots > e.locais.size()) throw std::runtime_error("GC: variavel local fora de max_locals");
+    for (size_t i = 0; i < slots; i++) e.locais[index + i] = ref;
+}
+
+// Descritor (campo ou método) de uma Fieldref/Methodref/InvokeDynamic: NameAndType em index2
+static std::string descritor_cp(const ConstantPool& pool, uint16_t index) {
+    return get_utf8(pool, pool.at(pool.at(index).index2).index2);
+}
+
+static void executar_invoke(EstadoFluxo& e, const ConstantPool& pool, uint16_t index, bool has_this) {
+    const std::string descriptor = descritor_cp(pool, index);
+    desempilhar(e, (size_t)contar_slots_argumentos(descriptor) + (has_this ? 1 : 0));
+    empilhar_tipo(e, tipo_retorno(descriptor));
+}
+
+// Efeito de um load/store de variável local: índice, tamanho (1 ou 2) e se é referência
+static void executar_local(EstadoFluxo& e, uint8_t opcode, uint16_t index) {
+    if (opcode >= 0x15 && opcode <= 0x19) {         // iload, lload, fload, dload, aload
+        static const uint8_t slots[] = {1, 2, 1, 2, 1};
+        if ((size_t)index + slots[opcode - 0x15] > e.locais.size()) throw std::runtime_error("GC: load fora de max_locals");
+        empilhar(e, opcode == 0x19 ? 1 : 0, slots[opcode - 0x15]);
+    } else if (opcode >= 0x36 && opcode <= 0x3a) {  // istore, lstore, fstore, dstore, astore
+        static const uint8_t slots[] = {1, 2, 1, 2, 1};
+        size_t n = slots[opcode - 0x36];
+        desempilhar(e, n);
+        gravar_local(e, index, opcode == 0x3a ? 1 : 0, n);
+    } else if (opcode != 0x84) {                    // iinc não muda tipos
+        throw std::runtime_error("GC: wide com opcode invalido");
+    }
+}
+
+/**
+ * @brief Aplica ao estado o efeito da instrução em 'pc' e acrescenta os destinos
+ * de desvio em 'destinos'.
+ * @return true se a execução pode seguir para a próxima instrução.
+ */
+static bool executar_abstrato(const RuntimeMethod& method, uint32_t pc, EstadoFluxo& e, std::vector<uint32_t>& destinos) {
+    const std::vector<uint8_t>& code = method.info->code_attribute.code;
+    const ConstantPool& pool = method.owner->class_file->constant_pool;
+    const uint8_t opcode = code[pc];
+
+    switch (opcode) {
+        case 0x00: return true;                                   // nop
+        case 0x01: empilhar(e, 1); return true;                   // aconst_null
+        case 0x02: case 0x03: case 0x04: case 0x05: case 0x06: case 0x07: case 0x08:
+        case 0x0b: case 0x0c: case 0x0d: case 0x10: case 0x11:    // iconst, fconst, bipush, sipush
+            empilhar(e, 0); return true;
+        case 0x09: case 0x0a: case 0x0e: case 0x0f: case 0x14:    // lconst, dconst, ldc2_w
+            empilhar(e, 0, 2); return true;
+        case 0x12: case 0x13: {                                   // ldc, ldc_w
+            uint16_t index = opcode == 0x12 ? code[pc + 1] : ler_u2(code, pc + 1);
+            uint8_t tag = pool.at(index).tag;
+            empilhar(e, (tag == CONSTANT_Integer || tag == CONSTANT_Float) ? 0 : 1);
+            return true;
+        }
+
+        case 0x15: case 0x16: case 0x17: case 0x18: case 0x19:    // xload
+        case 0x36: case 0x37: case 0x38: case 0x39: case 0x3a:    // xstore
+            executar_local(e, opcode, code[pc + 1]);
+            return true;
+        case 0x84: return true;                                   // iinc
+        case 0xc4:                                                // wide
+            executar_local(e, code[pc + 1], ler_u2(code, pc + 2));
+            return true;
+
+        default: break;
+    }
+
+    // Formas curtas: xload_n e xstore_n (n = 0..3), na ordem i, l, f, d, a
+    if (opcode >= 0x1a && opcode <= 0x2d) {
+        executar_local(e, (uint8_t)(0x15 + (opcode - 0x1a) / 4), (opcode - 0x1a) % 4);
+        return true;
+    }
+    if (opcode >= 0x3b && opcode <= 0x4e) {
+        executar_local(e, (uint8_t)(0x36 + (opcode - 0x3b) / 4), (opcode - 0x3b) % 4);
+        return true;
+    }
+
+    switch (opcode) {
+        // --- Arrays ---
+        case 0x2e: case 0x30: case 0x33: case 0x34: case 0x35:   // iaload, faload, baload, caload, saload
+            desempilhar(e, 2); empilhar(e, 0); return true;
+        case 0x2f: case 0x31:                                     // laload, daload
+            desempilhar(e, 2); empilhar(e, 0, 2); return true;
+        case 0x32:                                                // aaload
+            desempilhar(e, 2); empilhar(e, 1); return true;
+        case 0x4f: case 0x51: case 0x53: case 0x54: case 0x55: case 0x56:
+            desempilhar(e, 3); return true;                       // iastore, fastore, aastore, ...
+        case 0x50: case 0x52:                                     // lastore, dastore
+            desempilhar(e, 4); return true;
+
+        // --- Pilha ---
+        case 0x57: desempilhar(e, 1); return true;                // pop
+        case 0x58: desempilhar(e, 2); return true;                // pop2
+        case 0x59: duplicar(e, 1, 0); return true;                // dup
+        case 0x5a: duplicar(e, 1, 1); return true;                // dup_x1
+        case 0x5b: duplicar(e, 1, 2); return true;                // dup_x2
+        case 0x5c: duplicar(e, 2, 0); return true;                // dup2
+        case 0x5d: duplicar(e, 2, 1); return true;                // dup2_x1
+        case 0x5e: duplicar(e, 2, 2); return true;                // dup2_x2
+        case 0x5f:                                                // swap
+            if (e.pilha.size() < 2) throw std::runtime_error("GC: swap sem operandos");
+            std::swap(e.pilha[e.pilha.size() - 1], e.pilha[e.pilha.size() - 2]);
+            return true;
+
+        // --- Comparações e conversões ---
+        case 0x94: case 0x97: case 0x98: desempilhar(e, 4); empilhar(e, 0); return true; // lcmp, dcmpl, dcmpg
+        case 0x95: case 0x96: desempilhar(e, 2); empilhar(e, 0); return true;            // fcmpl, fcmpg
+        case 0x85: case 0x87: case 0x8c: case 0x8d: desempilhar(e, 1); empilhar(e, 0, 2); return true;
+        case 0x88: case 0x89: case 0x8e: case 0x90: desempilhar(e, 2); empilhar(e, 0); return true;
+        case 0x8a: case 0x8f: return true;                        // l2d, d2l
+        case 0x86: case 0x8b: case 0x91: case 0x92: case 0x93: return true; // i2f, f2i, i2b, i2c, i2s
+
+        // --- Desvios ---
+        case 0x99: case 0x9a: case 0x9b: case 0x9c: case 0x9d: case 0x9e: case 0xc6: case 0xc7:
+            desempilhar(e, 1);
+            destinos.push_back(pc + (int16_t)ler_u2(code, pc + 1));
+            return true;
+        case 0x9f: case 0xa0: case 0xa1: case 0xa2: case 0xa3: case 0xa4: case 0xa5: case 0xa6:
+            desempilhar(e, 2);
+            destinos.push_back(pc + (int16_t)ler_u2(code, pc + 1));
+            return true;
+        case 0xa7: destinos.push_back(pc + (int16_t)ler_u2(code, pc + 1)); return false; // goto
+        case 0xc8: destinos.push_back(pc + ler_s4(code, pc + 1)); return false;          // goto_w
+        case 0xa8: case 0xa9: case 0xc9:
+            throw std::runtime_error("GC: jsr/ret nao sao suportados pelo mapa de referencias");
+        case 0xaa: case 0xab: {                                   // tableswitch, lookupswitch
+            desempilhar(e, 1);
+            const SwitchTable* sw = buscar_switch(method, pc);
+            if (!sw) throw std::runtime_error("GC: switch nao compilado");
+            destinos.push_back(sw->default_target);
+            destinos.insert(destinos.end(), sw->targets.begin(), sw->targets.end());
+            return false;
+        }
+        case 0xac: case 0xad: case 0xae: case 0xaf: case 0xb0: case 0xb1: case 0xbf:
+            return false;                                         // retornos e athrow
+
+        // --- Campos e chamadas ---
+        case 0xb2: empilhar_tipo(e, descritor_cp(pool, ler_u2(code, pc + 1))[0]); return true; // getstatic
+        case 0xb3: {                                              // putstatic
+            char type = descritor_cp(pool, ler_u2(code, pc + 1))[0];
+            desempilhar(e, (type == 'J' || type == 'D') ? 2 : 1);
+            return true;
+        }
+        case 0xb4:                                                // getfield
+            desempilhar(e, 1);
+            empilhar_tipo(e, descritor_cp(pool, ler_u2(code, pc + 1))[0]);
+            return true;
+        case 0xb5: {                                              // putfield
+            char type = descritor_cp(pool, ler_u2(code, pc + 1))[0];
+            desempilhar(e, (type == 'J' || type == 'D') ? 3 : 2);
+            return true;
+        }
+        case 0xb6: case 0xb7: case 0xb9: executar_invoke(e, pool, ler_u2(code, pc + 1), true); return true;
+        case 0xb8: case 0xba: executar_invoke(e, pool, ler_u2(code, pc + 1), false); return true;
+
+        // --- Objetos ---
+        case 0xbb: empilhar(e, 1); return true;                   // new (o objeto já existe no heap)
+        case 0xbc: case 0xbd: case 0xc0: desempilhar(e, 1); empilhar(e, 1); return true;
+        case 0xbe: case 0xc1: desempilhar(e, 1); empilhar(e, 0); return true; // arraylength, instanceof
+        case 0xc2: case 0xc3: desempilhar(e, 1); return true;     // monitorenter, monitorexit
+        case 0xc5: desempilhar(e, code[pc + 3]); empilhar(e, 1); return true; // multianewarray
+
+        default: break;
+    }
+
+    // Aritmética: em cada grupo os tipos se alternam (i, l, f, d ou i, l); l e d ocupam 2 slots
+    if (opcode >= 0x60 && opcode <= 0x77) {
+        const size_t w = (opcode - 0x60) % 2 == 1 ? 2 : 1;
+        desempilhar(e, opcode >= 0x74 ? w : 2 * w);               // neg é unário
+        empilhar(e, 0, w);
+        return true;
+    }
+    if (opcode >= 0x78 && opcode <= 0x83) {
+        const size_t w = (opcode - 0x78) % 2 == 1 ? 2 : 1;
+        desempilhar(e, opcode <= 0x7d ? w + 1 : 2 * w);           // shifts: valor e um int
+        empilhar(e, 0, w);
+        return true;
+    }
+
+    throw std::runtime_error("GC: opcode invalido no mapa de referencias: " + std::to_string(opcode));
+}
+
+// Junta 'e' ao estado de 'pc': referência só onde ambos têm referência
+static void mesclar(std::vector<EstadoFluxo>& estados, std::vector<bool>& visitados,
+                    std::vector<uint32_t>& pendentes, uint32_t pc, const EstadoFluxo& e) {
+    if (pc >= estados.size()) return; // Desvio inválido: o interpretador falharia antes de chegar lá
+    if (!visitados[pc]) {
+        visitados[pc] = true;
+        estados[pc] = e;
+        pendentes.push_back(pc);
+        return;
+    }
+    EstadoFluxo& atual = estados[pc];
+    if (atual.pilha.size() != e.pilha.size()) throw std::runtime_error("GC: alturas de pilha diferentes no mesmo pc");
+    bool mudou = false;
+    for (size_t i = 0; i < atual.locais.size(); i++) {
+        if (atual.locais[i] && !e.locais[i]) { atual.locais[i] = 0; mudou = true; }
+    }
+    for (size_t i = 0; i < atual.pilha.size(); i++) {
+        if (atual.pilha[i] && !e.pilha[i]) { atual.pilha[i] = 0; mudou = true; }
+    }
+    if (mudou) pendentes.push_back(pc);
+}
+
+const MapaReferencias& mapa_referencias(RuntimeMethod& method) {
+    MapaReferencias& mapa = method.mapa_referencias;
+    if (mapa.calculado()) return mapa;
+
+    const CodeAttribute& code_attr = method.info->code_attribute;
+    const std::vector<uint8_t>& code = code_attr.code;
+    std::vector<EstadoFluxo> estados(code.size());
+    std::vector<bool> visitados(code.size(), false);
+    std::vector<uint32_t> pendentes;
+
+    // Entrada: 'this' e os argumentos nas primeiras variáveis locais
+    EstadoFluxo entrada;
+    entrada.locais.assign(code_attr.max_locals, 0);
+    size_t slot = 0;
+    if (!(method.access_flags & ACC_STATIC)) entrada.locais.at(slot++) = 1;
+    for (size_t i = 1; i < method.descriptor.size() && method.descriptor[i] != ')'; i++, slot++) {
+        char type = method.descriptor[i];
+        if (type == 'J' || type == 'D') slot++;
+        if (type == '[') {
+            while (method.descriptor[i] == '[') i++;
+            type = '[';
+        }
+        if (method.descriptor[i] == 'L') i = method.descriptor.find(';', i);
+        if (tipo_referencia(type)) entrada.locais.at(slot) = 1;
+    }
+    mesclar(estados, visitados, pendentes, 0, entrada);
+
+    std::vector<uint32_t> destinos;
+    while (!pendentes.empty()) {
+        uint32_t pc = pendentes.back();
+        pendentes.pop_back();
+
+        EstadoFluxo e = estados[pc];
+        destinos.clear();
+        bool segue = executar_abstrato(method, pc, e, destinos);
+
+        // Handlers que cobrem o pc: locais de antes e de depois da instrução, pilha só com a exceção
+        for (const auto& entry : code_attr.exception_table) {
+            if (pc < entry.start_pc || pc >= entry.end_pc) continue;
+            EstadoFluxo handler;
+            handler.pilha.assign(1, 1);
+            handler.locais = estados[pc].locais;
+            mesclar(estados, visitados, pendentes, entry.handler_pc, handler);
+            handler.locais = e.locais;
+            mesclar(estados, visitados, pendentes, entry.handler_pc, handler);
+        }
+
+        if (segue) destinos.push_back(pc + tamanho_instrucao(code, pc));
+        for (uint32_t destino : destinos) mesclar(estados, visitados, pendentes, destino, e);
+    }
+
+    // Compacta: um estado por instrução alcançável
+    mapa.indice.assign(code.size(), MAPA_SEM_ESTADO);
+    mapa.profundidade.assign(code.size(), 0);
+    for (uint32_t pc = 0; pc < code.size(); pc++) {
+        if (!visitados[pc]) continue;
+        mapa.indice[pc] = (uint32_t)mapa.slots.size();
+        mapa.profundidade[pc] = (uint16_t)estados[pc].pilha.size();
+        mapa.slots.insert(mapa.slots.end(), estados[pc].locais.begin(), estados[pc].locais.end());
+        mapa.slots.insert(mapa.slots.end(), estados[pc].pilha.begin(), estados[pc].pilha.end());
+    }
+    return mapa;
+}
+
+// =======================================================================
+// 2. ESTADO: BERÇÁRIO, BITMAPS E TABELA DE CARTÕES
+// =======================================================================
+
+// Bitmaps da geração antiga, com o mesmo formato: um bit por granule de 8 bytes e,
+// portanto, um word de 64 bits por cartão de 512 bytes
+static uint64_t* bitmap = nullptr;          // Marcados na última coleta completa
+static uint64_t* inicios = nullptr;         // Início de cada objeto (ou bloco livre) antigo
+static uint8_t* cartoes = nullptr;          // 1: o cartão tem objeto com referência ao berçário
+static std::vector<uint32_t> cartoes_sujos;
+static std::vector<RuntimeClass*> classes_sujas;
+static std::vector<jref> monitores_jovens;  // Objetos do berçário com monitor inflado
+
+static std::atomic<size_t> bercario_topo(HEAP_NURSERY_BASE); // Fim dos TLABs já entregues
+static size_t bercario_fim = HEAP_NURSERY_BASE;
+static size_t limite_grande = 0;            // Maior objeto alocado no berçário
+
+static jref livres[GC_CLASSES_PEQUENAS];    // Blocos de tamanho exato (índice: tamanho / 8)
+static jref livres_grandes = 0;             // Blocos maiores, primeiro que servir
+static std::vector<jref*> raizes_vm;
+static GcStats stats = {0, 0, 0, 0, 0, 0, 0, 0};
+
+static size_t usados = 0;                   // Bytes antigos alocados desde a última marcação, mais os vivos nela
+static size_t limite = GC_HEAP_INICIAL;     // Ocupação antiga que dispara a próxima coleta completa
+static size_t heap_inicial = GC_HEAP_INICIAL;
+static bool completa_pedida = false;        // A próxima coleta inclui a geração antiga
+static bool coletando = false;
+
+static inline bool marcado(jref ref) {
+    return (bitmap[ref >> 9] >> ((ref >> 3) & 63)) & 1;
+}
+
+static inline void registrar_inicio(size_t ref) {
+    inicios[ref >> 9] |= (uint64_t)1 << ((ref >> 3) & 63);
+}
+
+// Apaga os inícios em [de, ate)
+static void apagar_inicios(size_t de, size_t ate) {
+    size_t g = de >> 3;
+    const size_t fim = ate >> 3;
+    while (g < fim) {
+        if ((g & 63) == 0 && g + 64 <= fim) {
+            inicios[g >> 6] = 0;
+            g += 64;
+        } else {
+            inicios[g >> 6] &= ~((uint64_t)1 << (g & 63));
+            g++;
+        }
+    }
+}
+
+static void pedir_coleta(bool completa);
+
+// =======================================================================
+// 3. GERAÇÃO ANTIGA: LISTAS LIVRES E VARREDURA PREGUIÇOSA
+// =======================================================================
+
+static void empilhar_livre(size_t inicio, size_t tamanho) {
+    HeapObject& bloco = heap[(jref)inicio];
+    bloco.klass = nullptr;
+    bloco.length = (uint32_t)tamanho;
+    jref& lista = tamanho / 8 < GC_CLASSES_PEQUENAS ? livres[tamanho / 8] : livres_grandes;
+    bloco.hash = lista;
+    lista = (jref)inicio;
+    registrar_inicio(inicio);
+}
+
+// Usa os primeiros 'bytes' do bloco 'ref' (já fora das listas); a sobra volta para uma lista
+static jref usar_bloco(jref ref, size_t bytes) {
+    const size_t tamanho = heap[ref].length;
+    if (tamanho > bytes) empilhar_livre(ref + bytes, tamanho - bytes);
+    std::memset(static_cast<void*>(&heap[ref]), 0, bytes);
+    return ref;
+}
+
+// Bloco livre de 'bytes', exato ou com sobra de pelo menos um objeto mínimo (0: nenhum)
+static jref retirar_livre(size_t bytes) {
+    if (bytes / 8 < GC_CLASSES_PEQUENAS && livres[bytes / 8] != 0) {
+        jref ref = livres[bytes / 8];
+        livres[bytes / 8] = heap[ref].hash;
+        return usar_bloco(ref, bytes);
+    }
+    for (size_t t = bytes + GC_TAMANHO_MINIMO; t / 8 < GC_CLASSES_PEQUENAS; t += 8) {
+        if (livres[t / 8] == 0) continue;
+        jref ref = livres[t / 8];
+        livres[t / 8] = heap[ref].hash;
+        return usar_bloco(ref, bytes);
+    }
+    for (jref* anterior = &livres_grandes; *anterior != 0; anterior = &heap[*anterior].hash) {
+        jref ref = *anterior;
+        const size_t tamanho = heap[ref].length;
+        if (tamanho == bytes || tamanho >= bytes + GC_TAMANHO_MINIMO) {
+            *anterior = heap[ref].hash;
+            return usar_bloco(ref, bytes);
+        }
+    }
+    return 0;
+}
+
+// Faixa [cursor, fim) ainda não varrida desde a última marcação
+static size_t varredura_cursor = 0;
+static size_t varredura_fim = 0;
+
+// Sequência de mortos e livres vizinhos: vira um bloco (ou devolve o topo do heap)
+static void liberar_faixa(size_t inicio, size_t fim) {
+    apagar_inicios(inicio + 8, fim);
+    if (fim == heap.topo()) {
+        apagar_inicios(inicio, inicio + 8);
+        heap.recuar(inicio);
+    } else {
+        empilhar_livre(inicio, fim - inicio);
+    }
+}
+
+/**
+ * @brief Varre ao menos 'orcamento' bytes a partir do cursor (uma sequência de
+ * mortos em andamento vai até o fim), devolvendo os objetos não marcados às listas.
+ * @return false se não havia nada a varrer.
+ */
+static bool varrer(size_t orcamento) {
+    if (varredura_cursor >= varredura_fim) return false;
+
+    const size_t parada = varredura_cursor + std::min(orcamento, varredura_fim - varredura_cursor);
+    size_t pos = varredura_cursor;
+    size_t inicio_livre = 0;
+    bool em_faixa = false;
+    while (pos < varredura_fim) {
+        HeapObject& obj = heap[(jref)pos];
+        size_t tamanho;
+        if (obj.klass == nullptr) {
+            tamanho = obj.length; // Bloco livre de antes: junta com os vizinhos
+        } else {
+            tamanho = tamanho_objeto(obj.klass, obj.length);
+            if (marcado((jref)pos)) {
+                if (em_faixa) liberar_faixa(inicio_livre, pos);
+                em_faixa = false;
+                pos += tamanho;
+                if (pos >= parada) break;
+                continue;
+            }
+            monitor_descartar(obj.lock_word);
+        }
+        if (!em_faixa) {
+            inicio_livre = pos;
+            em_faixa = true;
+        }
+        pos += tamanho;
+    }
+    if (em_faixa) liberar_faixa(inicio_livre, pos);
+    varredura_cursor = pos;
+    return true;
+}
+
+/**
+ * @brief Espaço para um objeto antigo: promoção, objeto grande ou berçário cheio.
+ * Durante uma coleta não há varredura: os inícios lidos de um cartão continuam
+ * sendo inícios de objetos enquanto ele é percorrido.
+ */
+static jref alocar_antigo(size_t bytes) {
+    jref ref = retirar_livre(bytes);
+    while (ref == 0 && !coletando && varrer(GC_PASSO_VARREDURA)) ref = retirar_livre(bytes);
+    if (ref == 0) ref = heap.alocar(bytes);
+    registrar_inicio(ref);
+
+    usados += bytes;
+    if (usados >= limite) pedir_coleta(true);
+    return ref;
+}
+
+// =======================================================================
+// 4. TLABs
+// =======================================================================
+
+thread_local Tlab tlab_atual = {0, 0, GC_TLAB_INICIAL, 0, false};
+
+static std::mutex tlabs_lock;
+static std::vector<Tlab*> tlabs;            // TLABs de todas as threads que já alocaram
+static std::mutex lock_antiga;              // Alocação antiga pelos mutadores (caminho lento)
+
+static void registrar_tlab(Tlab& tlab) {
+    std::lock_guard<std::mutex> lock(tlabs_lock);
+    tlab.tamanho = std::min(tlab.tamanho, std::max<size_t>(GC_TLAB_MINIMO, limite_grande));
+    tlab.registrado = true;
+    tlabs.push_back(&tlab);
+}
+
+// Reserva entre 'minimo' e 'desejado' bytes do berçário com um CAS no topo compartilhado (0: cheio)
+static size_t reservar_bercario(size_t minimo, size_t desejado, size_t& inicio) {
+    size_t topo = bercario_topo.load(std::memory_order_relaxed);
+    for (;;) {
+        const size_t livre = bercario_fim - topo;
+        if (livre < minimo) return 0;
+        const size_t n = std::min(desejado, livre);
+        if (bercario_topo.compare_exchange_weak(topo, topo + n, std::memory_order_relaxed)) {
+            inicio = topo;
+            return n;
+        }
+    }
+}
+
+/**
+ * @brief Coleta menor: esvazia os TLABs (o berçário volta a ser todo livre) e
+ * ajusta o tamanho de cada um pelo número de recargas desde a coleta anterior.
+ * @return total de recargas no período.
+ */
+static uint32_t reiniciar_tlabs() {
+    const size_t maximo = std::max<size_t>(GC_TLAB_MINIMO, limite_grande);
+    uint32_t total = 0;
+    std::lock_guard<std::mutex> lock(tlabs_lock);
+    for (Tlab* tlab : tlabs) {
+        if (tlab->recargas > GC_TLAB_RECARGAS_ALVO) tlab->tamanho = std::min(tlab->tamanho * 2, maximo);
+        else if (tlab->recargas < GC_TLAB_RECARGAS_ALVO / 4) tlab->tamanho = std::max<size_t>(tlab->tamanho / 2, GC_TLAB_MINIMO);
+        total += tlab->recargas;
+        tlab->recargas = 0;
+        tlab->topo = tlab->fim = 0;
+    }
+    return total;
+}
+
+// =======================================================================
+// 5. RAÍZES E CAMPOS DE REFERÊNCIA
+// =======================================================================
+
+// Visita um slot com uma referência (0 inclusive); a coleta menor pode reescrevê-lo
+typedef void (*VisitaRef)(jref& slot);
+
+static void percorrer_frames(VisitaRef visitar) {
+    const size_t n = jvm_stack.size();
+    for (size_t i = 0; i < n; i++) {
+        Frame& frame = jvm_stack[i];
+        visitar(frame.monitor);
+
+        // O topo está parado num poll em frame.pc; os demais, no invoke (ou <clinit>) em call_pc
+        const uint32_t pc = i + 1 == n ? frame.pc : frame.call_pc;
+        const MapaReferencias& mapa = mapa_referencias(*frame.method);
+        if (pc >= mapa.indice.size() || mapa.indice[pc] == MAPA_SEM_ESTADO) {
+            throw std::runtime_error("GC: frame de " + frame.method->name + " parado fora de uma instrucao (pc " +
+                                     std::to_string(pc) + ")");
+        }
+        const uint8_t* slots = &mapa.slots[mapa.indice[pc]];
+        for (size_t l = 0; l < frame.local_variables.size(); l++) {
+            if (slots[l]) visitar(frame.local_variables[l]);
+        }
+        slots += frame.local_variables.size();
+
+        // A pilha real pode estar mais baixa que a do mapa (os argumentos do invoke já saíram), nunca mais
+        // alta: um nativo que chama bytecode (invocar_metodo_java) entrega os argumentos ao frame chamado.
+        // Um slot sem tipo no mapa seria adivinhado pelo valor, e um int seria tratado como objeto
+        const size_t profundidade = mapa.profundidade[pc];
+        if (frame.operand_stack.size() > profundidade) {
+            throw std::runtime_error("GC: frame de " + frame.method->name + " com " +
+                                     std::to_string(frame.operand_stack.size()) + " operandos acima do mapa (" +
+                                     std::to_string(profundidade) + ") no pc " + std::to_string(pc));
+        }
+        for (size_t s = 0; s < frame.operand_stack.size(); s++) {
+            if (slots[s]) visitar(frame.operand_stack[s]);
+        }
+    }
+}
+
+static void percorrer_estaticos(RuntimeClass& cls, VisitaRef visitar) {
+    for (const FieldLayout& f : cls.static_fields) {
+        if (tipo_referencia(f.type)) visitar(*reinterpret_cast<jref*>(cls.static_base() + f.offset));
+    }
+}
+
+// Frames, mirrors, raízes da VM e a exceção pendente; estáticos só se 'estaticos' (coleta completa)
+static void percorrer_raizes(VisitaRef visitar, bool estaticos) {
+    percorrer_frames(visitar);
+    for (auto& par : class_table) {
+        visitar(par.second.mirror);
+        if (estaticos) percorrer_estaticos(par.second, visitar);
+    }
+    for (jref* raiz : raizes_vm) visitar(*raiz);
+    visitar(pending_exception);
+}
+
+// Campos de referência (instâncias) ou elementos (arrays de referências) de 'obj'
+static void percorrer_campos(HeapObject& obj, VisitaRef visitar) {
+    const RuntimeClass* klass = obj.klass;
+    if (klass->layout == LAYOUT_INSTANCE) {
+        for (uint32_t offset : klass->ref_offsets) visitar(*reinterpret_cast<jref*>(obj.bytes() + offset));
+    } else if (klass->layout == LAYOUT_ARRAY && klass->element_class != nullptr) {
+        jword* elementos = obj.data();
+        for (uint32_t i = 0; i < obj.length; i++) visitar(elementos[i]);
+    }
+}
+
+// =======================================================================
+// 6. COLETA MENOR (CÓPIA DO BERÇÁRIO)
+// =======================================================================
+
+static std::vector<jref> promovidos;        // Copiados com campos ainda não atualizados
+static size_t promovidos_bytes = 0;
+
+// Copia o objeto do berçário (uma vez) para a geração antiga e reescreve o slot
+static void evacuar(jref& slot) {
+    if (!gc_no_bercario(slot)) return;
+    HeapObject& obj = heap[slot];
+    if (obj.klass == nullptr) {
+        slot = obj.hash; // Já copiado
+        return;
+    }
+    const size_t tamanho = tamanho_objeto(obj.klass, obj.length);
+    jref novo = alocar_antigo(tamanho);
+    std::memcpy(static_cast<void*>(&heap[novo]), static_cast<const void*>(&obj), tamanho);
+    obj.klass = nullptr;
+    obj.hash = novo;
+    promovidos_bytes += tamanho;
+    promovidos.push_back(novo);
+    slot = novo;
+}
+
+// Objetos antigos com cabeçalho no cartão 'c' (bits do word de inícios)
+static void percorrer_cartao(uint32_t c) {
+    uint64_t word = inicios[c];
+    while (word != 0) {
+        const size_t ref = ((size_t)c << GC_CARTAO_SHIFT) + (size_t)__builtin_ctzll(word) * 8;
+        word &= word - 1;
+        HeapObject& obj = heap[(jref)ref];
+        if (obj.klass != nullptr) percorrer_campos(obj, evacuar);
+    }
+}
+
+static void coleta_menor() {
+    const auto inicio = std::chrono::steady_clock::now();
+    promovidos_bytes = 0;
+
+    // 1. Raízes e o conjunto lembrado: estáticos das classes sujas e objetos dos cartões sujos
+    percorrer_raizes(evacuar, false);
+    for (RuntimeClass* cls : classes_sujas) {
+        cls->estaticos_sujos = false;
+        percorrer_estaticos(*cls, evacuar);
+    }
+    classes_sujas.clear();
+    for (uint32_t c : cartoes_sujos) {
+        cartoes[c] = 0;
+        percorrer_cartao(c);
+    }
+    cartoes_sujos.clear();
+
+    // 2. Os promovidos podem apontar para o berçário (nenhuma referência nova ao berçário sobra)
+    while (!promovidos.empty()) {
+        jref ref = promovidos.back();
+        promovidos.pop_back();
+        percorrer_campos(heap[ref], evacuar);
+    }
+
+    // 3. Monitores de quem morreu no berçário; os copiados levaram o seu no cabeçalho
+    for (jref ref : monitores_jovens) {
+        if (heap[ref].klass != nullptr) monitor_descartar(heap[ref].lock_word);
+    }
+    monitores_jovens.clear();
+    const size_t ocupado = bercario_topo.load(std::memory_order_relaxed) - HEAP_NURSERY_BASE;
+    const uint32_t recargas = reiniciar_tlabs();
+    bercario_topo.store(HEAP_NURSERY_BASE, std::memory_order_relaxed);
+
+    const uint64_t pausa = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - inicio).count();
+    stats.menores++;
+    stats.menores_ns += pausa;
+    if (pausa > stats.menores_max_ns) stats.menores_max_ns = pausa;
+    stats.promovidos += promovidos_bytes;
+    TRACE(TRACE_GC, TRACE_INFO, "Coleta menor {}: {} KiB no bercario ({} TLABs), {} KiB promovidos, pausa {} us",
+          stats.menores, ocupado / 1024, recargas, promovidos_bytes / 1024, pausa / 1000);
+}
+
+// =======================================================================
+// 7. MARCAÇÃO PARALELA (DEQUES DE ROUBO DE TRABALHO)
+// =======================================================================
+
+/**
+ * @brief Deque de Chase-Lev de objetos cinzas (marcados, com campos ainda não
+ * percorridos). O dono empilha e desempilha no fundo sem locks; os outros
+ * trabalhadores roubam do topo com um CAS. O buffer circular dobra quando enche;
+ * os antigos ficam até o fim da marcação (um ladrão pode estar lendo um deles).
+ */
+class DequeTrabalho {
+public:
+    DequeTrabalho() : topo_(0), fundo_(0), buffer_(nullptr) {
+        buffer_.store(novo_buffer(1024), std::memory_order_relaxed);
+    }
+
+    void empilhar(jref ref) {
+        const int64_t b = fundo_.load(std::memory_order_relaxed);
+        const int64_t t = topo_.load(std::memory_order_acquire);
+        Buffer* a = buffer_.load(std::memory_order_relaxed);
+        if (b - t > a->capacidade - 1) a = crescer(a, t, b);
+        a->slot(b).store(ref, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fundo_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Só o dono; 0: vazio
+    jref desempilhar() {
+        const int64_t b = fundo_.load(std::memory_order_relaxed) - 1;
+        Buffer* a = buffer_.load(std::memory_order_relaxed);
+        fundo_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = topo_.load(std::memory_order_relaxed);
+        if (t > b) {
+            fundo_.store(b + 1, std::memory_order_relaxed);
+            return 0;
+        }
+        jref ref = a->slot(b).load(std::memory_order_relaxed);
+        if (t == b) {
+            // Último elemento: disputa com os ladrões pelo topo
+            if (!topo_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) ref = 0;
+            fundo_.store(b + 1, std::memory_order_relaxed);
+        }
+        return ref;
+    }
+
+    // Qualquer trabalhador; 0: vazio ou perdeu a disputa
+    jref roubar() {
+        int64_t t = topo_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = fundo_.load(std::memory_order_acquire);
+        if (t >= b) return 0;
+        Buffer* a = buffer_.load(std::memory_order_acquire);
+        jref ref = a->slot(t).load(std::memory_order_relaxed);
+        if (!topo_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return 0;
+        return ref;
+    }
+
+    bool vazio() const {
+        return topo_.load(std::memory_order_acquire) >= fundo_.load(std::memory_order_acquire);
+    }
+
+    // Fim da marcação (sem ladrões): libera os buffers substituídos
+    void descartar_antigos() {
+        for (Buffer* a : antigos_) delete a;
+        antigos_.clear();
+    }
+
+private:
+    struct Buffer {
+        int64_t capacidade; // Potência de 2
+        std::unique_ptr<std::atomic<jref>[]> slots;
+        std::atomic<jref>& slot(int64_t i) { return slots[i & (capacidade - 1)]; }
+    };
+
+    static Buffer* novo_buffer(int64_t capacidade) {
+        Buffer* a = new Buffer();
+        a->capacidade = capacidade;
+        a->slots.reset(new std::atomic<jref>[capacidade]);
+        return a;
+    }
+
+    Buffer* crescer(Buffer* a, int64_t t, int64_t b) {
+        Buffer* maior = novo_buffer(a->capacidade * 2);
+        for (int64_t i = t; i < b; i++) maior->slot(i).store(a->slot(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        antigos_.push_back(a);
+        buffer_.store(maior, std::memory_order_release);
+        return maior;
+    }
+
+    std::atomic<int64_t> topo_;
+    std::atomic<int64_t> fundo_;
+    std::atomic<Buffer*> buffer_;
+    std::vector<Buffer*> antigos_;
+};
+
+struct Trabalhador {
+    DequeTrabalho cinzas;
+    size_t vivos;            // Bytes marcados por este trabalhador
+    uint32_t semente;        // Escolha das vítimas de roubo
+};
+
+// Trabalhador 0: a thread que chegou ao safepoint; os demais são as threads do pool
+static std::vector<Trabalhador*> trabalhadores;
+static thread_local Trabalhador* trabalhador_atual = nullptr;
+static std::atomic<unsigned> ociosos(0);
+static std::vector<RuntimeClass*> classes_coleta; // Raízes de classes, repartidas entre os trabalhadores
+
+// Pool: cada rodada executa tarefa(id) em todos os trabalhadores. Nunca é destruído:
+// as threads ajudantes esperam no condition_variable até o fim do processo
+struct PoolTrabalho {
+    std::mutex lock;
+    std::condition_variable inicio;
+    std::condition_variable fim;
+    void (*tarefa)(unsigned);
+    uint64_t rodada;
+    unsigned pendentes;
+};
+static PoolTrabalho* pool = nullptr;
+
+static void laco_ajudante(unsigned id) {
+    trabalhador_atual = trabalhadores[id];
+    uint64_t vista = 0;
+    for (;;) {
+        void (*tarefa)(unsigned);
+        {
+            std::unique_lock<std::mutex> lock(pool->lock);
+            pool->inicio.wait(lock, [&] { return pool->rodada != vista; });
+            vista = pool->rodada;
+            tarefa = pool->tarefa;
+        }
+        tarefa(id);
+        std::lock_guard<std::mutex> lock(pool->lock);
+        if (--pool->pendentes == 0) pool->fim.notify_one();
+    }
+}
+
+static void executar_em_paralelo(void (*tarefa)(unsigned)) {
+    const unsigned n = (unsigned)trabalhadores.size();
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        pool->tarefa = tarefa;
+        pool->pendentes = n - 1;
+        pool->rodada++;
+    }
+    pool->inicio.notify_all();
+    trabalhador_atual = trabalhadores[0];
+    tarefa(0);
+    std::unique_lock<std::mutex> lock(pool->lock);
+    pool->fim.wait(lock, [] { return pool->pendentes == 0; });
+}
+
+// Marcação atômica: dois trabalhadores podem alcançar o mesmo objeto ao mesmo tempo
+static inline bool marcar_atomico(jref ref) {
+    const uint64_t bit = (uint64_t)1 << ((ref >> 3) & 63);
+    if (__atomic_load_n(&bitmap[ref >> 9], __ATOMIC_RELAXED) & bit) return false;
+    return !(__atomic_fetch_or(&bitmap[ref >> 9], bit, __ATOMIC_RELAXED) & bit);
+}
+
+static void marcar_ref(jref& slot) {
+    const jref ref = slot;
+    if (ref == 0 || !marcar_atomico(ref)) return;
+    const HeapObject& obj = heap[ref];
+    trabalhador_atual->vivos += tamanho_objeto(obj.klass, obj.length);
+    trabalhador_atual->cinzas.empilhar(ref);
+}
+
+static jref roubar_trabalho(unsigned id) {
+    const unsigned n = (unsigned)trabalhadores.size();
+    Trabalhador& self = *trabalhadores[id];
+    for (unsigned tentativa = 0; tentativa < 2 * n; tentativa++) {
+        self.semente ^= self.semente << 13;
+        self.semente ^= self.semente >> 17;
+        self.semente ^= self.semente << 5;
+        const unsigned vitima = self.semente % n;
+        if (vitima == id) continue;
+        jref ref = trabalhadores[vitima]->cinzas.roubar();
+        if (ref != 0) return ref;
+    }
+    return 0;
+}
+
+/**
+ * @brief Terminação: o trabalhador sem trabalho fica ocioso e só volta se algum
+ * deque tiver cinzas. Como só trabalhadores ativos empilham, quando todos estão
+ * ociosos não há mais cinzas em lugar nenhum.
+ */
+static bool terminar(unsigned n) {
+    ociosos.fetch_add(1, std::memory_order_acq_rel);
+    for (;;) {
+        if (ociosos.load(std::memory_order_acquire) == n) return true;
+        for (Trabalhador* t : trabalhadores) {
+            if (!t->cinzas.vazio()) {
+                ociosos.fetch_sub(1, std::memory_order_acq_rel);
+                return false;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+static void marcar_em_paralelo(unsigned id) {
+    const unsigned n = (unsigned)trabalhadores.size();
+    Trabalhador& self = *trabalhadores[id];
+
+    // 1. Raízes: as classes repartidas; frames e raízes da VM com o trabalhador 0
+    for (size_t i = id; i < classes_coleta.size(); i += n) {
+        marcar_ref(classes_coleta[i]->mirror);
+        percorrer_estaticos(*classes_coleta[i], marcar_ref);
+    }
+    if (id == 0) {
+        percorrer_frames(marcar_ref);
+        for (jref* raiz : raizes_vm) marcar_ref(*raiz);
+        marcar_ref(pending_exception);
+    }
+
+    // 2. Fecho transitivo: os próprios cinzas primeiro, depois os dos outros
+    for (;;) {
+        jref ref;
+        while ((ref = self.cinzas.desempilhar()) != 0) percorrer_campos(heap[ref], marcar_ref);
+        ref = roubar_trabalho(id);
+        if (ref != 0) {
+            percorrer_campos(heap[ref], marcar_ref);
+            continue;
+        }
+        if (terminar(n)) return;
+    }
+}
+
+// Cria o pool na primeira coleta completa (JVM_GC_THREADS; padrão: núcleos disponíveis)
+static void preparar_trabalhadores() {
+    if (!trabalhadores.empty()) return;
+    unsigned n = std::thread::hardware_concurrency();
+    if (const char* threads = std::getenv("JVM_GC_THREADS")) n = (unsigned)std::atoi(threads);
+    n = std::max(1u, std::min(n, (unsigned)GC_MAX_TRABALHADORES));
+
+    for (unsigned id = 0; id < n; id++) {
+        Trabalhador* t = new Trabalhador();
+        t->vivos = 0;
+        t->semente = 2654435761u * (id + 1);
+        trabalhadores.push_back(t);
+    }
+    pool = new PoolTrabalho();
+    pool->tarefa = nullptr;
+    pool->rodada = 0;
+    pool->pendentes = 0;
+    for (unsigned id = 1; id < n; id++) std::thread(laco_ajudante, id).detach();
+    TRACE(TRACE_GC, TRACE_INFO, "Pool de marcacao: {} trabalhadores", n);
+}
+
+// =======================================================================
+// 8. COLETA COMPLETA (MARCAÇÃO DA GERAÇÃO ANTIGA)
+// =======================================================================
+
+// Com o berçário vazio (logo depois de uma coleta menor): só há objetos antigos
+static void coleta_antiga() {
+    const auto inicio = std::chrono::steady_clock::now();
+
+    // 1. Termina a varredura anterior: todo espaço livre volta a ser só blocos no heap
+    varrer(varredura_fim);
+    std::fill(livres, livres + GC_CLASSES_PEQUENAS, 0);
+    livres_grandes = 0;
+
+    // 2. Marcação paralela a partir das raízes
+    preparar_trabalhadores();
+    std::memset(bitmap, 0, heap.topo() / 64 + 8);
+    classes_coleta.clear();
+    for (auto& par : class_table) classes_coleta.push_back(&par.second);
+    for (Trabalhador* t : trabalhadores) t->vivos = 0;
+    ociosos.store(0, std::memory_order_relaxed);
+    executar_em_paralelo(marcar_em_paralelo);
+
+    size_t vivos = 0;
+    for (Trabalhador* t : trabalhadores) {
+        vivos += t->vivos;
+        t->cinzas.descartar_antigos();
+    }
+
+    // 3. A varredura fica para as próximas alocações antigas
+    varredura_cursor = HEAP_NULL_ZONE;
+    varredura_fim = heap.topo();
+
+    const uint64_t pausa = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - inicio).count();
+    const size_t liberados = usados > vivos ? usados - vivos : 0;
+    stats.coletas++;
+    stats.total_ns += pausa;
+    if (pausa > stats.max_ns) stats.max_ns = pausa;
+    stats.liberados += liberados;
+    TRACE(TRACE_GC, TRACE_INFO, "Coleta completa {}: {} KiB vivos, {} KiB mortos, pausa {} us",
+          stats.coletas, vivos / 1024, liberados / 1024, pausa / 1000);
+
+    usados = vivos;
+    limite = std::max(heap_inicial, vivos * GC_FATOR_CRESCIMENTO);
+}
+
+// =======================================================================
+// 9. DISPARO, ALOCAÇÃO E BARREIRAS
+// =======================================================================
+
+static void coletar(bool completa) {
+    coletando = true;
+    coleta_menor();
+    if (completa || completa_pedida || usados >= limite) {
+        coleta_antiga();
+        completa_pedida = false;
+    }
+    coletando = false;
+}
+
+static void coletar_no_safepoint(JavaThread*) {
+    coletar(false);
+}
+
+static void pedir_coleta(bool completa) {
+    if (completa) completa_pedida = true;
+    if (coletando) return;
+    JavaThread* thread = thread_atual();
+    if (thread) armar_safepoint(thread, SAFEPOINT_COLETA);
+}
+
+void gc_iniciar() {
+    // Bitmaps e cartões cobrem a geração antiga; páginas só são tocadas com o uso
+    const size_t bytes_bitmap = HEAP_NURSERY_BASE / 64;
+    void* region = mmap(nullptr, 2 * bytes_bitmap + (HEAP_NURSERY_BASE >> GC_CARTAO_SHIFT), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Falha ao reservar os bitmaps do GC");
+    }
+    bitmap = static_cast<uint64_t*>(region);
+    inicios = bitmap + bytes_bitmap / 8;
+    cartoes = reinterpret_cast<uint8_t*>(inicios + bytes_bitmap / 8);
+
+    if (const char* mb = std::getenv("JVM_GC_HEAP_MB")) {
+        heap_inicial = std::max<size_t>(1, (size_t)std::atoi(mb)) * 1024 * 1024;
+    }
+    limite = heap_inicial;
+
+    size_t bercario = GC_BERCARIO_INICIAL;
+    if (const char* mb = std::getenv("JVM_GC_NURSERY_MB")) {
+        bercario = std::min<size_t>(std::max<size_t>(1, (size_t)std::atoi(mb)) * 1024 * 1024, HEAP_NURSERY_RESERVE);
+    }
+    if (mprotect(heap.base() + HEAP_NURSERY_BASE, bercario, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Falha ao mapear o bercario do GC");
+    }
+    bercario_topo.store(HEAP_NURSERY_BASE, std::memory_order_relaxed);
+    bercario_fim = HEAP_NURSERY_BASE + bercario;
+    limite_grande = bercario / GC_FRACAO_GRANDE;
+    registrar_operacao_safepoint(SAFEPOINT_COLETA, coletar_no_safepoint);
+}
+
+void gc_coletar() {
+    coletar(true);
+}
+
+void gc_pedir_coleta() {
+    pedir_coleta(true);
+}
+
+jref gc_alocar_lento(size_t bytes) {
+    if (bytes <= limite_grande) {
+        Tlab& tlab = tlab_atual;
+        if (!tlab.registrado) registrar_tlab(tlab);
+
+        size_t inicio;
+        if (bytes <= tlab.tamanho / 2) {
+            // Recarga: o resto do TLAB atual é abandonado (no máximo metade de um TLAB)
+            size_t n = reservar_bercario(bytes, tlab.tamanho, inicio);
+            if (n != 0) {
+                std::memset(heap.base() + inicio, 0, n);
+                tlab.topo = inicio + bytes;
+                tlab.fim = inicio + n;
+                tlab.recargas++;
+                TRACE(TRACE_GC, TRACE_FINE, "Recarga de TLAB: {} KiB", (uint32_t)(n / 1024));
+                return (jref)inicio;
+            }
+        } else if (reservar_bercario(bytes, bytes, inicio) != 0) {
+            // Grande para o TLAB: direto no berçário, sem descartar o TLAB atual
+            std::memset(heap.base() + inicio, 0, bytes);
+            return (jref)inicio;
+        }
+        pedir_coleta(false); // Berçário cheio: até o safepoint, os objetos nascem antigos
+    }
+    std::lock_guard<std::mutex> lock(lock_antiga);
+    return alocar_antigo(bytes);
+}
+
+jref gc_alocar_grupo(size_t primeiro, size_t n, size_t bytes) {
+    if (bytes != 0 && n > (HEAP_NURSERY_BASE - primeiro) / bytes) {
+        throw std::runtime_error("OutOfMemoryError: espaco do heap esgotado");
+    }
+    jref ref = gc_alocar(primeiro + n * bytes);
+    if (!gc_no_bercario(ref)) {
+        // A varredura percorre o grupo objeto a objeto; os cartões acham cada um pelo bitmap de inícios
+        std::lock_guard<std::mutex> lock(lock_antiga);
+        for (size_t i = 0; i < n; i++) registrar_inicio(ref + primeiro + i * bytes);
+    }
+    return ref;
+}
+
+void gc_sujar_cartao(jref obj) {
+    const uint32_t c = obj >> GC_CARTAO_SHIFT;
+    if (cartoes[c]) return;
+    cartoes[c] = 1;
+    cartoes_sujos.push_back(c);
+}
+
+void gc_sujar_estaticos(RuntimeClass* cls) {
+    cls->estaticos_sujos = true;
+    classes_sujas.push_back(cls);
+}
+
+void gc_monitor_inflado(LockWord& lock_word) {
+    const size_t ref = (size_t)(reinterpret_cast<uint8_t*>(&lock_word) - heap.base());
+    if (ref >= HEAP_NURSERY_BASE) monitores_jovens.push_back((jref)ref);
+}
+
+void gc_registrar_raiz(jref* raiz) {
+    raizes_vm.push_back(raiz);
+}
+
+const GcStats& gc_estatisticas() {
+    return stats;
+}
+
+void gc_percorrer_vivos(VisitaObjeto visitar) {
+    coletar(true);
+
+    // A varredura da coleta ainda não começou: o bitmap separa vivos de mortos, e os blocos livres têm cabeçalho
+    const size_t fim = heap.topo();
+    size_t pos = HEAP_NULL_ZONE;
+    while (pos < fim) {
+        const HeapObject& obj = heap[(jref)pos];
+        if (obj.klass == nullptr) {
+            pos += obj.length;
+            continue;
+        }
+        const size_t tamanho = tamanho_objeto(obj.klass, obj.length);
+        if (marcado((jref)pos)) visitar(obj, tamanho);
+        pos += tamanho;
+    }
+}
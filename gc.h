@@ -0,0 +1,149 @@
+// gc.h
+
+#ifndef GC_H
+#define GC_H
+
+#include "interpreter.h"
+#include <cstdint>
+
+// =======================================================================
+// COLETOR DE LIXO GERACIONAL: BERÇÁRIO COPIADO, GERAÇÃO ANTIGA MARCADA E VARRIDA
+// =======================================================================
+
+/**
+ * Uma coleta acontece sempre num safepoint da thread (thread.h): nesse ponto as
+ * únicas referências vivas estão nos frames da jvm_stack, nos campos estáticos,
+ * nos mirrors das classes, nas raízes registradas pela VM e em 'pending_exception'.
+ * Os slots de frames são identificados pelo mapa de referências do método no pc
+ * do frame.
+ *
+ * Objetos novos nascem no berçário, no fim da reserva do heap (HEAP_NURSERY_BASE),
+ * por avanço de ponteiro no TLAB da thread (sem sincronização); só a recarga do
+ * TLAB disputa o topo do berçário, com um CAS. A coleta menor copia os alcançáveis do berçário para a
+ * geração antiga (promoção) e atualiza as referências: o custo depende só dos
+ * vivos. Além das raízes, ela percorre os objetos antigos dos cartões sujos e os
+ * estáticos das classes sujas, marcados pelas barreiras de escrita abaixo sempre
+ * que uma referência ao berçário é gravada fora dele.
+ *
+ * A geração antiga é coletada por marcação (um bit por granule de 8 bytes) e
+ * varredura preguiçosa: objetos não marcados só são devolvidos quando a
+ * alocação precisa de espaço, juntando mortos vizinhos em blocos livres. A
+ * marcação é dividida entre um pool de trabalhadores (JVM_GC_THREADS), cada um
+ * com um deque de roubo de trabalho; os bits de marcação são atômicos.
+ *
+ * Bloco livre no heap: cabeçalho com klass == nullptr, 'length' com o tamanho em
+ * bytes e 'hash' com o próximo bloco da mesma lista (0: fim). No berçário, um
+ * cabeçalho com klass == nullptr é de um objeto já copiado: 'hash' é o novo endereço.
+ */
+
+#define GC_HEAP_INICIAL        (8u * 1024 * 1024) // Ocupação antiga que dispara a primeira coleta completa (JVM_GC_HEAP_MB)
+#define GC_FATOR_CRESCIMENTO   2                  // Próxima coleta completa com a ocupação em vivos * fator
+#define GC_BERCARIO_INICIAL    (4u * 1024 * 1024) // Tamanho do berçário (JVM_GC_NURSERY_MB, até HEAP_NURSERY_RESERVE)
+#define GC_FRACAO_GRANDE       8                  // Objetos maiores que berçário / fração nascem na geração antiga
+#define GC_CLASSES_PEQUENAS    33                 // Listas exatas até 256 bytes (índice: tamanho / 8)
+#define GC_PASSO_VARREDURA     (64 * 1024)        // Bytes varridos por vez quando as listas não servem
+#define GC_TAMANHO_MINIMO      sizeof(HeapObject) // Menor objeto (e menor bloco livre)
+#define GC_MAX_TRABALHADORES   16                 // Threads da marcação paralela (JVM_GC_THREADS)
+#define GC_CARTAO_SHIFT        9                  // Cartões de 512 bytes: um word do bitmap de inícios
+#define GC_TLAB_INICIAL        (32u * 1024)       // Primeiro TLAB de cada thread
+#define GC_TLAB_MINIMO         (4u * 1024)
+#define GC_TLAB_RECARGAS_ALVO  32                 // Recargas por coleta menor que o ajuste do tamanho persegue
+
+// Pausas e memória recuperada (relatório no fim da execução)
+struct GcStats {
+    uint64_t coletas;        // Completas
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t liberados;      // Bytes de objetos antigos mortos encontrados pelas marcações
+    uint64_t menores;
+    uint64_t menores_ns;
+    uint64_t menores_max_ns;
+    uint64_t promovidos;     // Bytes copiados do berçário para a geração antiga
+};
+
+// Mapeia o berçário, os bitmaps e a tabela de cartões; lê JVM_GC_HEAP_MB e JVM_GC_NURSERY_MB
+// (depois de heap.reservar)
+void gc_iniciar();
+
+// Buffer de alocação da thread: um trecho do berçário já zerado, entregue por um CAS no topo compartilhado
+struct Tlab {
+    size_t topo;
+    size_t fim;
+    size_t tamanho;    // Próxima recarga: dobra ou cai à metade a cada coleta menor, conforme 'recargas'
+    uint32_t recargas; // Desde a última coleta menor
+    bool registrado;   // A coleta menor esvazia todos os TLABs registrados
+};
+
+extern thread_local Tlab tlab_atual;
+
+/**
+ * @brief Caminho lento de gc_alocar: recarrega o TLAB ou, para objetos grandes
+ * demais para ele, aloca direto no berçário ou na geração antiga (listas livres,
+ * varredura preguiçosa e o topo do heap). Com o berçário cheio ou a geração
+ * antiga acima do limite, pede uma coleta no próximo safepoint.
+ */
+jref gc_alocar_lento(size_t bytes);
+
+// Espaço zerado para um objeto de 'bytes' (múltiplo de 8): avanço de ponteiro no TLAB da thread
+inline jref gc_alocar(size_t bytes) {
+    Tlab& tlab = tlab_atual;
+    if (bytes <= tlab.fim - tlab.topo) {
+        jref ref = (jref)tlab.topo;
+        tlab.topo += bytes;
+        return ref;
+    }
+    return gc_alocar_lento(bytes);
+}
+
+/**
+ * @brief Espaço zerado e contíguo para um objeto de 'primeiro' bytes seguido de
+ * 'n' objetos de 'bytes' cada (multianewarray: o array de linhas e as linhas).
+ * Cada objeto do grupo continua sendo coletado individualmente.
+ */
+jref gc_alocar_grupo(size_t primeiro, size_t n, size_t bytes);
+
+// Slot da VM que guarda uma referência (exceções pré-alocadas, Strings internadas...)
+void gc_registrar_raiz(jref* raiz);
+
+// System.gc: a coleta completa acontece no próximo poll de safepoint da thread
+void gc_pedir_coleta();
+
+// Coleta completa (menor e depois a geração antiga); só com a thread parada num safepoint
+void gc_coletar();
+
+const GcStats& gc_estatisticas();
+
+// Objeto vivo encontrado por gc_percorrer_vivos, com o tamanho em bytes
+typedef void (*VisitaObjeto)(const HeapObject& obj, size_t bytes);
+
+/**
+ * @brief Coleta completa e, em seguida, visita cada objeto marcado por ela (o
+ * berçário fica vazio): histograma do heap. Só com a thread parada num safepoint.
+ */
+void gc_percorrer_vivos(VisitaObjeto visitar);
+
+// Mapa de referências de 'method' (calculado no primeiro uso)
+const MapaReferencias& mapa_referencias(RuntimeMethod& method);
+
+// Monitor inflado no cabeçalho de um objeto: se ele estiver no berçário e morrer, o Monitor é liberado
+void gc_monitor_inflado(LockWord& lock_word);
+
+// Caminhos lentos das barreiras (gc.cpp)
+void gc_sujar_cartao(jref obj);
+void gc_sujar_estaticos(RuntimeClass* cls);
+
+inline bool gc_no_bercario(jword ref) {
+    return ref >= HEAP_NURSERY_BASE;
+}
+
+// Barreira de escrita: 'valor' foi gravado num campo ou elemento de referência de 'obj'
+inline void gc_barreira(jref obj, jword valor) {
+    if (gc_no_bercario(valor) && !gc_no_bercario(obj)) gc_sujar_cartao(obj);
+}
+
+// Barreira de escrita de putstatic: 'valor' foi gravado num campo estático de referência de 'cls'
+inline void gc_barreira_estatica(RuntimeClass* cls, jword valor) {
+    if (gc_no_bercario(valor) && !cls->estaticos_sujos) gc_sujar_estaticos(cls);
+}
+
+#endif // GC_H
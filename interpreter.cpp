@@ -1,16 +1,23 @@
 // interpreter.cpp
 
 #include "interpreter.h"
-#include "disassembler.h" 
+#include "gc.h"
+#include "natives.h"
+#include "perfil.h"
+#include "printstream.h"
+#include "trace.h"
 #include <iostream>
-#include <iomanip>
 #include <vector>
 #include <stack>
 #include <stdexcept>
+#include <cstdlib>
 #include <cstring>
 #include <cmath> 
 #include <algorithm> 
 #include <sstream>
+#include <mutex>
+#include <unordered_map>
+#include <sys/mman.h>
 
 // Definir a macro ACC_STATIC se ela não estiver em classfile.h (é um flag de acesso)
 #ifndef ACC_STATIC
@@ -33,65 +40,74 @@
 // =======================================================================
 
 // Definição da Pilha de Frames e Heap
-// Definição da Pilha de Frames e Heap
-std::vector<Frame> jvm_stack;
-std::vector<HeapObject> heap; 
-std::map<std::string, ClassFile> method_area;
-
-ClassFile* get_class_from_method_area(const std::string& class_name) {
-    // 1. Verificar se já está carregada
-    auto it = method_area.find(class_name);
-    if (it != method_area.end()) {
-        return &it->second;
-    }
-    
-    // 2. Tentar carregar do disco (assumindo diretório atual e extensão .class)
-    // Para simplificar, assumimos que o nome da classe é o caminho relativo
-    std::string filename = class_name + ".class";
-    
-    // Tentativa simples de sanitizar nome (remover java/lang/ se não tivermos os arquivos do sistema)
-    // Mas para o trabalho, provavelmente teremos as classes locais usadas
-    
-    std::cout << "[Loader] Carregando classe: " << class_name << " (" << filename << ")" << std::endl;
-    
-    ClassFile new_class;
-    try {
-        ler_class_file(filename, new_class);
-        method_area[class_name] = std::move(new_class);
-        return &method_area[class_name];
-    } catch (const std::exception& e) {
-        std::cerr << "[Loader] ERRO ao carregar classe " << class_name << ": " << e.what() << std::endl;
-        return nullptr;
-    }
-} 
+PilhaJava jvm_stack;
+HeapJava heap;
 
 // Construtor do Frame 
-Frame::Frame(const MethodInfo& method, const ConstantPool& cp)
-    : pc(0), class_constant_pool(&cp) {
+Frame::Frame(RuntimeMethod& rm, jword* slots)
+    : local_variables(slots, rm.info->code_attribute.max_locals),
+      operand_stack(slots + rm.info->code_attribute.max_locals, 0), pc(0), class_constant_pool(&rm.owner->class_file->constant_pool), method(&rm), call_pc(0), instr_pc(0), monitor(0) {
 
-    const CodeAttribute& code_attr = method.code_attribute;
+    const CodeAttribute& code_attr = rm.info->code_attribute;
     
     code = &code_attr.code;
     exception_table = &code_attr.exception_table; // Inicializa a tabela
     
-    local_variables.resize(code_attr.max_locals, 0);
-    operand_stack.reserve(code_attr.max_stack);
+    std::memset(slots, 0, code_attr.max_locals * sizeof(jword));
     
-    std::cout << "\t[STACK] Novo Frame Criado. Max Locals: " << code_attr.max_locals << ", Max Stack: " << code_attr.max_stack << std::endl;
+    TRACE(TRACE_STACK, TRACE_DEBUG, "Novo Frame Criado. Max Locals: {}, Max Stack: {}",
+          code_attr.max_locals, code_attr.max_stack);
 }
 
 // Funções de Gerenciamento de Heap (Modificado)
-jref allocate_heap_object(int type, size_t size, std::string class_name) {
-    HeapObject obj;
-    obj.type = type;
-    obj.size = size; 
-    obj.data.resize(size, 0); 
-    obj.class_name = class_name; // Agora armazena o nome da classe
-    
-    std::cout << "\t[HEAP] Alocando Objeto. Tipo: " << type << ", Tamanho: " << size << ", Classe: " << class_name << std::endl;
+void HeapJava::reservar() {
+    void* region = mmap(nullptr, HEAP_RESERVE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Falha ao reservar o espaco de enderecos do heap");
+    }
+    base_ = static_cast<uint8_t*>(region);
+    topo_ = comprometido_ = HEAP_NULL_ZONE; // A zona nula nunca recebe permissão
+    registrar_zona_nula(base_, HEAP_NULL_ZONE);
+}
 
-    heap.push_back(std::move(obj));
-    return (jref)heap.size() - 1; 
+jref HeapJava::alocar(size_t bytes) {
+    bytes = (bytes + 7) & ~(size_t)7;
+    if (topo_ + bytes > comprometido_) {
+        size_t fim = (topo_ + bytes + HEAP_COMMIT_CHUNK - 1) & ~(size_t)(HEAP_COMMIT_CHUNK - 1);
+        if (fim > HEAP_NURSERY_BASE ||
+            mprotect(base_ + comprometido_, fim - comprometido_, PROT_READ | PROT_WRITE) != 0) {
+            throw std::runtime_error("OutOfMemoryError: espaco do heap esgotado");
+        }
+        comprometido_ = fim;
+    }
+    jref ref = (jref)topo_;
+    topo_ += bytes;
+    return ref;
+}
+
+void HeapJava::recuar(size_t novo_topo) {
+    std::memset(base_ + novo_topo, 0, topo_ - novo_topo);
+    topo_ = novo_topo;
+}
+
+// Inicializa o cabeçalho de um objeto numa posição já reservada e zerada
+static void iniciar_cabecalho(jref ref, RuntimeClass* klass, uint32_t length) {
+    HeapObject* obj = new (&heap[ref]) HeapObject();
+    obj->klass = klass;
+    obj->length = length;
+    obj->hash = 0;
+}
+
+// Cabeçalho e dados numa única alocação, já zerada (berçário ou geração antiga, gc.h)
+jref allocate_heap_object(RuntimeClass* klass, uint32_t length) {
+    const size_t bytes = tamanho_objeto(klass, length);
+    jref ref = gc_alocar(bytes);
+    iniciar_cabecalho(ref, klass, length);
+    perfil_alocacao(klass, bytes);
+    
+    TRACE(TRACE_HEAP, TRACE_DEBUG, "Alocando Objeto. Classe: {}, Elementos: {}, Bytes: {}",
+          klass->name, length, bytes);
+    return ref;
 }
 
 
@@ -161,117 +177,880 @@ int16_t fetch_s2(Frame& frame) {
     return s_val;
 }
 
+// Acesso a campos (instância ou estáticos) num endereço já resolvido
+
+// Lê o campo em 'addr' e empilha (extensão de sinal/zero para tipos estreitos)
+static inline void carregar_campo(Frame& frame, const uint8_t* addr, char type) {
+    switch (type) {
+        case 'J': case 'D': { int64_t v; std::memcpy(&v, addr, 8); push_jlong(frame, v); break; }
+        case 'B': push_jword(frame, (jword)(int32_t)*reinterpret_cast<const int8_t*>(addr)); break;
+        case 'Z': push_jword(frame, (jword)*addr); break;
+        case 'S': { int16_t v; std::memcpy(&v, addr, 2); push_jword(frame, (jword)(int32_t)v); break; }
+        case 'C': { uint16_t v; std::memcpy(&v, addr, 2); push_jword(frame, (jword)v); break; }
+        default:  { jword v; std::memcpy(&v, addr, 4); push_jword(frame, v); break; }
+    }
+}
+
+// Desempilha o valor (1 ou 2 slots) e grava em 'addr', truncando para o tamanho do campo
+static inline void armazenar_campo(Frame& frame, uint8_t* addr, char type) {
+    switch (type) {
+        case 'J': case 'D': { int64_t v = pop_jlong(frame); std::memcpy(addr, &v, 8); break; }
+        case 'B': *addr = (uint8_t)pop_jword(frame); break;
+        case 'Z': *addr = (uint8_t)(pop_jword(frame) & 1); break;
+        case 'S': case 'C': { uint16_t v = (uint16_t)pop_jword(frame); std::memcpy(addr, &v, 2); break; }
+        default:  { jword v = pop_jword(frame); std::memcpy(addr, &v, 4); break; }
+    }
+}
+
+// Endereço do elemento 'index' do array, na largura do seu tipo (nullptr: índice inválido, exceção já lançada)
+static inline uint8_t* endereco_elemento(Frame& frame, uint32_t pc, jref array_ref, int32_t index) {
+    HeapObject& array = heap[array_ref];
+    // null: falha na zona nula ao ler o tamanho; índice negativo vira um valor enorme
+    if ((uint32_t)index >= array.length) {
+        handle_exception(frame, pc, EXC_ARRAY_INDEX);
+        return nullptr;
+    }
+    return array.bytes() + (size_t)index * array.klass->element_size;
+}
+
+// Classes usadas com frequência pelo próprio runtime (resolvidas no primeiro uso)
+static RuntimeClass* classe_string() {
+    static RuntimeClass* cls = carregar_classe("java/lang/String");
+    return cls;
+}
+
+// Classe do array de primitivos do tipo 'atype' (código do newarray)
+static RuntimeClass* classe_array_primitiva(uint8_t atype) {
+    static const char* nomes[] = {"[Z", "[C", "[F", "[D", "[B", "[S", "[I", "[J"};
+    static RuntimeClass* classes[8] = {};
+    if (atype < T_BOOLEAN || atype > T_LONG) {
+        throw std::runtime_error("Tipo de array invalido: " + std::to_string(atype));
+    }
+    RuntimeClass*& cls = classes[atype - T_BOOLEAN];
+    if (!cls) cls = carregar_classe(nomes[atype - T_BOOLEAN]);
+    return cls;
+}
+
+/**
+ * @brief Array retangular de 'dims' dimensões com os tamanhos 'counts' (todos >= 0).
+ * As duas últimas dimensões saem de uma única alocação contígua: o array de
+ * linhas e, logo depois dele, cada linha (cabeçalho e elementos) na ordem dos
+ * índices. As dimensões acima delas apontam para esses blocos.
+ */
+static jref criar_multiarray(RuntimeClass* cls, const int32_t* counts, int dims) {
+    if (dims == 1) return allocate_heap_object(cls, (uint32_t)counts[0]);
+
+    RuntimeClass* linha_cls = cls->element_class;
+    if (dims == 2) {
+        const uint32_t linhas = (uint32_t)counts[0];
+        const size_t cabeca = tamanho_objeto(cls, linhas);
+        const size_t linha = tamanho_objeto(linha_cls, (uint32_t)counts[1]);
+        jref ref = gc_alocar_grupo(cabeca, linhas, linha);
+        iniciar_cabecalho(ref, cls, linhas);
+        for (uint32_t i = 0; i < linhas; i++) {
+            jref linha_ref = (jref)(ref + cabeca + i * linha);
+            iniciar_cabecalho(linha_ref, linha_cls, (uint32_t)counts[1]);
+            heap[ref].data()[i] = linha_ref;
+        }
+        perfil_alocacao(cls, cabeca);
+        perfil_alocacao(linha_cls, linhas * linha);
+        TRACE(TRACE_HEAP, TRACE_DEBUG, "Array retangular contiguo. Classe: {}, Linhas: {}, Bytes: {}",
+              cls->name, linhas, cabeca + linhas * linha);
+        return ref;
+    }
+
+    // Sem coleta no meio da instrução: 'ref' continua válida entre as alocações
+    jref ref = allocate_heap_object(cls, (uint32_t)counts[0]);
+    for (int32_t i = 0; i < counts[0]; i++) {
+        jref sub = criar_multiarray(linha_cls, counts + 1, dims - 1);
+        heap[ref].data()[i] = sub;
+        gc_barreira(ref, sub); // O array externo pode ter nascido antigo (grande) e o bloco no berçário
+    }
+    return ref;
+}
+
+jref criar_string(const uint16_t* chars, size_t n) {
+    const bool latin1 = std::all_of(chars, chars + n, [](uint16_t c) { return c <= 0xFF; });
+    jref ref = allocate_heap_object(classe_string(), (uint32_t)n | (latin1 ? 0 : STRING_UTF16));
+    uint8_t* dst = string_chars(heap[ref]);
+    if (latin1) {
+        for (size_t i = 0; i < n; i++) dst[i] = (uint8_t)chars[i];
+    } else {
+        std::memcpy(dst, chars, n * 2);
+    }
+    return ref;
+}
+
+// Decodifica UTF-8 (inclusive o UTF-8 modificado dos class files) em chars UTF-16
+std::vector<uint16_t> decodificar_utf8(const std::string& texto) {
+    std::vector<uint16_t> chars;
+    chars.reserve(texto.size());
+    const size_t n = texto.size();
+    for (size_t i = 0; i < n;) {
+        const uint8_t b = (uint8_t)texto[i];
+        uint32_t c;
+        if ((b & 0xE0) == 0xC0 && i + 1 < n) {
+            c = ((b & 0x1Fu) << 6) | (texto[i + 1] & 0x3Fu);
+            i += 2;
+        } else if ((b & 0xF0) == 0xE0 && i + 2 < n) {
+            c = ((b & 0x0Fu) << 12) | ((texto[i + 1] & 0x3Fu) << 6) | (texto[i + 2] & 0x3Fu);
+            i += 3;
+        } else if ((b & 0xF8) == 0xF0 && i + 3 < n) {
+            c = ((b & 0x07u) << 18) | ((texto[i + 1] & 0x3Fu) << 12) | ((texto[i + 2] & 0x3Fu) << 6) | (texto[i + 3] & 0x3Fu);
+            i += 4;
+        } else {
+            c = b; // ASCII (ou byte inválido, mantido como Latin-1)
+            i += 1;
+        }
+        if (c > 0xFFFF) {
+            c -= 0x10000;
+            chars.push_back((uint16_t)(0xD800 + (c >> 10)));
+            chars.push_back((uint16_t)(0xDC00 + (c & 0x3FF)));
+        } else {
+            chars.push_back((uint16_t)c);
+        }
+    }
+    return chars;
+}
+
+// Cria um objeto String no Heap com o conteúdo do literal (ASCII: cópia direta em Latin-1)
+jref criar_string_literal(const std::string& literal) {
+    if (std::all_of(literal.begin(), literal.end(), [](char c) { return (uint8_t)c < 0x80; })) {
+        jref ref = allocate_heap_object(classe_string(), (uint32_t)literal.size());
+        std::memcpy(string_chars(heap[ref]), literal.data(), literal.size());
+        return ref;
+    }
+    std::vector<uint16_t> chars = decodificar_utf8(literal);
+    return criar_string(chars.data(), chars.size());
+}
+
+// Strings internadas, pela chave de conteúdo: nós do unordered_map têm endereço fixo (os slots são raízes)
+static std::mutex internadas_lock;
+static std::unordered_map<std::string, jref> internadas;
+
+// Codificação e bytes dos chars: conteúdos iguais têm sempre a mesma codificação
+static std::string chave_string(HeapObject& s) {
+    std::string chave(1, string_utf16(s) ? 'U' : 'L');
+    chave.append(reinterpret_cast<const char*>(string_chars(s)), (size_t)string_length(s) * (string_utf16(s) ? 2 : 1));
+    return chave;
+}
+
+// Slot da String internada com o conteúdo de 'ref' ('ref' é registrada se o conteúdo é novo)
+static jref& slot_internado(jref ref) {
+    std::lock_guard<std::mutex> lock(internadas_lock);
+    auto it = internadas.emplace(chave_string(heap[ref]), ref);
+    if (it.second) gc_registrar_raiz(&it.first->second);
+    return it.first->second;
+}
+
+jref* internar_literal(const std::string& literal) {
+    return &slot_internado(criar_string_literal(literal));
+}
+
+jref internar_string(jref ref) {
+    return slot_internado(ref);
+}
+
+// =======================================================================
+// 2.4. MÉTODOS SYNCHRONIZED
+// =======================================================================
+
+// Objeto que representa a classe: lock dos métodos static synchronized (criado no primeiro uso)
+static jref objeto_da_classe(RuntimeClass* cls) {
+    if (cls->mirror == 0) {
+        static RuntimeClass* class_class = carregar_classe("java/lang/Class");
+        cls->mirror = allocate_heap_object(class_class);
+    }
+    return cls->mirror;
+}
+
+// Entrada de um método ACC_SYNCHRONIZED: trava 'this' (ou a classe) antes da primeira instrução
+static void adquirir_monitor_do_metodo(Frame& callee) {
+    const RuntimeMethod* method = callee.method;
+    if (!(method->access_flags & ACC_SYNCHRONIZED)) return;
+
+    jref lock = (method->access_flags & ACC_STATIC) ? objeto_da_classe(method->owner) : callee.local_variables[0];
+    monitor_enter(heap[lock].lock_word, thread_atual());
+    callee.monitor = lock;
+}
+
+/**
+ * @brief Saída de um método synchronized (retorno ou término abrupto).
+ * @return false se a thread já não possui o lock (IllegalMonitorStateException no retorno).
+ */
+static bool liberar_monitor_do_metodo(Frame& frame, JavaThread* thread) {
+    if (frame.monitor == 0) return true;
+    jref lock = frame.monitor;
+    frame.monitor = 0;
+    return monitor_exit(heap[lock].lock_word, thread);
+}
+
 // =======================================================================
 // 2.5. TRATAMENTO DE EXCEÇÕES
 // =======================================================================
 
+struct ExcecaoPreAlocada {
+    const char* class_name;
+    RuntimeClass* klass;
+    jref instance;
+};
+
+static ExcecaoPreAlocada excecoes_vm[EXC_COUNT] = {
+    {"java/lang/ArithmeticException",            nullptr, 0},
+    {"java/lang/NullPointerException",           nullptr, 0},
+    {"java/lang/ArrayIndexOutOfBoundsException", nullptr, 0},
+    {"java/lang/NegativeArraySizeException",     nullptr, 0},
+    {"java/lang/ClassCastException",             nullptr, 0},
+    {"java/lang/StackOverflowError",             nullptr, 0},
+    {"java/lang/IllegalMonitorStateException",   nullptr, 0},
+    {"java/lang/VerifyError",                    nullptr, 0},
+    {"java/lang/InternalError",                  nullptr, 0},
+};
+
+jref pending_exception = 0;
+
+// Profundidade do frame de entrada da ativação mais interna de run_frame
+static size_t activation_entry_depth = 0;
+
+// Layout das classes de sistema usadas pelos stack traces (resolvido uma vez)
+static RuntimeClass* throwable_class = nullptr;
+static RuntimeClass* error_class = nullptr;
+static RuntimeClass* stack_trace_element_class = nullptr;
+static uint32_t off_detail_message, off_cause, off_backtrace;
+static uint32_t off_ste_declaring_class, off_ste_method_name, off_ste_line_number;
+
+// Acesso a campos de 32 bits de um objeto por deslocamento (o índice no heap
+// permanece válido entre alocações; ponteiros para 'data' não)
+static inline jword ler_campo32(jref obj, uint32_t offset) {
+    jword v;
+    std::memcpy(&v, heap[obj].bytes() + offset, 4);
+    return v;
+}
+
+// A barreira de escrita vale para qualquer campo: um int no intervalo do berçário só suja o cartão à toa
+static inline void gravar_campo32(jref obj, uint32_t offset, jword v) {
+    std::memcpy(heap[obj].bytes() + offset, &v, 4);
+    gc_barreira(obj, v);
+}
+
+static void registrar_nativos_throwable();
+
+void preparar_excecoes_vm() {
+    throwable_class = carregar_classe("java/lang/Throwable");
+    error_class = carregar_classe("java/lang/Error");
+    stack_trace_element_class = carregar_classe("java/lang/StackTraceElement");
+    off_detail_message = find_field(throwable_class, "detailMessage", "Ljava/lang/String;")->offset;
+    off_cause = find_field(throwable_class, "cause", "Ljava/lang/Throwable;")->offset;
+    off_backtrace = find_field(throwable_class, "backtrace", "Ljava/lang/Object;")->offset;
+    off_ste_declaring_class = find_field(stack_trace_element_class, "declaringClass", "Ljava/lang/String;")->offset;
+    off_ste_method_name = find_field(stack_trace_element_class, "methodName", "Ljava/lang/String;")->offset;
+    off_ste_line_number = find_field(stack_trace_element_class, "lineNumber", "I")->offset;
+    registrar_nativos_throwable();
+
+    // As instâncias pré-alocadas não têm backtrace: são compartilhadas entre lançamentos
+    for (auto& e : excecoes_vm) {
+        if (e.instance != 0) continue;
+        e.klass = carregar_classe(e.class_name);
+        e.instance = allocate_heap_object(e.klass);
+        gc_registrar_raiz(&e.instance);
+    }
+}
+
 /**
- * @brief Busca um handler na Tabela de Exceções.
+ * @brief Busca um handler pelo índice de faixas do método (busca binária pelo pc
+ * da instrução que falhou) e testa os catch_types, resolvidos uma vez pelo cache do CP.
  * Se encontrar, ajusta o PC, limpa a pilha e empilha a referência da exceção.
- * Se não encontrar, lança exceção C++ para abortar (simulação simplificada).
  */
-void handle_exception(Frame& frame, const std::string& msg, const std::string& exception_class_name) {
-    std::cout << "\n\t[EXCEPTION] Ocorreu: " << msg << " (" << exception_class_name << ")" << std::endl;
-
-    // 1. Procurar na tabela de exceções
-    if (frame.exception_table) {
-        for (const auto& entry : *frame.exception_table) {
-            // Verifica se o PC atual está dentro do range [start_pc, end_pc)
-            // Nota: frame.pc já aponta para a pŕoxima instrução. O erro ocorreu na instrução anterior.
-            // Precisaríamos do PC da instrução que falhou. 
-            // Simplificação: Assumimos que o range cobre a instrução.
-            // Para simplificar, vamos verificar se o PC está "perto".
-            // O correto seria passar o PC da instrução de erro.
-            // Vamos usar (frame.pc - 1) como aproximação simples.
-            uint32_t current_pc = frame.pc - 1; 
-            
-            if (current_pc >= entry.start_pc && current_pc < entry.end_pc) {
-                // Achou um range. Verifica o tipo (catch_type).
-                // Se catch_type == 0, é finally (pega tudo).
-                // Se não, precisa resolver a classe e verificar hierarquia.
-                // Simplificação: Se catch_type != 0, assumimos que pega qualquer Exception por enquanto.
-                
-                std::cout << "\t\t-> Handler encontrado! PC: " << entry.start_pc << " -> " << entry.end_pc 
-                          << ". Pulando para Handler: " << entry.handler_pc << std::endl;
-                
-                frame.pc = entry.handler_pc;
-                frame.operand_stack.clear();
-                
-                // Deveríamos empilhar o objeto da exceção.
-                // Criar um objeto dummy para a exceção
-                jref exception_ref = allocate_heap_object(0, 1, exception_class_name); 
-                push_jword(frame, exception_ref);
-                
-                return; // Recuperado!
-            }
+static bool procurar_handler(Frame& frame, uint32_t pc, jref exception, RuntimeClass* exception_class) {
+    const ExceptionRange* range = buscar_faixa_excecao(*frame.method, pc);
+    if (!range) return false;
+
+    const auto& table = *frame.exception_table;
+    for (uint16_t i = 0; i < range->count; i++) {
+        const auto& entry = table[frame.method->exception_handlers[range->first + i]];
+
+        // catch_type == 0: finally (pega tudo)
+        if (entry.catch_type != 0 &&
+            !is_subtype_of(exception_class, resolver_classe(frame.method->owner, entry.catch_type))) {
+            continue;
         }
+
+        frame.pc = entry.handler_pc;
+        frame.operand_stack.clear();
+        push_jword(frame, exception);
+        return true; // Recuperado!
     }
-    
-    // Se não tratou, lança erro fatal
-    throw std::runtime_error("Uncaught Java Exception: " + msg);
+    return false;
+}
+
+/**
+ * @brief Desenrola a jvm_stack sem exceções C++: sem handler no frame, ele termina
+ * abruptamente e a busca continua no chamador, no pc do invoke em andamento.
+ * O frame de entrada da ativação corrente é o limite: depois dele a exceção fica
+ * pendente e o loop de run_frame termina.
+ */
+static void despachar_excecao(Frame& frame, uint32_t pc, jref exception, RuntimeClass* exception_class) {
+    Frame* current = &frame;
+    while (!procurar_handler(*current, pc, exception, exception_class)) {
+        bool entrada = jvm_stack.size() == activation_entry_depth;
+
+        TRACE(TRACE_UNWIND, TRACE_INFO, "{} sem handler em {}.{} (pc {})",
+              exception_class->name, current->method->owner->name, current->method->name, pc);
+        liberar_monitor_do_metodo(*current, thread_atual()); // Término abrupto também libera o lock
+        jvm_stack.pop_back();
+
+        if (entrada) {
+            pending_exception = exception;
+            return;
+        }
+        current = &jvm_stack.back();
+        pc = current->call_pc;
+    }
+}
+
+void lancar_excecao(Frame& frame, uint32_t pc, jref exception) {
+    despachar_excecao(frame, pc, exception, heap[exception].klass);
+}
+
+void handle_exception(Frame& frame, uint32_t pc, ExcecaoVM kind) {
+    const ExcecaoPreAlocada& e = excecoes_vm[kind];
+    despachar_excecao(frame, pc, e.instance, e.klass);
 }
 
 // =======================================================================
-// 3. EXECUÇÃO PRINCIPAL (Loop Fetch-Decode-Execute)
+// 2.5.1. STACK TRACES
 // =======================================================================
 
-void run_frame(Frame& frame) {
-    
-    // Helper para contar argumentos do descritor
-    auto count_args = [](const std::string& desc) -> int {
-        int count = 0;
-        int i = 0;
-        if (desc[i] != '(') return 0;
-        i++;
-        while (i < (int)desc.length() && desc[i] != ')') {
-            if (desc[i] == 'L') {
-                while (i < (int)desc.length() && desc[i] != ';') i++;
-                i++;
-            } else if (desc[i] == '[') {
-                while (i < (int)desc.length() && desc[i] == '[') i++;
-                if (desc[i] == 'L') {
-                    while (i < (int)desc.length() && desc[i] != ';') i++;
-                    i++;
-                } else {
-                    i++;
-                }
-            } else {
+static inline bool eh_construtor_throwable(const RuntimeMethod* m) {
+    return m->name == "<init>" && is_subtype_of(m->owner, throwable_class);
+}
+
+/**
+ * @brief Registra no Throwable apenas pares (id do método, pc) dos frames ativos,
+ * num int[]. Nenhuma string é montada aqui. Os frames dos construtores da própria
+ * exceção são omitidos (o trace começa em quem a criou).
+ */
+static void preencher_backtrace(jref throwable) {
+    size_t top = jvm_stack.size();
+    while (top > 1 && eh_construtor_throwable(jvm_stack[top - 1].method)) top--;
+
+    jref trace = allocate_heap_object(classe_array_primitiva(T_INT), (uint32_t)(top * 2));
+    jword* pares = heap[trace].data();
+    for (size_t i = 0; i < top; i++) {
+        const Frame& f = jvm_stack[top - 1 - i];
+        pares[2 * i] = f.method->id;
+        pares[2 * i + 1] = f.call_pc;
+    }
+    gravar_campo32(throwable, off_backtrace, trace);
+}
+
+// Cria uma exceção da JVM que não é pré-alocada (erros de inicialização de classes)
+jref criar_excecao(const char* class_name, const std::string& message, jref cause) {
+    RuntimeClass* cls = carregar_classe(class_name);
+    jref ex = allocate_heap_object(cls);
+    if (!message.empty()) gravar_campo32(ex, off_detail_message, criar_string_literal(message));
+    gravar_campo32(ex, off_cause, cause);
+    preencher_backtrace(ex);
+    return ex;
+}
+
+static std::string nome_java(const std::string& internal_name) {
+    std::string name = internal_name;
+    std::replace(name.begin(), name.end(), '/', '.');
+    return name;
+}
+
+std::string texto_string(jref string_ref) {
+    HeapObject& s = heap[string_ref];
+    const uint32_t n = string_length(s);
+    std::string text;
+    text.reserve(n);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t c = string_char_at(s, i);
+        // Par de surrogates: um único code point de 4 bytes
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < n) {
+            uint32_t baixo = string_char_at(s, i + 1);
+            if (baixo >= 0xDC00 && baixo < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (baixo - 0xDC00);
                 i++;
             }
-            count++;
         }
-        return count;
-    };
+        if (c < 0x80) {
+            text += (char)c;
+        } else if (c < 0x800) {
+            text += (char)(0xC0 | (c >> 6));
+            text += (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            text += (char)(0xE0 | (c >> 12));
+            text += (char)(0x80 | ((c >> 6) & 0x3F));
+            text += (char)(0x80 | (c & 0x3F));
+        } else {
+            text += (char)(0xF0 | (c >> 18));
+            text += (char)(0x80 | ((c >> 12) & 0x3F));
+            text += (char)(0x80 | ((c >> 6) & 0x3F));
+            text += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return text;
+}
+
+/**
+ * @brief Materializa o stack trace no formato do Throwable.printStackTrace:
+ * as linhas só são montadas aqui, a partir dos pares (método, pc), seguidas
+ * das causas encadeadas.
+ */
+static void imprimir_stack_trace(FluxoSaida& fluxo, jref throwable) {
+    std::ostringstream out;
+    for (int depth = 0; throwable != 0 && depth < 64; depth++) {
+        if (depth > 0) out << "Caused by: ";
+        out << nome_java(heap[throwable].klass->name);
+        jref message = ler_campo32(throwable, off_detail_message);
+        if (message != 0) out << ": " << texto_string(message);
+        out << "\n";
+
+        jref trace = ler_campo32(throwable, off_backtrace);
+        if (trace != 0) {
+            const jword* pares = heap[trace].data();
+            for (uint32_t i = 0; i + 1 < heap[trace].length; i += 2) {
+                const RuntimeMethod* m = method_registry[pares[i]];
+                out << "\tat " << nome_java(m->owner->name) << "." << m->name << "(pc " << pares[i + 1] << ")\n";
+            }
+        }
+
+        jref cause = ler_campo32(throwable, off_cause);
+        throwable = (cause == throwable) ? 0 : cause;
+    }
+    const std::string text = out.str();
+    fluxo_escrever(fluxo, text.data(), text.size());
+    fluxo_flush(fluxo);
+}
+
+// Throwable.getStackTrace: cria os StackTraceElement (e suas Strings) sob demanda
+static jref materializar_stack_trace(jref throwable) {
+    jref trace = ler_campo32(throwable, off_backtrace);
+    uint32_t count = trace != 0 ? heap[trace].length / 2 : 0;
+
+    jref array_ref = allocate_heap_object(classe_array(stack_trace_element_class), count);
+    for (uint32_t i = 0; i < count; i++) {
+        const RuntimeMethod* m = method_registry[heap[trace].data()[2 * i]];
+
+        jref element = allocate_heap_object(stack_trace_element_class);
+        gravar_campo32(element, off_ste_declaring_class, criar_string_literal(nome_java(m->owner->name)));
+        gravar_campo32(element, off_ste_method_name, criar_string_literal(m->name));
+        gravar_campo32(element, off_ste_line_number, (jword)-1); // Sem LineNumberTable
+        heap[array_ref].data()[i] = element;
+        gc_barreira(array_ref, element);
+    }
+    return array_ref;
+}
+
+// Construtores de Throwable: mensagem, causa e o backtrace compacto
+static void construir_throwable(Frame& frame, jref message, jref cause) {
+    jref self = pop_jword(frame);
+    gravar_campo32(self, off_detail_message, message);
+    gravar_campo32(self, off_cause, cause);
+    preencher_backtrace(self);
+}
+
+static void ler_campo_nativo(Frame& frame, uint32_t offset) {
+    jref self = pop_jword(frame);
+    push_jword(frame, ler_campo32(self, offset));
+}
+
+// Nativos de Throwable e StackTraceElement, registrados junto dos nativos embutidos
+static void registrar_nativos_throwable() {
+    const char* t = "java/lang/Throwable";
+    registrar_nativo(t, "<init>", "()V", [](Frame& f, uint32_t) { construir_throwable(f, 0, 0); });
+    registrar_nativo(t, "<init>", "(Ljava/lang/String;)V", [](Frame& f, uint32_t) {
+        jref message = pop_jword(f);
+        construir_throwable(f, message, 0);
+    });
+    registrar_nativo(t, "<init>", "(Ljava/lang/String;Ljava/lang/Throwable;)V", [](Frame& f, uint32_t) {
+        jref cause = pop_jword(f);
+        jref message = pop_jword(f);
+        construir_throwable(f, message, cause);
+    });
+    registrar_nativo(t, "<init>", "(Ljava/lang/Throwable;)V", [](Frame& f, uint32_t) {
+        jref cause = pop_jword(f);
+        construir_throwable(f, 0, cause);
+    });
+    registrar_nativo(t, "getMessage", "()Ljava/lang/String;", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_detail_message); });
+    registrar_nativo(t, "getLocalizedMessage", "()Ljava/lang/String;", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_detail_message); });
+    registrar_nativo(t, "getCause", "()Ljava/lang/Throwable;", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_cause); });
+    registrar_nativo(t, "fillInStackTrace", "()Ljava/lang/Throwable;", [](Frame& f, uint32_t) {
+        jref self = pop_jword(f);
+        preencher_backtrace(self);
+        push_jword(f, self);
+    });
+    registrar_nativo(t, "printStackTrace", "()V", [](Frame& f, uint32_t) { imprimir_stack_trace(fluxo_saida(2), pop_jword(f)); });
+    registrar_nativo(t, "getStackTrace", "()[Ljava/lang/StackTraceElement;", [](Frame& f, uint32_t) {
+        jref self = pop_jword(f);
+        push_jword(f, materializar_stack_trace(self));
+    });
+
+    const char* ste = "java/lang/StackTraceElement";
+    registrar_nativo(ste, "getClassName", "()Ljava/lang/String;", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_ste_declaring_class); });
+    registrar_nativo(ste, "getMethodName", "()Ljava/lang/String;", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_ste_method_name); });
+    registrar_nativo(ste, "getLineNumber", "()I", [](Frame& f, uint32_t) { ler_campo_nativo(f, off_ste_line_number); });
+}
+
+// =======================================================================
+// 2.6. INVOCAÇÃO DE MÉTODOS
+// =======================================================================
+
+// Métodos de classes de sistema (sem bytecode): consome os argumentos e empilha um retorno padrão
+static void simular_metodo_sistema(Frame& frame, const RuntimeMethod* method, bool has_this) {
+    int slots = method->arg_slots + (has_this ? 1 : 0);
+    for (int i = 0; i < slots; i++) pop_jword(frame);
+
+    if (method->return_type == 'J' || method->return_type == 'D') {
+        push_jlong(frame, 0);
+    } else if (method->return_type != 'V') {
+        push_jword(frame, 0);
+    }
+}
+
+/**
+ * @brief Chamada a um método sem bytecode: executa o nativo ligado na criação do
+ * método (uma chamada direta) ou, sem nativo, simula o método consumindo os argumentos.
+ */
+static void invocar_metodo_sistema(Frame& caller, uint32_t pc, const RuntimeMethod* method, bool has_this) {
+    caller.call_pc = pc;
+
+    if (has_this && method->name[0] != '<') {
+        size_t receiver = caller.operand_stack.size() - 1 - (size_t)method->arg_slots;
+        if (receiver < caller.operand_stack.size() && caller.operand_stack[receiver] == 0) {
+            handle_exception(caller, pc, EXC_NULL_POINTER);
+            return;
+        }
+    }
+
+    if (method->native) {
+        method->native(caller, pc);
+    } else if (method->access_flags & ACC_NATIVE) {
+        lancar_excecao(caller, pc, criar_excecao("java/lang/UnsatisfiedLinkError",
+                                                 method->owner->name + "." + method->name + method->descriptor, 0));
+    } else {
+        simular_metodo_sistema(caller, method, has_this);
+    }
+}
+
+/**
+ * @brief Empilha o Frame do método chamado na jvm_stack, movendo os argumentos
+ * (e o 'this') da pilha de operandos do chamador para as variáveis locais.
+ * O loop de run_frame continua a partir do novo topo da jvm_stack.
+ * O pc do invoke fica no chamador: é onde a busca de handlers continua se o
+ * chamado terminar com uma exceção.
+ */
+static void invocar_metodo(Frame& caller, uint32_t pc, RuntimeMethod* method, bool has_this) {
+    if (!method->has_code()) {
+        invocar_metodo_sistema(caller, pc, method, has_this);
+        return;
+    }
+    caller.call_pc = pc;
+
+    size_t slots = (size_t)method->arg_slots + (has_this ? 1 : 0);
+    if (caller.operand_stack.size() < slots) {
+        throw std::runtime_error("Stack Underflow em invoke: " + method->name);
+    }
+
+    // Sem verificação de profundidade: o estouro cai na zona amarela (ver run_frame)
+    Frame& callee = jvm_stack.emplace_back(*method); // 'caller' continua válido: a jvm_stack não é realocada
+
+    std::copy(caller.operand_stack.end() - slots, caller.operand_stack.end(), callee.local_variables.begin());
+    caller.operand_stack.resize(caller.operand_stack.size() - slots);
+    adquirir_monitor_do_metodo(callee);
+}
+
+bool invocar_metodo_java(Frame& caller, uint32_t pc, RuntimeMethod* method, bool has_this) {
+    if (!jvm_stack.tem_espaco(*method)) {
+        handle_exception(caller, pc, EXC_STACK_OVERFLOW);
+        return false;
+    }
+
+    size_t depth = jvm_stack.size();
+    invocar_metodo(caller, pc, method, has_this);
+    try {
+        run_frame(jvm_stack.back());
+    } catch (...) {
+        jvm_stack.truncar(depth);
+        throw;
+    }
+
+    if (pending_exception != 0) {
+        jref exception = pending_exception;
+        pending_exception = 0;
+        lancar_excecao(caller, pc, exception);
+        return false;
+    }
+    return true;
+}
+
+// =======================================================================
+// 2.7. INICIALIZAÇÃO DE CLASSES
+// =======================================================================
+
+// Campos static final com atributo ConstantValue recebem seu valor antes do <clinit>
+static void aplicar_constant_values(RuntimeClass* cls) {
+    const ConstantPool& pool = cls->class_file->constant_pool;
+    for (const auto& f : cls->class_file->fields) {
+        if (!(f.access_flags & ACC_STATIC) || f.constantvalue_index == 0) continue;
+
+        const FieldLayout* field = find_static_field(cls, get_utf8(pool, f.name_index), get_utf8(pool, f.descriptor_index));
+        uint8_t* addr = cls->static_base() + field->offset;
+        const ConstantInfo& c = pool.at(f.constantvalue_index);
+
+        switch (c.tag) {
+            case CONSTANT_Long:
+            case CONSTANT_Double: {
+                uint64_t bits = ((uint64_t)c.high_bytes << 32) | c.low_bytes;
+                std::memcpy(addr, &bits, 8);
+                break;
+            }
+            case CONSTANT_String: {
+                jref ref = *internar_literal(get_utf8(pool, c.index1));
+                std::memcpy(addr, &ref, 4);
+                gc_barreira_estatica(cls, ref);
+                break;
+            }
+            default: // Integer/Float, truncado para o tamanho do campo (B, C, S, Z)
+                std::memcpy(addr, &c.bytes4, field->size); // Little-endian: bytes baixos primeiro
+                break;
+        }
+    }
+}
+
+// Classes de sistema sintéticas: o runtime faz o papel do <clinit>
+static void inicializar_classe_sistema(RuntimeClass* cls) {
+    if (cls->name == "java/lang/System") {
+        RuntimeClass* print_stream = carregar_classe("java/io/PrintStream");
+        uint32_t off_fd = find_field(print_stream, "fd", "I")->offset;
+        jref out = allocate_heap_object(print_stream);
+        jref err = allocate_heap_object(print_stream);
+        gravar_campo32(out, off_fd, 1);
+        gravar_campo32(err, off_fd, 2);
+        std::memcpy(cls->static_base() + find_static_field(cls, "out", "Ljava/io/PrintStream;")->offset, &out, 4);
+        std::memcpy(cls->static_base() + find_static_field(cls, "err", "Ljava/io/PrintStream;")->offset, &err, 4);
+        gc_barreira_estatica(cls, out);
+        gc_barreira_estatica(cls, err);
+    }
+}
+
+/**
+ * @brief Executa o <clinit> numa ativação aninhada do interpretador.
+ * @return false se o <clinit> terminou com uma exceção (em 'pending_exception').
+ */
+static bool executar_clinit(RuntimeClass* cls) {
+    RuntimeMethod* clinit = nullptr;
+    for (auto& m : cls->methods) {
+        if (m.name == "<clinit>" && m.has_code()) { clinit = &m; break; }
+    }
+    if (!clinit) return true;
+
+    if (!jvm_stack.tem_espaco(*clinit)) {
+        pending_exception = excecoes_vm[EXC_STACK_OVERFLOW].instance;
+        return false;
+    }
+
+    TRACE(TRACE_INIT, TRACE_INFO, "Executando <clinit> de {}", cls->name);
+    size_t depth = jvm_stack.size();
+    jvm_stack.emplace_back(*clinit);
+    try {
+        run_frame(jvm_stack.back());
+    } catch (...) {
+        jvm_stack.truncar(depth);
+        throw;
+    }
+    return pending_exception == 0;
+}
+
+static void concluir_inicializacao(RuntimeClass* cls, uint8_t state) {
+    std::lock_guard<std::mutex> lock(cls->init_lock);
+    cls->init_state.store(state, std::memory_order_release);
+    cls->init_thread = std::thread::id();
+    cls->init_cv.notify_all();
+}
+
+bool inicializar_classe(RuntimeClass* cls) {
+    if (cls->init_state.load(std::memory_order_acquire) == CLASS_INITIALIZED) return true;
+
+    const std::thread::id self = std::this_thread::get_id();
+    {
+        std::unique_lock<std::mutex> lock(cls->init_lock);
+
+        // 1. Outra thread está inicializando: aguarda a conclusão
+        while (cls->init_state.load() == CLASS_BEING_INIT && cls->init_thread != self) {
+            cls->init_cv.wait(lock);
+        }
+
+        // 2. Requisição recursiva da própria thread, ou já inicializada
+        uint8_t state = cls->init_state.load();
+        if (state == CLASS_BEING_INIT || state == CLASS_INITIALIZED) return true;
+
+        // 3. Uma inicialização anterior falhou
+        if (state == CLASS_ERROR) {
+            lock.unlock();
+            pending_exception = criar_excecao("java/lang/NoClassDefFoundError",
+                                              "Could not initialize class " + nome_java(cls->name), 0);
+            return false;
+        }
+
+        // 4. Marca a classe como em inicialização pela thread atual
+        cls->init_state.store(CLASS_BEING_INIT);
+        cls->init_thread = self;
+    }
+
+    bool ok = true;
+    try {
+        // 5. Superclasse primeiro (interfaces não inicializam a superclasse)
+        if (cls->super && !(cls->access_flags & ACC_INTERFACE)) {
+            ok = inicializar_classe(cls->super);
+        }
+
+        // 6. ConstantValue e <clinit>
+        if (ok && cls->class_file) {
+            aplicar_constant_values(cls);
+            ok = executar_clinit(cls);
+
+            // Exceções (que não sejam Error) do <clinit> chegam como ExceptionInInitializerError
+            if (!ok && !is_subtype_of(heap[pending_exception].klass, error_class)) {
+                jref cause = pending_exception;
+                pending_exception = criar_excecao("java/lang/ExceptionInInitializerError", "", cause);
+            }
+        } else if (ok) {
+            inicializar_classe_sistema(cls);
+        }
+    } catch (const std::exception& e) {
+        concluir_inicializacao(cls, CLASS_ERROR);
+        throw std::runtime_error("Erro interno ao inicializar " + cls->name + ": " + e.what());
+    }
+
+    // 7. Concluída (ou com erro): libera as threads em espera
+    concluir_inicializacao(cls, ok ? CLASS_INITIALIZED : CLASS_ERROR);
+    return ok;
+}
+
+/**
+ * @brief Inicializa a classe da referência e, quando ela estiver pronta, marca
+ * a entrada do CP com CP_INIT_DONE: as próximas execuções da instrução testam
+ * apenas esse byte e seguem pelo caminho sem verificações.
+ * @return false se a inicialização falhou: o erro já foi lançado no frame e a
+ * instrução não deve continuar.
+ */
+static bool garantir_inicializada(Frame& frame, uint32_t pc, CpCacheEntry& entry, RuntimeClass* cls) {
+    frame.call_pc = pc; // Um <clinit> executado aqui aparece no stack trace como chamado deste pc
+    if (!inicializar_classe(cls)) {
+        jref ex = pending_exception;
+        pending_exception = 0;
+        lancar_excecao(frame, pc, ex);
+        return false;
+    }
+    // Durante um <clinit> recursivo a classe ainda não está pronta para as demais threads
+    if (cls->init_state.load(std::memory_order_acquire) == CLASS_INITIALIZED) {
+        __atomic_fetch_or(&entry.flags, (uint8_t)CP_INIT_DONE, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+static inline bool init_done(const CpCacheEntry& entry) {
+    return __atomic_load_n(&entry.flags, __ATOMIC_ACQUIRE) & CP_INIT_DONE;
+}
+
+// Alvo ligado via CHA, ou nullptr: site virtual, ou invalidado entre a leitura do flag e a do alvo
+static inline RuntimeMethod* alvo_vfinal(const CpCacheEntry& entry) {
+    if (!(__atomic_load_n(&entry.flags, __ATOMIC_ACQUIRE) & CP_VFINAL)) return nullptr;
+    return __atomic_load_n(&entry.target, __ATOMIC_ACQUIRE);
+}
+
+// =======================================================================
+// 3. EXECUÇÃO PRINCIPAL (Loop Fetch-Decode-Execute)
+// =======================================================================
+
+// Registra o frame de entrada da ativação (limite do unwinding) e restaura o anterior ao sair
+// e o ponto de retomada dos estouros de pilha (tratador de SIGSEGV em thread.cpp)
+struct AtivacaoInterpretador {
+    size_t saved_entry_depth;
+    JavaThread* thread;
+    sigjmp_buf* saved_recuperacao;
+    sigjmp_buf recuperacao;
+
+    explicit AtivacaoInterpretador(size_t entry_depth)
+        : saved_entry_depth(activation_entry_depth), thread(thread_atual()), saved_recuperacao(thread->recuperacao) {
+        activation_entry_depth = entry_depth;
+        thread->recuperacao = &recuperacao;
+    }
+    ~AtivacaoInterpretador() {
+        activation_entry_depth = saved_entry_depth;
+        thread->recuperacao = saved_recuperacao;
+    }
+};
+
+void run_frame(Frame& entry_frame) {
+    // Profundidade em que o frame de entrada está: ao desempilhá-lo, a execução termina
+    const size_t entry_depth = jvm_stack.indice(entry_frame) + 1;
+    AtivacaoInterpretador ativacao(entry_depth);
+    const volatile uint8_t* const polling_page = ativacao.thread->polling_page;
+
+    // Retomada após um SIGSEGV esperado (thread.cpp):
+    // - estouro: o invoke que tocou a zona amarela não empilhou nada, então o chamador está
+    //   no topo, com call_pc no invoke. A zona volta a ser armada depois da entrega.
+    // - null: a instrução do frame do topo (instr_pc) leu um objeto pela ref 0.
+    // - safepoint: um poll falhou com o frame do topo em frame.pc, o próximo pc a executar.
+    switch (sigsetjmp(ativacao.recuperacao, 1)) {
+        case 0:
+            break;
+        case RECUPERACAO_STACK_OVERFLOW: {
+            Frame& caller = jvm_stack.back();
+            TRACE(TRACE_GUARD, TRACE_INFO, "Zona amarela atingida com {} frames: StackOverflowError", jvm_stack.size());
+            handle_exception(caller, caller.call_pc, EXC_STACK_OVERFLOW);
+            rearmar_zona_amarela(ativacao.thread);
+            break;
+        }
+        case RECUPERACAO_NULL_POINTER: {
+            Frame& faulting = jvm_stack.back();
+            TRACE(TRACE_GUARD, TRACE_INFO, "Acesso pela referencia nula em pc {}: NullPointerException", faulting.instr_pc);
+            handle_exception(faulting, faulting.instr_pc, EXC_NULL_POINTER);
+            break;
+        }
+        case RECUPERACAO_SAFEPOINT:
+            parar_no_safepoint(ativacao.thread);
+            break;
+    }
 
-    while (frame.pc < frame.code->size()) {
+    while (jvm_stack.size() >= entry_depth) {
+        Frame& frame = jvm_stack.back();
         uint32_t offset = frame.pc;
+        frame.instr_pc = offset;
         uint8_t opcode = fetch_u1(frame);
         
         // Output de Debug (Corretude)
-        std::cout << "\t[DISPATCH] PC: " << std::setw(4) << offset << " | Opcode: 0x" 
-                  << std::hex << (int)opcode << std::dec;
+        TRACE(TRACE_DISPATCH, TRACE_FINE, "PC: {4} | Opcode: 0x{x}", offset, (int)opcode);
         
         switch (opcode) {
             
             // --- CONSTANTES ---
+            case 0x01: // aconst_null
+                push_jword(frame, 0);
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> aconst_null");
+                break;
             case 0x03: case 0x04: case 0x05: case 0x06: case 0x07: case 0x08: 
             {
                 int32_t val = (int32_t)opcode - 0x03; 
                 push_jword(frame, (jword)val);
-                std::cout << " -> iconst_" << val << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iconst_{}", val);
                 break;
             }
             case 0x10: // bipush 
             {
                 int8_t val = (int8_t)fetch_u1(frame);
                 push_jword(frame, (jword)val);
-                std::cout << " -> bipush " << (int)val << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> bipush {}", (int)val);
                 break;
             }
             case 0x11: { /* sipush */ // <--- INCLUÍDO
                 int16_t short_val = fetch_s2(frame); 
                 push_jword(frame, (jword)short_val);
-                std::cout << " -> sipush " << short_val << std::endl; 
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> sipush {}", short_val); 
                 break;
             }
             case 0x12: // ldc (Inteiros e Strings)
@@ -281,20 +1060,17 @@ void run_frame(Frame& frame) {
                 
                 if (c.tag == CONSTANT_Integer) {
                     push_jword(frame, c.bytes4);
-                    std::cout << " -> ldc #" << (int)index << " (Int: " << (int32_t)c.bytes4 << ")" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ldc #{} (Int: {})", (int)index, (int32_t)c.bytes4);
                 } else if (c.tag == CONSTANT_String) {
                     uint16_t utf8_index = c.index1;
                     const std::string& literal = frame.class_constant_pool->at(utf8_index).utf8_string;
-                    
-                    size_t string_size = literal.length(); 
-                    jref string_ref = allocate_heap_object(3, string_size, "java/lang/String"); 
-                    
-                    for (size_t i = 0; i < string_size; ++i) {
-                        heap[string_ref].data[i] = (jword)literal[i];
-                    }
 
+                    // Resolvida uma vez por entrada do CP: toda execução empilha a mesma instância
+                    CpCacheEntry& entry = frame.method->owner->cp_cache[index];
+                    if (!entry.string) entry.string = internar_literal(literal);
+                    jref string_ref = *entry.string;
                     push_jword(frame, string_ref); 
-                    std::cout << " -> ldc #" << (int)index << " (String Ref: " << string_ref << ", \"" << literal << "\")" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ldc #{} (String Ref: {}, \"{}\")", (int)index, string_ref, literal);
                 } else {
                     throw std::runtime_error("LDC de tipo nao implementado: " + std::to_string(c.tag));
                 }
@@ -306,7 +1082,7 @@ void run_frame(Frame& frame) {
             {
                 int64_t val = (opcode == 0x09) ? 0L : 1L;
                 push_jlong(frame, val);
-                std::cout << " -> lconst_" << val << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> lconst_{}", val);
                 break;
             }
             case 0x14: // ldc2_w
@@ -317,13 +1093,13 @@ void run_frame(Frame& frame) {
                 if (c.tag == CONSTANT_Long) {
                     int64_t val = ((int64_t)c.high_bytes << 32) | c.low_bytes;
                     push_jlong(frame, val);
-                    std::cout << " -> ldc2_w #" << index << " (Long: " << val << "l)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ldc2_w #{} (Long: {}l)", index, val);
                 } else if (c.tag == CONSTANT_Double) {
                     uint64_t bits = ((uint64_t)c.high_bytes << 32) | c.low_bytes;
                     double val;
                     std::memcpy(&val, &bits, sizeof(double));
                     push_jdouble(frame, val);
-                    std::cout << " -> ldc2_w #" << index << " (Double: " << val << "d)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ldc2_w #{} (Double: {}d)", index, val);
                 } else {
                     throw std::runtime_error("LDC2_W de tipo invalido: " + std::to_string(c.tag));
                 }
@@ -336,21 +1112,21 @@ void run_frame(Frame& frame) {
                 uint8_t index = (uint8_t)opcode - 0x2a;
                 jword ref = frame.local_variables.at(index);
                 push_jword(frame, ref);
-                std::cout << " -> aload_" << (int)index << " (Ref: " << ref << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> aload_{} (Ref: {})", (int)index, ref);
                 break;
             }
             case 0x1a: case 0x1b: case 0x1c: case 0x1d: // iload_0 a iload_3
             {
                 uint8_t index = (uint8_t)opcode - 0x1a;
                 push_jword(frame, frame.local_variables.at(index));
-                std::cout << " -> iload_" << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iload_{}", (int)index);
                 break;
             }
             case 0x15: // iload 
             {
                 uint8_t index = fetch_u1(frame);
                 push_jword(frame, frame.local_variables.at(index));
-                std::cout << " -> iload " << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iload {}", (int)index);
                 break;
             }
 
@@ -358,14 +1134,14 @@ void run_frame(Frame& frame) {
             case 0x36: { /* istore */ 
                 uint8_t index = fetch_u1(frame);
                 frame.local_variables.at(index) = pop_jword(frame);
-                std::cout << " -> istore " << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> istore {}", (int)index);
                 break;
             }
             case 0x3b: case 0x3c: case 0x3d: case 0x3e: // istore_0 a istore_3
             {
                 uint8_t index = (uint8_t)opcode - 0x3b;
                 frame.local_variables.at(index) = pop_jword(frame);
-                std::cout << " -> istore_" << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> istore_{}", (int)index);
                 break;
             }
             
@@ -374,7 +1150,7 @@ void run_frame(Frame& frame) {
                 uint8_t index = fetch_u1(frame);
                 jword ref = pop_jword(frame);
                 frame.local_variables.at(index) = ref;
-                std::cout << " -> astore " << (int)index << " (Ref: " << ref << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> astore {} (Ref: {})", (int)index, ref);
                 break;
             }
             case 0x4b: case 0x4c: case 0x4d: case 0x4e: // astore_0 a astore_3
@@ -382,7 +1158,7 @@ void run_frame(Frame& frame) {
                 uint8_t index = (uint8_t)opcode - 0x4b;
                 jword ref = pop_jword(frame);
                 frame.local_variables.at(index) = ref;
-                std::cout << " -> astore_" << (int)index << " (Ref: " << ref << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> astore_{} (Ref: {})", (int)index, ref);
                 break;
             }
 
@@ -395,7 +1171,7 @@ void run_frame(Frame& frame) {
                 
                 push_jword(frame, low);
                 push_jword(frame, high);
-                std::cout << " -> lload_" << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> lload_{}", (int)index);
                 break;
             }
             case 0x37: { /* lstore (índice variável) */
@@ -404,7 +1180,7 @@ void run_frame(Frame& frame) {
                 
                 frame.local_variables.at(index) = (jword)(val & 0xFFFFFFFF);
                 frame.local_variables.at(index + 1) = (jword)(val >> 32);
-                std::cout << " -> lstore " << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> lstore {}", (int)index);
                 break;
             }
             case 0x3f: case 0x40: case 0x41: case 0x42: // lstore_0 a lstore_3
@@ -414,7 +1190,7 @@ void run_frame(Frame& frame) {
                 
                 frame.local_variables.at(index) = (jword)(val & 0xFFFFFFFF);
                 frame.local_variables.at(index + 1) = (jword)(val >> 32);
-                std::cout << " -> lstore_" << (int)index << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> lstore_{}", (int)index);
                 break;
             }
 
@@ -422,15 +1198,19 @@ void run_frame(Frame& frame) {
             case 0xbb: // new
             {
                 uint16_t class_index = fetch_u2(frame); 
-                size_t fields_size = 4; // Tamanho simplificado
-                
-                std::string class_name = get_class_name(*frame.class_constant_pool, class_index);
-                // "new" cria um objeto dessa classe.
+                CpCacheEntry& entry = frame.method->owner->cp_cache[class_index];
+                if (!init_done(entry) &&
+                    !garantir_inicializada(frame, offset, entry, resolver_classe(frame.method->owner, class_index))) {
+                    break;
+                }
+                RuntimeClass* cls = entry.klass;
                 
-                jref new_ref = allocate_heap_object(0, fields_size, class_name); // Type 0: Objeto
+                // "new" cria um objeto dessa classe, com o tamanho exato do seu layout
+                jref new_ref = allocate_heap_object(cls);
                 push_jword(frame, new_ref);
                 
-                std::cout << " -> new #" << class_index << " (Ref: " << new_ref << ", Classe: " << class_name << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> new #{} (Ref: {}, Classe: {}, Bytes: {})",
+                      class_index, new_ref, cls->name, cls->instance_size);
                 break;
             }
             
@@ -441,14 +1221,15 @@ void run_frame(Frame& frame) {
                 int32_t count = (int32_t)pop_jword(frame); 
                 
                 if (count < 0) {
-                    handle_exception(frame, "Tamanho negativo", "java/lang/NegativeArraySizeException");
+                    handle_exception(frame, offset, EXC_NEGATIVE_ARRAY_SIZE);
                     break;
                 }
                 
-                jref array_ref = allocate_heap_object(atype, (size_t)count, "[PRIMITIVE]"); 
+                jref array_ref = allocate_heap_object(classe_array_primitiva(atype), (uint32_t)count);
                 push_jword(frame, array_ref);
                 
-                std::cout << " -> [ARRAY] newarray (Type: " << (int)atype << ", Size: " << count << ", Ref: " << array_ref << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] newarray (Type: {}, Size: {}, Ref: {})",
+                      (int)atype, count, array_ref);
                 break;
             }
 
@@ -458,115 +1239,185 @@ void run_frame(Frame& frame) {
                 int32_t count = (int32_t)pop_jword(frame);
                 
                 if (count < 0) {
-                    handle_exception(frame, "Tamanho negativo", "java/lang/NegativeArraySizeException");
+                    handle_exception(frame, offset, EXC_NEGATIVE_ARRAY_SIZE);
                     break;
                 }
                 
-                std::string class_name = get_class_name(*frame.class_constant_pool, class_index);
-                std::string array_class_name = "[L" + class_name + ";"; // Descritor de array de objetos
+                // Classe do elemento pelo cache do CP; a classe do array fica guardada nela
+                RuntimeClass* array_class = classe_array(resolver_classe(frame.method->owner, class_index));
                 
-                // Tipo 2: Array de Referências
-                jref array_ref = allocate_heap_object(2, (size_t)count, array_class_name);
+                jref array_ref = allocate_heap_object(array_class, (uint32_t)count);
                 push_jword(frame, array_ref);
                 
-                std::cout << " -> [ARRAY] anewarray #" << class_index << " (Class: " << class_name << ", Size: " << count << ", Ref: " << array_ref << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] anewarray #{} (Class: {}, Size: {}, Ref: {})",
+                      class_index, array_class->name, count, array_ref);
                 break;
             }
             
-            case 0xbe: // arraylength
+            case 0xc5: // multianewarray (Array de várias dimensões)
             {
-                jref array_ref = pop_jword(frame);
-                
-                if (array_ref == 0) {
-                     handle_exception(frame, "Array nulo em length", "java/lang/NullPointerException");
-                     break;
-                }
-                
-                // Verifica limites do heap (segurança)
-                if (array_ref >= heap.size()) {
-                    handle_exception(frame, "Ref invalida", "java/lang/InternalError");
+                uint16_t class_index = fetch_u2(frame);
+                uint8_t dims = fetch_u1(frame);
+
+                // Tamanhos empilhados da dimensão externa para a interna
+                int32_t counts[255];
+                for (int d = dims - 1; d >= 0; d--) counts[d] = (int32_t)pop_jword(frame);
+                if (std::any_of(counts, counts + dims, [](int32_t c) { return c < 0; })) {
+                    handle_exception(frame, offset, EXC_NEGATIVE_ARRAY_SIZE);
                     break;
                 }
-                
-                jword length = (jword)heap[array_ref].size;
+
+                RuntimeClass* array_class = resolver_classe(frame.method->owner, class_index);
+                jref array_ref = criar_multiarray(array_class, counts, dims);
+                push_jword(frame, array_ref);
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] multianewarray #{} (Class: {}, Dims: {}, Ref: {})",
+                      class_index, array_class->name, (uint32_t)dims, array_ref);
+                break;
+            }
+
+            case 0xbe: // arraylength
+            {
+                jref array_ref = pop_jword(frame);
+                jword length = heap[array_ref].length; // null: falha na zona nula (NullPointerException)
                 push_jword(frame, length);
                 
-                std::cout << " -> [ARRAY] arraylength (Ref: " << array_ref << ", Size: " << length << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] arraylength (Ref: {}, Size: {})", array_ref, length);
                 break;
             }
 
-            case 0x2e: // iaload (Carrega INT de Array)
+            case 0x2e: case 0x2f: case 0x30: case 0x31: // iaload, laload, faload, daload
+            case 0x32: case 0x33: case 0x34: case 0x35: // aaload, baload (byte e boolean), caload, saload
             {
                 int32_t index = (int32_t)pop_jword(frame);
                 jref array_ref = pop_jword(frame);
-                
-                if (array_ref == 0 || array_ref >= heap.size() || index < 0 || (size_t)index >= heap[array_ref].size) {
-                    handle_exception(frame, "Indice fora dos limites", "java/lang/ArrayIndexOutOfBoundsException");
-                    break;
-                }
-                
-                jword value = heap[array_ref].data[index];
-                push_jword(frame, value);
-                
-                std::cout << " -> [ARRAY] iaload (Ref: " << array_ref << ", Index: " << index << ", Valor: " << (int32_t)value << ")" << std::endl;
+
+                uint8_t* addr = endereco_elemento(frame, offset, array_ref, index);
+                if (!addr) break;
+
+                // A largura e a extensão de sinal saem do tipo do elemento ("[B" -> 'B')
+                const char tipo = heap[array_ref].klass->name[1];
+                carregar_campo(frame, addr, tipo);
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] xaload (Classe: {}, Ref: {}, Index: {})",
+                      heap[array_ref].klass->name, array_ref, index);
                 break;
             }
 
-            case 0x4f: // iastore (Armazena INT em Array)
+            case 0x4f: case 0x50: case 0x51: case 0x52: // iastore, lastore, fastore, dastore
+            case 0x54: case 0x55: case 0x56:            // bastore (byte e boolean), castore, sastore
             {
-                jword value = pop_jword(frame);
+                // O valor (1 ou 2 slots) fica no topo até o índice ser validado
+                const size_t slots = (opcode == 0x50 || opcode == 0x52) ? 2 : 1;
+                const size_t topo = frame.operand_stack.size() - slots;
+                int32_t index = (int32_t)frame.operand_stack[topo - 1];
+                jref array_ref = frame.operand_stack[topo - 2];
+
+                uint8_t* addr = endereco_elemento(frame, offset, array_ref, index);
+                if (!addr) break;
+
+                const char tipo = heap[array_ref].klass->name[1];
+                armazenar_campo(frame, addr, tipo);
+                frame.operand_stack.resize(topo - 2);
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] xastore (Classe: {}, Ref: {}, Index: {})",
+                      heap[array_ref].klass->name, array_ref, index);
+                break;
+            }
+
+            case 0x53: // aastore (Armazena referência em Array)
+            {
+                jref value = pop_jword(frame);
                 int32_t index = (int32_t)pop_jword(frame);
                 jref array_ref = pop_jword(frame);
-                
-                if (array_ref == 0 || array_ref >= heap.size() || index < 0 || (size_t)index >= heap[array_ref].size) {
-                    throw std::runtime_error("ArrayIndexOutOfBoundsException ou NullPointerException em iastore.");
+
+                uint8_t* addr = endereco_elemento(frame, offset, array_ref, index);
+                if (!addr) break;
+                // O array pode ter sido criado com um tipo de elemento mais específico que o estático
+                RuntimeClass* element_class = heap[array_ref].klass->element_class;
+                if (value != 0 && !is_subtype_of(heap[value].klass, element_class)) {
+                    lancar_excecao(frame, offset, criar_excecao("java/lang/ArrayStoreException",
+                                                                nome_java(heap[value].klass->name), 0));
+                    break;
                 }
 
-                heap[array_ref].data[index] = value;
-                
-                std::cout << " -> [ARRAY] iastore (Ref: " << array_ref << ", Index: " << index << ", Salvou: " << (int32_t)value << ")" << std::endl;
+                std::memcpy(addr, &value, sizeof(jref));
+                gc_barreira(array_ref, value);
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> [ARRAY] aastore (Ref: {}, Index: {}, Salvou: {})",
+                      array_ref, index, value);
                 break;
             }
             
             case 0xb2: // getstatic 
             {
                 uint16_t field_index = fetch_u2(frame); 
-                std::string field_ref_name = resolver_indice_cp_completo(*frame.class_constant_pool, field_index);
-                push_jword(frame, 1); // Simulação: Push Ref: 1 para System.out
+                CpCacheEntry& field = frame.method->owner->cp_cache[field_index];
+                if (!init_done(field)) {
+                    resolver_fieldref(frame.method->owner, field_index, true);
+                    if (!garantir_inicializada(frame, offset, field, field.klass)) break;
+                }
+
+                carregar_campo(frame, field.static_addr, field.field_type);
                 
-                std::cout << " -> getstatic #" << field_index << " (Carregou Ref: 1, Campo: " << field_ref_name << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> getstatic #{} (Classe: {}, Offset: {}, Tipo: {})",
+                      field_index, field.klass->name, field.field_offset, std::string(1, field.field_type));
+                break;
+            }
+
+            case 0xb3: // putstatic 
+            {
+                uint16_t field_index = fetch_u2(frame); 
+                CpCacheEntry& field = frame.method->owner->cp_cache[field_index];
+                if (!init_done(field)) {
+                    resolver_fieldref(frame.method->owner, field_index, true);
+                    if (!garantir_inicializada(frame, offset, field, field.klass)) break;
+                }
+
+                if (field.field_type == 'L' || field.field_type == '[') {
+                    gc_barreira_estatica(field.klass, frame.operand_stack.back());
+                }
+                armazenar_campo(frame, field.static_addr, field.field_type);
+                
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> putstatic #{} (Classe: {}, Offset: {}, Tipo: {})",
+                      field_index, field.klass->name, field.field_offset, std::string(1, field.field_type));
                 break;
             }
             
             case 0xb4: // getfield 
             {
                 uint16_t field_index = fetch_u2(frame); 
+                const CpCacheEntry& field = resolver_fieldref(frame.method->owner, field_index);
                 jref object_ref = pop_jword(frame); 
                 
-                if (object_ref == 0 || object_ref >= heap.size()) {
-                    throw std::runtime_error("Referencia nula ou invalida em getfield.");
-                }
-                
-                jword field_value = heap[object_ref].data[1]; 
+                // Uma única leitura no deslocamento resolvido (null: falha ao ler o objeto)
+                carregar_campo(frame, heap[object_ref].bytes() + field.field_offset, field.field_type);
                 
-                push_jword(frame, field_value);
-                std::cout << " -> getfield #" << field_index << " (Ref: " << object_ref << ", Valor: " << (int32_t)field_value << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> getfield #{} (Ref: {}, Offset: {}, Tipo: {})",
+                      field_index, object_ref, field.field_offset, std::string(1, field.field_type));
                 break;
             }
 
             case 0xb5: // putfield 
             {
                 uint16_t field_index = fetch_u2(frame);
-                jword field_value = pop_jword(frame); 
-                jref object_ref = pop_jword(frame); 
-                
-                if (object_ref == 0 || object_ref >= heap.size()) {
-                    throw std::runtime_error("Referencia nula ou invalida em putfield.");
+                const CpCacheEntry& field = resolver_fieldref(frame.method->owner, field_index);
+
+                // O objeto está abaixo do valor (que ocupa 2 slots se for long/double)
+                size_t value_slots = (field.field_type == 'J' || field.field_type == 'D') ? 2 : 1;
+                if (frame.operand_stack.size() <= value_slots) {
+                    throw std::runtime_error("Erro: Pop em pilha de operandos vazia!");
                 }
+                jref object_ref = frame.operand_stack[frame.operand_stack.size() - 1 - value_slots];
                 
-                heap[object_ref].data[1] = field_value; 
+                // Uma única escrita no deslocamento resolvido (null: falha ao ler o objeto, antes de escrever)
+                jword value = frame.operand_stack.back();
+                armazenar_campo(frame, heap[object_ref].bytes() + field.field_offset, field.field_type);
+                pop_jword(frame); // objectref
+                if (field.field_type == 'L' || field.field_type == '[') gc_barreira(object_ref, value);
 
-                std::cout << " -> putfield #" << field_index << " (Ref: " << object_ref << ", Salvou: " << (int32_t)field_value << ")" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> putfield #{} (Ref: {}, Offset: {}, Tipo: {})",
+                      field_index, object_ref, field.field_offset, std::string(1, field.field_type));
                 break;
             }
             
@@ -574,7 +1425,7 @@ void run_frame(Frame& frame) {
             case 0x57: // pop
             {
                 pop_jword(frame);
-                std::cout << " -> pop" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> pop");
                 break;
             }
             case 0x59: // dup 
@@ -582,14 +1433,14 @@ void run_frame(Frame& frame) {
                 jword val = pop_jword(frame);
                 push_jword(frame, val);
                 push_jword(frame, val);
-                std::cout << " -> dup" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> dup");
                 break;
             }
             case 0x58: // pop2
             {
                 pop_jword(frame); 
                 pop_jword(frame); 
-                std::cout << " -> pop2" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> pop2");
                 break;
             }
 
@@ -600,7 +1451,7 @@ void run_frame(Frame& frame) {
                 int32_t val1 = (int32_t)pop_jword(frame);
                 int32_t result = val1 + val2;
                 push_jword(frame, (jword)result);
-                std::cout << " -> iadd. Resultado: " << result << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iadd. Resultado: {}", result);
                 break;
             }
             case 0x64: // isub
@@ -609,7 +1460,7 @@ void run_frame(Frame& frame) {
                 int32_t val1 = (int32_t)pop_jword(frame);
                 int32_t result = val1 - val2;
                 push_jword(frame, (jword)result);
-                std::cout << " -> isub. Resultado: " << result << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> isub. Resultado: {}", result);
                 break;
             }
             case 0x68: // imul
@@ -618,7 +1469,7 @@ void run_frame(Frame& frame) {
                 int32_t val1 = (int32_t)pop_jword(frame);
                 int32_t result = val1 * val2; // Atenção: Overflow silencioso em Java/C++
                 push_jword(frame, (jword)result);
-                std::cout << " -> imul. Resultado: " << result << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> imul. Resultado: {}", result);
                 break;
             }
             case 0x6c: // idiv (Divisão de inteiros)
@@ -627,14 +1478,14 @@ void run_frame(Frame& frame) {
                 int32_t val1 = (int32_t)pop_jword(frame); // Dividendo
                 
                 if (val2 == 0) {
-                    std::cout << " -> idiv. ERRO: ArithmeticException (Divisao por zero)" << std::endl;
-                    handle_exception(frame, "/ by zero", "java/lang/ArithmeticException");
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> idiv. ERRO: ArithmeticException (Divisao por zero)");
+                    handle_exception(frame, offset, EXC_ARITHMETIC);
                     break; // Sai do switch e continua o loop no novo PC
                 }
 
                 int32_t result = val1 / val2;
                 push_jword(frame, (jword)result);
-                std::cout << " -> idiv. Resultado: " << result << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> idiv. Resultado: {}", result);
                 break;
             }
             case 0x70: // irem (Resto da divisão)
@@ -643,20 +1494,20 @@ void run_frame(Frame& frame) {
                 int32_t val1 = (int32_t)pop_jword(frame);
                 
                 if (val2 == 0) {
-                    handle_exception(frame, "/ by zero", "java/lang/ArithmeticException");
+                    handle_exception(frame, offset, EXC_ARITHMETIC);
                     break;
                 }
                 
                 int32_t result = val1 % val2;
                 push_jword(frame, (jword)result);
-                std::cout << " -> irem. Resultado: " << result << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> irem. Resultado: {}", result);
                 break;
             }
             case 0x74: // ineg (Negação)
             {
                 int32_t val = (int32_t)pop_jword(frame);
                 push_jword(frame, (jword)(-val));
-                std::cout << " -> ineg. Resultado: " << -val << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ineg. Resultado: {}", -val);
                 break;
             }
             // --- BITWISE (Lógica bit a bit) ---
@@ -667,7 +1518,7 @@ void run_frame(Frame& frame) {
                  // Os 5 bits menos significativos determinam o shift
                  int32_t result = val1 << (val2 & 0x1F);
                  push_jword(frame, (jword)result);
-                 std::cout << " -> ishl" << std::endl;
+                 TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ishl");
                  break;
             }
             case 0x7a: // ishr (Arithmetic Shift Right)
@@ -676,7 +1527,7 @@ void run_frame(Frame& frame) {
                  int32_t val1 = (int32_t)pop_jword(frame);
                  int32_t result = val1 >> (val2 & 0x1F);
                  push_jword(frame, (jword)result);
-                 std::cout << " -> ishr" << std::endl;
+                 TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ishr");
                  break;
             }
             case 0x7e: // iand
@@ -684,7 +1535,7 @@ void run_frame(Frame& frame) {
                  int32_t val2 = (int32_t)pop_jword(frame);
                  int32_t val1 = (int32_t)pop_jword(frame);
                  push_jword(frame, (jword)(val1 & val2));
-                 std::cout << " -> iand" << std::endl;
+                 TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iand");
                  break;
             }
             case 0x80: // ior
@@ -692,7 +1543,7 @@ void run_frame(Frame& frame) {
                  int32_t val2 = (int32_t)pop_jword(frame);
                  int32_t val1 = (int32_t)pop_jword(frame);
                  push_jword(frame, (jword)(val1 | val2));
-                 std::cout << " -> ior" << std::endl;
+                 TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ior");
                  break;
             }
             case 0x82: // ixor
@@ -700,7 +1551,7 @@ void run_frame(Frame& frame) {
                  int32_t val2 = (int32_t)pop_jword(frame);
                  int32_t val1 = (int32_t)pop_jword(frame);
                  push_jword(frame, (jword)(val1 ^ val2));
-                 std::cout << " -> ixor" << std::endl;
+                 TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ixor");
                  break;
             }
             case 0x61: // ladd
@@ -709,7 +1560,7 @@ void run_frame(Frame& frame) {
                 int64_t val1 = pop_jlong(frame);
                 int64_t result = val1 + val2;
                 push_jlong(frame, result);
-                std::cout << " -> ladd. Resultado: " << result << "l" << std::endl;
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ladd. Resultado: {}l", result);
                 break;
             }
 
@@ -720,9 +1571,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val == 0) {
                     frame.pc += (offset_s16 - 3);
-                     std::cout << " -> ifeq (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                     TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifeq (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> ifeq (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifeq (FALSE)");
                 }
                 break;
             }
@@ -732,9 +1584,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val != 0) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> ifne (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifne (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> ifne (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifne (FALSE)");
                 }
                 break;
             }
@@ -744,9 +1597,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val < 0) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> iflt (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iflt (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> iflt (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> iflt (FALSE)");
                 }
                 break;
             }
@@ -756,9 +1610,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val >= 0) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> ifge (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifge (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> ifge (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifge (FALSE)");
                 }
                 break;
             }
@@ -768,9 +1623,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val > 0) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> ifgt (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifgt (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> ifgt (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifgt (FALSE)");
                 }
                 break;
             }
@@ -780,9 +1636,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val <= 0) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> ifle (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifle (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> ifle (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> ifle (FALSE)");
                 }
                 break;
             }
@@ -795,9 +1652,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 == val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmpeq (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpeq (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmpeq (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpeq (FALSE)");
                 }
                 break;
             }
@@ -808,9 +1666,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 != val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmpne (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpne (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmpne (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpne (FALSE)");
                 }
                 break;
             }
@@ -821,9 +1680,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 < val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmplt (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmplt (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmplt (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmplt (FALSE)");
                 }
                 break;
             }
@@ -834,9 +1694,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 >= val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmpge (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpge (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmpge (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpge (FALSE)");
                 }
                 break;
             }
@@ -847,9 +1708,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 > val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmpgt (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpgt (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmpgt (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmpgt (FALSE)");
                 }
                 break;
             }
@@ -860,9 +1722,10 @@ void run_frame(Frame& frame) {
                 int16_t offset_s16 = fetch_s2(frame);
                 if (val1 <= val2) {
                     frame.pc += (offset_s16 - 3);
-                    std::cout << " -> if_icmple (JUMPED to " << frame.pc << ")" << std::endl;
+                    if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmple (JUMPED to {})", frame.pc);
                 } else {
-                    std::cout << " -> if_icmple (FALSE)" << std::endl;
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> if_icmple (FALSE)");
                 }
                 break;
             }
@@ -872,7 +1735,22 @@ void run_frame(Frame& frame) {
             {
                 int16_t offset_s16 = fetch_s2(frame); 
                 frame.pc += (offset_s16 - 3); 
-                std::cout << " -> goto " << (offset + offset_s16) << std::endl;
+                if (offset_s16 < 0) poll_safepoint(polling_page); // Desvio para trás
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> goto {}", (offset + offset_s16));
+                break;
+            }
+
+            case 0xaa: case 0xab: // tableswitch, lookupswitch (compilados na ligação do método)
+            {
+                const SwitchTable* sw = buscar_switch(*frame.method, offset);
+                if (!sw) {
+                    throw std::runtime_error("Switch invalido no pc " + std::to_string(offset));
+                }
+                int32_t key = (int32_t)pop_jword(frame);
+                frame.pc = sw->destino(key);
+                if (frame.pc <= offset) poll_safepoint(polling_page); // Desvio para trás (um laço fechado pelo switch)
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> {} (Chave: {}, Destino: {})",
+                      (opcode == 0xaa ? "tableswitch" : "lookupswitch"), key, frame.pc);
                 break;
             }
 
@@ -882,97 +1760,208 @@ void run_frame(Frame& frame) {
             case 0xb7: // invokespecial 
             {
                 uint16_t index = fetch_u2(frame); 
-                std::string method_ref = resolver_indice_cp_completo(*frame.class_constant_pool, index);
-                pop_jword(frame); // Consome a referência 'this'
-                std::cout << " -> invokespecial #" << index << " (Chamada: " << method_ref << ") - *Referencia consumida*" << std::endl;
+                CpCacheEntry& entry = resolver_methodref(frame.method->owner, index);
+                RuntimeMethod* target = entry.method;
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokespecial #{} (Chamada: {}.{}{})",
+                      index, target->owner->name, target->name, target->descriptor);
+                invocar_metodo(frame, offset, target, true);
                 break;
             }
             
             case 0xb6: // invokevirtual 
             {
                 uint16_t method_index = fetch_u2(frame);
-                std::string method_ref = resolver_indice_cp_completo(*frame.class_constant_pool, method_index);
-                
-                if (method_ref.find("java/io/PrintStream.println") != std::string::npos) {
-                    
-                    int32_t output_val = (int32_t)pop_jword(frame); 
-                    pop_jword(frame); 
+                CpCacheEntry& entry = resolver_methodref(frame.method->owner, method_index);
+                RuntimeMethod* declared = entry.method;
 
-                    std::cout << " -> invokevirtual #" << method_index << " (Chamada: " << method_ref << ") - *Simulando*" << std::endl;
-                    std::cout << "\n\t\t[OUTPUT SIMULADO] Valor impresso: " << output_val << std::endl;
+                // 1. Pegar a referência do objeto (this), abaixo dos argumentos
+                size_t args_slots = (size_t)declared->arg_slots;
+                if (frame.operand_stack.size() <= args_slots) {
+                    handle_exception(frame, offset, EXC_VERIFY);
+                    break;
+                }
+
+                jref object_ref = frame.operand_stack[frame.operand_stack.size() - 1 - args_slots];
+                tocar_objeto(object_ref); // NullPointerException implícita, também nos sites ligados via CHA
+
+                // Método de sistema num receptor de classe de sistema: não há sobrescrita
+                // possível, vai direto ao nativo ligado na resolução
+                if (declared->info == nullptr && heap[object_ref].klass->class_file == nullptr) {
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokevirtual #{} ({}: {}.{}{})",
+                          method_index, (declared->native ? "Nativo" : "Simulado"), declared->owner->name, declared->name, declared->descriptor);
+                    invocar_metodo_sistema(frame, offset, declared, true);
+                    break;
+                }
+
+                // 2. Site efetivamente final (CHA): alvo ligado estaticamente, sem consultar o receptor
+                RuntimeMethod* target = alvo_vfinal(entry);
+                if (target) {
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokevirtual #{}. (Ref: {}) [CHA] Ligado a {}.{}",
+                          method_index, object_ref, target->owner->name, target->name);
                 } else {
-                    // IMPLEMENTAÇÃO DE POLIMORFISMO
-                    // 1. Descobrir quantos argumentos o método tem para achar o 'this'
-                    uint16_t name_and_type_idx = frame.class_constant_pool->at(method_index).index2;
-                    uint16_t desc_idx = frame.class_constant_pool->at(name_and_type_idx).index2;
-                    std::string desc = get_utf8(*frame.class_constant_pool, desc_idx);
-                    
-                    int args_count = count_args(desc);
-                    
-                    // 2. Pegar a referência do objeto (this)
-                    // Está em: stack[size - 1 - args_count]
-                    if (frame.operand_stack.size() <= (size_t)args_count) {
-                       handle_exception(frame, "Stack Underflow em invoke", "java/lang/VerifyError");
-                       break;
-                    }
-                    
-                    jref object_ref = frame.operand_stack[frame.operand_stack.size() - 1 - args_count];
-                    
-                    if (object_ref == 0) { // NullPointerException
-                        handle_exception(frame, "Objeto nulo em invoke", "java/lang/NullPointerException");
-                        break;
+                    // 3. IMPLEMENTAÇÃO DE POLIMORFISMO: resolver a classe real do objeto
+                    RuntimeClass* runtime_class = heap[object_ref].klass;
+                    target = find_method(runtime_class, declared->name, declared->descriptor);
+
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokevirtual #{}. (Ref: {})", method_index, object_ref);
+                    TRACE(TRACE_LINK, TRACE_FINE, "[POLIMORFISMO] Classe do Objeto (Runtime): {}", runtime_class->name);
+
+                    if (!target || (target->access_flags & ACC_ABSTRACT)) {
+                        throw std::runtime_error("AbstractMethodError: " + runtime_class->name + "." + declared->name);
                     }
-                    
-                    // 3. Resolver a classe real do objeto
-                    std::string runtime_class_name = heap[object_ref].class_name;
-                    
-                    std::cout << " -> invokevirtual #" << method_index << ". (Ref: " << object_ref << ")" << std::endl;
-                    std::cout << "\t\t[POLIMORFISMO] Classe declarada no CP: (resolvido por index #" << method_index << ")" << std::endl;
-                    std::cout << "\t\t[POLIMORFISMO] Classe do Objeto (Runtime): " << runtime_class_name << std::endl;
-                    std::cout << "\t\t[POLIMORFISMO] Buscando metodo em " << runtime_class_name << "..." << std::endl;
-                    
-                    // Simulando a execução (consumindo argumentos)
-                    for(int i=0; i<args_count; i++) pop_jword(frame); // Args
-                    pop_jword(frame); // This
-                    
-                    // Aqui entraria a lógica de criar um novo Frame com o método da classe runtime_class_name
-                }
-                 
-                
+                }
+
+                invocar_metodo(frame, offset, target, true);
                 break;
             }
             
             case 0xb8: // invokestatic 
             {
                 uint16_t index = fetch_u2(frame); 
-                std::string method_ref = resolver_indice_cp_completo(*frame.class_constant_pool, index);
-                
-                if (method_ref.find("java/io/PrintStream.println") != std::string::npos) {
-                    
-                    jref arg_ref = pop_jword(frame); 
-                    pop_jword(frame); 
-                    
-                    if (arg_ref > 0 && arg_ref < heap.size() && heap[arg_ref].type == 3) { 
-                        std::cout << "\n\t\t[OUTPUT SIMULADO] String impressa: ";
-                        for(jword c : heap[arg_ref].data) {
-                            std::cout << (char)c;
-                        }
-                        std::cout << std::endl;
-                    } else {
-                         std::cout << "\n\t\t[OUTPUT SIMULADO] Valor impresso: " << (int32_t)arg_ref << std::endl;
-                    }
+                CpCacheEntry& entry = resolver_methodref(frame.method->owner, index);
+                if (!init_done(entry) && !garantir_inicializada(frame, offset, entry, entry.method->owner)) {
+                    break;
+                }
 
-                } else {
-                    std::cout << " -> invokestatic #" << index << ". (Chamada: " << method_ref << ") - *Simulando*" << std::endl;
+                if (entry.method->info == nullptr) {
+                    TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokestatic #{} ({}: {}.{}{})",
+                          index, (entry.method->native ? "Nativo" : "Simulado"), entry.method->owner->name, entry.method->name, entry.method->descriptor);
+                    invocar_metodo_sistema(frame, offset, entry.method, false);
+                    break;
                 }
-                
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokestatic #{}. (Chamada: {}.{})",
+                      index, entry.method->owner->name, entry.method->name);
+                invocar_metodo(frame, offset, entry.method, false);
+                break;
+            }
+
+            case 0xba: // invokedynamic
+            {
+                uint16_t index = fetch_u2(frame);
+                uint16_t site_index = fetch_u2(frame); // Bytes reservados: índice do site (gravado na ligação do método)
+                CallSite& site = frame.method->call_sites.at(site_index);
+
+                // Primeira execução do site: bootstrap; as seguintes vão direto ao alvo
+                if (!site.target) {
+                    std::string erro;
+                    if (!ligar_call_site(frame.method->owner, site, erro)) {
+                        TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokedynamic #{} (Falha no bootstrap: {})", index, erro);
+                        lancar_excecao(frame, offset, criar_excecao("java/lang/BootstrapMethodError", erro, 0));
+                        break;
+                    }
+                }
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> invokedynamic #{} (Site {})", index, site_index);
+                frame.call_pc = offset;
+                site.target(frame, offset, site);
                 break;
             }
             
             // --- RETORNO ---
+            case 0xac: case 0xae: case 0xb0: // ireturn, freturn, areturn
+            {
+                // Poll antes de desempilhar: no safepoint, o frame está parado no próprio retorno
+                frame.pc = offset;
+                poll_safepoint(polling_page);
+                if (!liberar_monitor_do_metodo(frame, ativacao.thread)) {
+                    handle_exception(frame, offset, EXC_ILLEGAL_MONITOR_STATE);
+                    break;
+                }
+                jword value = pop_jword(frame);
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> return (Valor: {})", (int32_t)value);
+
+                jvm_stack.pop_back(); // 'frame' deixa de ser válido
+                // Também no frame de entrada: o valor volta ao nativo que criou a ativação (invocar_metodo_java)
+                if (!jvm_stack.empty()) push_jword(jvm_stack.back(), value);
+                break;
+            }
+            case 0xad: case 0xaf: // lreturn, dreturn
+            {
+                frame.pc = offset;
+                poll_safepoint(polling_page);
+                if (!liberar_monitor_do_metodo(frame, ativacao.thread)) {
+                    handle_exception(frame, offset, EXC_ILLEGAL_MONITOR_STATE);
+                    break;
+                }
+                int64_t value = pop_jlong(frame);
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> return (Valor: {}l)", value);
+
+                jvm_stack.pop_back();
+                if (!jvm_stack.empty()) push_jlong(jvm_stack.back(), value);
+                break;
+            }
             case 0xb1: // return 
-                std::cout << " -> return. Fim do Frame." << std::endl;
-                return; 
+                frame.pc = offset;
+                poll_safepoint(polling_page);
+                if (!liberar_monitor_do_metodo(frame, ativacao.thread)) {
+                    handle_exception(frame, offset, EXC_ILLEGAL_MONITOR_STATE);
+                    break;
+                }
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> return. Fim do Frame.");
+                jvm_stack.pop_back();
+                break;
+
+            // --- TESTES DE TIPO ---
+            case 0xc0: // checkcast
+            {
+                uint16_t class_index = fetch_u2(frame);
+                jref ref = frame.operand_stack.back(); // A referência permanece na pilha
+                if (ref != 0) {
+                    RuntimeClass* target = resolver_classe(frame.method->owner, class_index);
+                    if (!is_subtype_of(heap[ref].klass, target)) {
+                        TRACE(TRACE_DISPATCH, TRACE_FINE, "-> checkcast #{} ({} nao e {})",
+                              class_index, heap[ref].klass->name, target->name);
+                        handle_exception(frame, offset, EXC_CLASS_CAST);
+                        break;
+                    }
+                }
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> checkcast #{} (Ref: {})", class_index, ref);
+                break;
+            }
+            case 0xc1: // instanceof
+            {
+                uint16_t class_index = fetch_u2(frame);
+                jref ref = pop_jword(frame);
+                jword result = 0;
+                if (ref != 0) {
+                    result = is_subtype_of(heap[ref].klass, resolver_classe(frame.method->owner, class_index)) ? 1 : 0;
+                }
+                push_jword(frame, result);
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> instanceof #{} (Ref: {}, Resultado: {})", class_index, ref, result);
+                break;
+            }
+
+            // --- MONITORES ---
+            case 0xc2: // monitorenter
+            {
+                jref ref = pop_jword(frame);
+                monitor_enter(heap[ref].lock_word, ativacao.thread); // null: falha na zona nula
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> monitorenter (Ref: {})", ref);
+                break;
+            }
+            case 0xc3: // monitorexit
+            {
+                jref ref = pop_jword(frame);
+                if (!monitor_exit(heap[ref].lock_word, ativacao.thread)) {
+                    handle_exception(frame, offset, EXC_ILLEGAL_MONITOR_STATE);
+                    break;
+                }
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> monitorexit (Ref: {})", ref);
+                break;
+            }
+
+            // --- EXCEÇÕES ---
+            case 0xbf: // athrow
+            {
+                jref exception = pop_jword(frame);
+                tocar_objeto(exception);
+
+                TRACE(TRACE_DISPATCH, TRACE_FINE, "-> athrow (Ref: {}, Classe: {})", exception, heap[exception].klass->name);
+                lancar_excecao(frame, offset, exception); // 'frame' pode deixar de ser válido
+                break;
+            }
 
             default:
                 std::cerr << std::endl << "ERRO: Opcode nao implementado: 0x" << std::hex << (int)opcode << std::dec << std::endl;
@@ -985,34 +1974,83 @@ void run_frame(Frame& frame) {
 // 4. FUNÇÃO DE COORDENAÇÃO (Chamada por jvm.cpp)
 // =======================================================================
 
-void executar_jvm(ClassFile& class_data) {
+// Exceção que chegou ao fim da thread principal: relatório no formato da JVM
+static int reportar_excecao_nao_tratada() {
+    jref exception = pending_exception;
+    pending_exception = 0;
+    FluxoSaida& err = fluxo_saida(2);
+    fluxo_flush(fluxo_saida(1));
+    std::cout.flush();
+    fluxo_escrever(err, "Exception in thread \"main\" ", 27);
+    imprimir_stack_trace(err, exception);
+    return 1;
+}
+
+// Pausas do coletor (gc.h)
+static void reportar_gc(const GcStats& stats) {
+    if (stats.menores > 0) {
+        std::cout << "\t[GC] " << stats.menores << " coletas menores. Pausa media: "
+                  << (stats.menores_ns / stats.menores / 1000) << " us, maxima: " << (stats.menores_max_ns / 1000)
+                  << " us. Promovidos: " << (stats.promovidos / 1024) << " KiB" << std::endl;
+    }
+    if (stats.coletas > 0) {
+        std::cout << "\t[GC] " << stats.coletas << " coletas completas. Pausa media: "
+                  << (stats.total_ns / stats.coletas / 1000) << " us, maxima: " << (stats.max_ns / 1000)
+                  << " us. Liberados: " << (stats.liberados / 1024) << " KiB" << std::endl;
+    }
+}
+
+// Métrica de time-to-safepoint da thread principal
+static void reportar_safepoints(const SafepointStats& stats) {
+    if (stats.count == 0) return;
+    std::cout << "\t[SAFEPOINT] " << stats.count << " safepoints. TTS medio: " << (stats.total_ns / stats.count)
+              << " ns, maximo: " << stats.max_ns << " ns" << std::endl;
+}
+
+int executar_jvm(ClassFile& class_data) {
     // 1. Encontrar o método main
-    MethodInfo* main_method = nullptr;
-    for (auto& method : class_data.methods) {
-        if (get_utf8(class_data.constant_pool, method.name_index) == "main" &&
-            get_utf8(class_data.constant_pool, method.descriptor_index) == "([Ljava/lang/String;)V" &&
+    RuntimeClass* main_class = carregar_classe(get_class_name(class_data.constant_pool, class_data.this_class_idx));
+    RuntimeMethod* main_method = nullptr;
+    for (auto& method : main_class->methods) {
+        if (method.name == "main" &&
+            method.descriptor == "([Ljava/lang/String;)V" &&
             (method.access_flags & ACC_STATIC)) {
             main_method = &method;
             break;
         }
     }
 
-    if (!main_method || main_method->code_attribute.code_length == 0) {
+    if (!main_method || !main_method->has_code()) {
         throw std::runtime_error("Nao foi encontrado o metodo 'main' executavel na classe.");
     }
     
-    // --- CORREÇÃO: RESERVAR O SLOT 0 DO HEAP PARA NULL ---
-    // Garante que todas as referências válidas serão > 0.
-    if (heap.empty()) {
-        heap.push_back({}); // Adiciona um objeto vazio para ser a Referência NULL (índice 0)
-    }
+    // Heap: a zona nula no deslocamento 0 garante que todas as referências válidas serão > 0
+    heap.reservar();
+    gc_iniciar();
+    preparar_excecoes_vm();
 
-    // 2. Inicializar o Frame de main 
-    Frame main_frame(*main_method, class_data.constant_pool);
+    // 2. Inicializar a classe principal e o Frame de main (a pilha é mapeada: Frames não mudam de endereço)
+    JavaThread* thread = criar_java_thread(MAX_JVM_STACK_DEPTH * (sizeof(Frame) + FRAME_SLOTS_MEDIOS * sizeof(jword)));
+    jvm_stack.associar(thread);
+    if (const char* intervalo = std::getenv("JVM_SAFEPOINT_INTERVAL_MS")) {
+        iniciar_safepoints_periodicos(thread, (unsigned)std::atoi(intervalo));
+    }
+    perfil_iniciar(thread);
+    if (!inicializar_classe(main_class)) return reportar_excecao_nao_tratada();
+    adquirir_monitor_do_metodo(jvm_stack.emplace_back(*main_method));
     
     // 3. Executar o Frame
     std::cout << "\n--- Iniciando a execucao de main ---" << std::endl;
-    run_frame(main_frame);
-    
+    run_frame(jvm_stack.back());
+
+    // Fim do programa: a saída bufferizada de System.out/err precede todas as mensagens da VM
+    descarregar_saidas();
+    iniciar_safepoints_periodicos(thread, 0);
+    reportar_safepoints(thread->safepoints);
+    reportar_gc(gc_estatisticas());
+    perfil_finalizar();
+    if (pending_exception != 0) return reportar_excecao_nao_tratada();
+
     std::cout << "Execucao concluida. Pilha de execução vazia." << std::endl;
-}
\ No newline at end of file
+    return 0;
+}
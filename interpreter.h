@@ -12,6 +12,11 @@
 #define T_LONG    11
 
 #include "classfile.h" 
+#include "runtime.h"
+#include "thread.h"
+#include "monitor.h"
+#include <new>
+#include <cstring>
 #include <vector>
 #include <cstdint>
 #include <stdexcept>
@@ -22,44 +27,238 @@
 
 typedef uint32_t jword;
 
-// Endereço do objeto no Heap (Referência da JVM)
+// Referência da JVM: deslocamento em bytes do objeto a partir da base do heap (0: null)
 typedef jword jref; 
 
-// Estrutura para simular um Objeto/Array no Heap
+/**
+ * @brief Cabeçalho compacto de um objeto no heap (24 bytes). Os campos de
+ * instância ou os elementos vêm logo depois, na mesma alocação; a forma do
+ * objeto (instância, array ou String) e o tamanho dos dados saem da classe.
+ */
 struct HeapObject {
-    // 0: Objeto de Classe | 1: Array de Primitivos | 2: Array de Referências | 3: String
-    int type; 
-    size_t size; // Tamanho total em unidades de jword (campos ou elementos do array).
-    std::vector<jword> data; // Os dados reais (campos de instância, elementos).
-    std::string class_name;  // Nome resolvido da classe (essencial para polimorfismo)
+    LockWord lock_word{LOCK_UNLOCKED}; // Thin lock ou monitor inflado (monitor.h)
+    RuntimeClass* klass;     // Classe do objeto: despacho virtual, testes de tipo e layout
+    uint32_t length;         // Arrays e Strings: número de elementos (0 nas instâncias)
+    uint32_t hash;           // Hash de identidade (0: ainda não pedido)
 
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(this + 1); }
+    jword* data() { return reinterpret_cast<jword*>(this + 1); }
 };
 
-// Estrutura do Frame de Pilha (Stack Frame)
+static_assert(sizeof(HeapObject) == 24, "cabecalho de objeto deve ter 24 bytes");
+
+/**
+ * Strings: os dados começam pelo String.hashCode em cache (0: ainda não
+ * calculado), seguido dos chars. Com STRING_UTF16 ligado em 'length', cada char
+ * ocupa 2 bytes; senão todos cabem em Latin-1 e ocupam 1 byte. Uma String que
+ * cabe em Latin-1 nunca é criada em UTF-16: codificações diferentes já indicam
+ * conteúdos diferentes.
+ */
+#define STRING_UTF16        0x80000000u
+#define STRING_HASH_BYTES   4
+
+inline uint32_t string_length(const HeapObject& s) { return s.length & ~STRING_UTF16; }
+inline bool string_utf16(const HeapObject& s) { return (s.length & STRING_UTF16) != 0; }
+inline uint8_t* string_chars(HeapObject& s) { return s.bytes() + STRING_HASH_BYTES; }
+
+inline uint16_t string_char_at(HeapObject& s, uint32_t i) {
+    if (!string_utf16(s)) return string_chars(s)[i];
+    uint16_t c;
+    std::memcpy(&c, string_chars(s) + 2 * (size_t)i, 2);
+    return c;
+}
+
+// Bytes ocupados no heap (cabeçalho e dados, múltiplo de 8); Strings: 'length' com o bit de codificação
+inline size_t tamanho_objeto(const RuntimeClass* klass, uint32_t length) {
+    size_t dados;
+    switch (klass->layout) {
+        case LAYOUT_INSTANCE: dados = klass->instance_size; break;
+        case LAYOUT_STRING:   dados = STRING_HASH_BYTES + (size_t)(length & ~STRING_UTF16) * ((length & STRING_UTF16) ? 2 : 1); break;
+        default:              dados = (size_t)length * klass->element_size; break;
+    }
+    return (sizeof(HeapObject) + dados + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Faixa de slots de um frame na região da pilha Java, com a interface de
+ * vector que o interpretador usa. Não aloca nem libera: a capacidade (max_locals
+ * ou max_stack) foi reservada junto do Frame, e push_back não a verifica.
+ */
+class SlotsFrame {
+public:
+    SlotsFrame(jword* base, size_t size) : base_(base), topo_(base + size) {}
+
+    size_t size() const { return (size_t)(topo_ - base_); }
+    bool empty() const { return topo_ == base_; }
+    jword& operator[](size_t i) { return base_[i]; }
+    const jword& operator[](size_t i) const { return base_[i]; }
+    jword& at(size_t i) {
+        if (i >= size()) throw std::out_of_range("Slot " + std::to_string(i) + " fora do frame");
+        return base_[i];
+    }
+    jword& back() { return topo_[-1]; }
+    jword* begin() { return base_; }
+    jword* end() { return topo_; }
+
+    void push_back(jword value) { *topo_++ = value; }
+    void pop_back() { --topo_; }
+    void clear() { topo_ = base_; }
+    void resize(size_t n) {
+        if (n > size()) std::memset(topo_, 0, (n - size()) * sizeof(jword));
+        topo_ = base_ + n;
+    }
+
+private:
+    jword* base_;
+    jword* topo_;
+};
+
+// Slots acima de max_stack: o receptor que um nativo empilha para chamar bytecode (toString da concatenação)
+#define FRAME_SLOTS_EXTRA 1
+
+// Estrutura do Frame de Pilha (Stack Frame): os slots vêm logo depois dele na pilha (PilhaJava)
 struct Frame {
-    std::vector<jword> local_variables;
-    std::vector<jword> operand_stack;
+    SlotsFrame local_variables; // max_locals slots
+    SlotsFrame operand_stack;   // max_stack (+ FRAME_SLOTS_EXTRA) slots, depois dos locais
     uint32_t pc;
     const std::vector<uint8_t>* code;
     const std::vector<CodeAttribute::ExceptionTableEntry>* exception_table;
     const ConstantPool* class_constant_pool;
+    RuntimeMethod* method;   // Método em execução (classe dona e cache do CP)
+    uint32_t call_pc;        // pc do último invoke (ou inicialização de classe) feito por este frame
+    uint32_t instr_pc;       // Início da instrução em execução: pc das exceções implícitas (SIGSEGV)
+    jref monitor;            // Lock de um método synchronized, liberado ao desempilhar (0: nenhum)
     
-    Frame(const MethodInfo& method, const ConstantPool& cp);
+    Frame(RuntimeMethod& method, jword* slots);
+};
+
+// Bytes de um frame de 'method' na pilha: o Frame seguido dos seus slots, alinhado para o próximo
+inline size_t extensao_frame(const RuntimeMethod& method) {
+    const CodeAttribute& code = method.info->code_attribute;
+    const size_t slots = (size_t)code.max_locals + code.max_stack + FRAME_SLOTS_EXTRA;
+    return (sizeof(Frame) + slots * sizeof(jword) + alignof(Frame) - 1) & ~(alignof(Frame) - 1);
+}
+
+// Profundidade da jvm_stack (região mapeada de uma vez: referências a Frames não invalidam)
+#define MAX_JVM_STACK_DEPTH 1024
+#define FRAME_SLOTS_MEDIOS  32   // Slots por frame no dimensionamento da região da pilha
+#define PILHA_SONDAGEM      4096 // Passo da sondagem de um frame (a menor página)
+
+/**
+ * @brief Pilha de Frames sobre a região mapeada da JavaThread (thread.h). Cada
+ * frame ocupa extensao_frame(method) bytes, com os locais e os operandos logo
+ * depois do Frame; 'frames_' indexa os frames empilhados.
+ * emplace_back não verifica a capacidade: o estouro é detectado pela zona
+ * amarela. Caminhos que não podem ser interrompidos por um sinal (<clinit>,
+ * chamadas a partir de nativos) consultam tem_espaco() antes de empilhar.
+ */
+class PilhaJava {
+public:
+    PilhaJava() : topo_(nullptr), limite_(nullptr) {}
+
+    void associar(JavaThread* thread) {
+        topo_ = thread->stack_base;
+        limite_ = thread->stack_limit;
+        // Um frame ocupa ao menos sizeof(Frame): o índice não cresce depois daqui
+        frames_.reserve((size_t)(limite_ - topo_) / sizeof(Frame));
+    }
+
+    Frame& emplace_back(RuntimeMethod& method) {
+        uint8_t* slot = topo_;
+        uint8_t* fim = slot + extensao_frame(method);
+        // Toca a extensão em ordem crescente, uma vez por página, até o último byte: se ela
+        // cruza a zona amarela, falha aqui (antes da construção), nunca direto na vermelha
+        for (uint8_t* p = slot + PILHA_SONDAGEM - 1; p < fim; p += PILHA_SONDAGEM) {
+            *reinterpret_cast<volatile uint8_t*>(p) = 0;
+        }
+        *(reinterpret_cast<volatile uint8_t*>(fim) - 1) = 0;
+        Frame* frame = new (slot) Frame(method, reinterpret_cast<jword*>(slot + sizeof(Frame)));
+        frames_.push_back(frame);
+        topo_ = fim;
+        return *frame;
+    }
+
+    void pop_back() {
+        Frame* frame = frames_.back();
+        frames_.pop_back();
+        frame->~Frame();
+        topo_ = reinterpret_cast<uint8_t*>(frame);
+    }
+
+    // Desempilha até restar 'depth' frames
+    void truncar(size_t depth) {
+        while (size() > depth) pop_back();
+    }
+
+    bool tem_espaco(const RuntimeMethod& method) const { return topo_ + extensao_frame(method) <= limite_; }
+
+    // Posição de um frame empilhado (procura a partir do topo)
+    size_t indice(const Frame& frame) const {
+        size_t i = frames_.size();
+        while (i > 0 && frames_[i - 1] != &frame) i--;
+        return i - 1;
+    }
+
+    Frame& back() { return *frames_.back(); }
+    Frame& operator[](size_t i) { return *frames_[i]; }
+    size_t size() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+
+private:
+    uint8_t* topo_;
+    uint8_t* limite_;
+    std::vector<Frame*> frames_;
 };
 
 // A Pilha da JVM (global para thread principal)
-extern std::vector<Frame> jvm_stack;
+extern PilhaJava jvm_stack;
 
-// O Heap Simulado: O índice no vetor é a referência (jref).
-extern std::vector<HeapObject> heap; 
+// Zona nula no início do heap (PROT_NONE): acessos por ref 0 a deslocamentos menores
+// que ela falham e viram NullPointerException, sem comparação no caminho comum
+#define HEAP_NULL_ZONE      (64 * 1024)
+#define HEAP_RESERVE        (1ull << 32)      // Espaço de endereços reservado: jref de 32 bits
+#define HEAP_COMMIT_CHUNK   (1024 * 1024)     // Páginas liberadas para escrita a cada avanço
+#define HEAP_NURSERY_RESERVE (256ull << 20)   // Fim da reserva: berçário da coleta geracional (gc.h)
+#define HEAP_NURSERY_BASE   (HEAP_RESERVE - HEAP_NURSERY_RESERVE)
 
-// Method Area: Mapa de Nome da Classe -> ClassFile carregado
-#include <map>
-#include <string>
-extern std::map<std::string, ClassFile> method_area;
+/**
+ * @brief Heap numa região de endereços reservada de uma vez; a referência é o
+ * deslocamento do objeto a partir da base, de modo que heap[ref] é uma soma.
+ * alocar() avança o topo da geração antiga, que cresce a partir da zona nula até
+ * HEAP_NURSERY_BASE; o berçário (no fim da reserva) é do GC (gc.h). Objetos
+ * antigos nunca mudam de lugar. Acima do topo, a memória está zerada.
+ */
+class HeapJava {
+public:
+    HeapJava() : base_(nullptr), topo_(0), comprometido_(0) {}
 
-// Função para obter (ou carregar) uma classe
-ClassFile* get_class_from_method_area(const std::string& class_name); 
+    // Reserva a região e protege a zona nula (chamada uma vez, antes da primeira alocação)
+    void reservar();
+
+    // 'bytes' (cabeçalho incluído, arredondado a 8) para um novo objeto, construído pelo chamador
+    jref alocar(size_t bytes);
+
+    // Devolve o fim do heap a partir de 'novo_topo' (espaço livre no topo encontrado pela varredura)
+    void recuar(size_t novo_topo);
+
+    HeapObject& operator[](jref ref) { return *reinterpret_cast<HeapObject*>(base_ + ref); }
+
+    uint8_t* base() const { return base_; }
+    size_t topo() const { return topo_; }
+
+private:
+    uint8_t* base_;
+    size_t topo_;          // Próximo deslocamento livre
+    size_t comprometido_;  // Fim da parte com leitura e escrita
+};
+
+// O Heap da JVM
+extern HeapJava heap;
+
+// Verificação implícita de null: lê o cabeçalho do objeto (ref 0 cai na zona nula)
+inline void tocar_objeto(jref ref) {
+    (void)*reinterpret_cast<const volatile uint8_t*>(&heap[ref]);
+}
 
 // =======================================================================
 // 2. PROTÓTIPOS DE FUNÇÕES DE MANIPULAÇÃO DE DADOS
@@ -80,14 +279,90 @@ int64_t pop_jlong(Frame& frame);
 void push_jdouble(Frame& frame, double value);
 double pop_jdouble(Frame& frame);
 
-// Funções de Gerenciamento de Heap
-jref allocate_heap_object(int type, size_t size, std::string class_name);
+// Funções de Gerenciamento de Heap: instância de 'klass' ou, para arrays e Strings, com 'length' elementos
+jref allocate_heap_object(RuntimeClass* klass, uint32_t length = 0);
+
+// Strings: cria um objeto String a partir de UTF-8 (Latin-1 se couber) / lê o conteúdo em UTF-8
+jref criar_string_literal(const std::string& literal);
+std::string texto_string(jref string_ref);
+
+// String com os 'n' chars UTF-16 dados, compactada em Latin-1 quando todos cabem
+jref criar_string(const uint16_t* chars, size_t n);
+
+// Chars UTF-16 de um texto UTF-8 (inclusive o UTF-8 modificado dos class files)
+std::vector<uint16_t> decodificar_utf8(const std::string& texto);
+
+/**
+ * @brief Instância única da String de conteúdo 'literal' (UTF-8): ldc e constantes
+ * estáticas. O slot devolvido é uma raiz do GC e tem endereço fixo: o cache do
+ * CP guarda o slot, e a referência atual é sempre lida dele.
+ */
+jref* internar_literal(const std::string& literal);
+
+// String.intern: a instância já internada de mesmo conteúdo, ou 'ref' passa a ser ela
+jref internar_string(jref ref);
+
+// Exceções lançadas pela própria JVM: uma instância pré-alocada de cada, reutilizada a cada lançamento
+enum ExcecaoVM {
+    EXC_ARITHMETIC,
+    EXC_NULL_POINTER,
+    EXC_ARRAY_INDEX,
+    EXC_NEGATIVE_ARRAY_SIZE,
+    EXC_CLASS_CAST,
+    EXC_STACK_OVERFLOW,
+    EXC_ILLEGAL_MONITOR_STATE,
+    EXC_VERIFY,
+    EXC_INTERNAL,
+    EXC_COUNT
+};
+
+// Aloca as instâncias das exceções da JVM (chamada uma vez, antes da execução)
+void preparar_excecoes_vm();
+
+// Exceção que atravessou o frame de entrada de uma ativação de run_frame (0: nenhuma)
+extern jref pending_exception;
+
+/**
+ * @brief Lança a exceção 'exception' na instrução 'pc' do frame (o topo da jvm_stack).
+ * Se um handler compatível cobre o pc, ajusta o PC, limpa a pilha e empilha a exceção.
+ * Senão, desempilha o frame e repete a busca no chamador, no pc do seu invoke. Ao passar
+ * do frame de entrada da ativação corrente, a exceção fica em 'pending_exception'.
+ */
+void lancar_excecao(Frame& frame, uint32_t pc, jref exception);
+
+// Lança uma exceção da JVM usando a instância pré-alocada
+void handle_exception(Frame& frame, uint32_t pc, ExcecaoVM kind);
+
+/**
+ * @brief Cria uma instância de Throwable com mensagem (vazia: null), causa e o
+ * backtrace da jvm_stack atual. Usada pelos nativos e pela inicialização de classes.
+ */
+jref criar_excecao(const char* class_name, const std::string& message, jref cause);
+
+/**
+ * @brief Inicializa a classe conforme a JVMS 5.5 (superclasse, ConstantValue e
+ * <clinit>), de forma segura entre threads. Retorna imediatamente se a classe
+ * já estiver inicializada ou em inicialização pela própria thread.
+ * @return false se a inicialização falhou; a exceção fica em 'pending_exception'.
+ */
+bool inicializar_classe(RuntimeClass* cls);
 
 // =======================================================================
 // 3. PROTÓTIPOS DE EXECUÇÃO PRINCIPAL
 // =======================================================================
 
+// Executa o frame (que deve estar na jvm_stack) e os frames que ele empilhar, até que ele retorne
 void run_frame(Frame& frame);
-void executar_jvm(ClassFile& class_data);
+
+/**
+ * @brief Chama um método com bytecode a partir de código nativo, numa ativação aninhada
+ * do interpretador. Os argumentos (e o receptor) estão no topo da pilha de operandos
+ * de 'caller'; o retorno é empilhado nela.
+ * @return false se o método terminou com uma exceção, já lançada em 'caller' no 'pc'.
+ */
+bool invocar_metodo_java(Frame& caller, uint32_t pc, RuntimeMethod* method, bool has_this);
+
+// Executa o main da classe; retorna o status de saída (1 se uma exceção não foi tratada)
+int executar_jvm(ClassFile& class_data);
 
 #endif // INTERPRETER_H
\ No newline at end of file
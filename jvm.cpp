@@ -10,6 +10,7 @@
 #include "classfile.h"      // Leitura e Estruturas
 #include "disassembler.h"   // Exibição e Desmontagem
 #include "interpreter.h"    // Execução e Runtime (Corretude)
+#include "printstream.h"    // Descarga de System.out/err antes das mensagens da VM
 
 /**
  * @brief Função principal da Máquina Virtual Java (JVM).
@@ -43,11 +44,11 @@ int main(int argc, char* argv[]) {
         ler_class_file(filename, class_data); 
         std::cout << "✅ Leitura do arquivo .class concluída com sucesso." << std::endl;
 
-        // REGISTRAR NA METHOD AREA
+        // REGISTRAR NA METHOD AREA (e ligar a classe: hierarquia e CHA)
         std::string class_name = get_class_name(class_data.constant_pool, class_data.this_class_idx);
-        method_area[class_name] = std::move(class_data);
-        // Nota: class_data agora está vazio (move), usamos a referência do map
-        ClassFile& loaded_class = method_area[class_name];
+        RuntimeClass* runtime_class = registrar_classe(class_name, std::move(class_data));
+        // Nota: class_data agora está vazio (move), usamos a referência da Method Area
+        ClassFile& loaded_class = *runtime_class->class_file;
 
         // --- 3. FASE DE CONTROLE E EXECUÇÃO ---
         if (flag == "-display") {
@@ -55,16 +56,19 @@ int main(int argc, char* argv[]) {
             std::cout << "\n--- Modo: EXIBIDOR/DESMONTAGEM ---" << std::endl;
             
             // Exibir cabeçalho e informações gerais
-            exibir_class_info(class_data);
+            exibir_class_info(loaded_class);
             
             // Exibir Constant Pool (Parte essencial da avaliação)
-            exibir_constant_pool(class_data.constant_pool);
+            exibir_constant_pool(loaded_class.constant_pool);
             
             // Exibir Fields
-            exibir_fields(class_data);
+            exibir_fields(loaded_class);
             
             // Exibir Methods (Isso chama a desmontagem do bytecode)
-            exibir_methods(class_data);
+            exibir_methods(loaded_class);
+
+            // Exibir BootstrapMethods (invokedynamic)
+            exibir_bootstrap_methods(loaded_class);
             
             std::cout << "\n==================================================" << std::endl;
             std::cout << "Exibicao Concluida." << std::endl;
@@ -75,11 +79,12 @@ int main(int argc, char* argv[]) {
             std::cout << "\n--- Modo: INTERPRETADOR (EXECUÇÃO) ---" << std::endl;
             
             // Chama a função principal de execução do módulo interpreter.cpp
-            executar_jvm(loaded_class); 
+            int status = executar_jvm(loaded_class); 
 
             std::cout << "\n==================================================" << std::endl;
             std::cout << "Execucao Concluida." << std::endl;
             std::cout << "==================================================" << std::endl;
+            return status;
 
         } else {
             std::cerr << "ERRO: Flag de operacao desconhecida: " << flag << std::endl;
@@ -87,7 +92,8 @@ int main(int argc, char* argv[]) {
         }
 
     } catch (const std::exception& e) {
-        // Captura e reporta erros de I/O, formato, ou runtime da JVM
+        // Captura e reporta erros de I/O, formato, ou runtime da JVM (depois do que o programa já escreveu)
+        descarregar_saidas();
         std::cerr << "\n==================================================" << std::endl;
         std::cerr << "❌ ERRO FATAL: " << e.what() << std::endl;
         std::cerr << "==================================================" << std::endl;
@@ -0,0 +1,264 @@
+// monitor.cpp
+
+#include "monitor.h"
+#include "gc.h"
+#include "trace.h"
+#include <chrono>
+
+// =======================================================================
+// 1. PALAVRA DE LOCK
+// =======================================================================
+
+#define LOCK_RECURSION_ONE ((uintptr_t)1 << LOCK_RECURSION_SHIFT)
+#define LOCK_RECURSION_MAX ((uint32_t)(LOCK_RECURSION_MASK >> LOCK_RECURSION_SHIFT))
+
+static inline uintptr_t palavra_thin(uint32_t owner) {
+    return ((uintptr_t)owner << LOCK_OWNER_SHIFT) | LOCK_THIN;
+}
+
+static inline uint32_t dono_thin(uintptr_t word) {
+    return (uint32_t)(word >> LOCK_OWNER_SHIFT);
+}
+
+static inline uint32_t recursoes_thin(uintptr_t word) {
+    return (uint32_t)((word & LOCK_RECURSION_MASK) >> LOCK_RECURSION_SHIFT);
+}
+
+static inline Monitor* monitor_de(uintptr_t word) {
+    return reinterpret_cast<Monitor*>(word & ~LOCK_TAG_MASK);
+}
+
+static inline void pausar_spin() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * @brief Troca a palavra 'observed' por um monitor inflado que herda a posse
+ * (dono e recursões) do thin lock.
+ * @return nullptr se a palavra mudou nesse meio tempo: o chamador relê e tenta de novo.
+ */
+static Monitor* inflar(LockWord& lock_word, uintptr_t observed) {
+    Monitor* monitor = new Monitor();
+    if ((observed & LOCK_TAG_MASK) == LOCK_THIN) {
+        monitor->owner.store(dono_thin(observed), std::memory_order_relaxed);
+        monitor->recursions = recursoes_thin(observed);
+    }
+    if (lock_word.compare_exchange_strong(observed, reinterpret_cast<uintptr_t>(monitor) | LOCK_INFLATED,
+                                          std::memory_order_acq_rel)) {
+        TRACE(TRACE_MONITOR, TRACE_INFO, "Lock inflado (Monitor: {})", monitor);
+        gc_monitor_inflado(lock_word);
+        return monitor;
+    }
+    delete monitor;
+    return nullptr;
+}
+
+// =======================================================================
+// 2. MONITOR INFLADO
+// =======================================================================
+
+// Fila de entrada: bloqueia no mutex do monitor até conseguir a posse
+static void aguardar_posse(Monitor* monitor, std::unique_lock<std::mutex>& lock, uint32_t self) {
+    monitor->bloqueados++;
+    uint32_t livre = 0;
+    while (!monitor->owner.compare_exchange_strong(livre, self, std::memory_order_acquire)) {
+        livre = 0;
+        monitor->entrada.wait(lock);
+    }
+    monitor->bloqueados--;
+}
+
+/**
+ * @brief Spin adaptativo antes de bloquear: se o spin anterior conseguiu a posse,
+ * o próximo pode girar mais (o dono costuma sair logo); se não, gira menos.
+ */
+static void entrar_inflado(Monitor* monitor, uint32_t self) {
+    if (monitor->owner.load(std::memory_order_relaxed) == self) {
+        monitor->recursions++;
+        return;
+    }
+
+    const int limite = monitor->spin_limit.load(std::memory_order_relaxed);
+    for (int i = 0; i < limite; i++) {
+        uint32_t livre = 0;
+        if (monitor->owner.load(std::memory_order_relaxed) == 0 &&
+            monitor->owner.compare_exchange_weak(livre, self, std::memory_order_acquire)) {
+            if (limite < MONITOR_SPIN_MAX) monitor->spin_limit.store(limite * 2, std::memory_order_relaxed);
+            return;
+        }
+        pausar_spin();
+    }
+    if (limite > MONITOR_SPIN_MIN) monitor->spin_limit.store(limite / 2, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(monitor->mutex);
+    aguardar_posse(monitor, lock, self);
+}
+
+static void sair_inflado(Monitor* monitor) {
+    if (monitor->recursions > 0) {
+        monitor->recursions--;
+        return;
+    }
+    // A posse é liberada fora do mutex; quem está na fila testa 'owner' com o mutex,
+    // então a notificação abaixo não se perde
+    monitor->owner.store(0, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(monitor->mutex);
+    if (monitor->bloqueados > 0) monitor->entrada.notify_one();
+}
+
+// =======================================================================
+// 3. monitorenter / monitorexit
+// =======================================================================
+
+void monitor_enter(LockWord& lock_word, JavaThread* self) {
+    const uint32_t id = self->id;
+
+    // Caminho rápido (sem contenção): um único CAS
+    uintptr_t word = LOCK_UNLOCKED;
+    if (lock_word.compare_exchange_strong(word, palavra_thin(id), std::memory_order_acquire)) return;
+
+    int spins = 0;
+    for (;;) {
+        switch (word & LOCK_TAG_MASK) {
+            case LOCK_UNLOCKED:
+                if (lock_word.compare_exchange_weak(word, palavra_thin(id), std::memory_order_acquire)) return;
+                break;
+
+            case LOCK_THIN:
+                if (dono_thin(word) == id) {
+                    // Reentrada: só a dona altera o contador, mas o CAS detecta uma inflação concorrente
+                    if (recursoes_thin(word) < LOCK_RECURSION_MAX) {
+                        if (lock_word.compare_exchange_weak(word, word + LOCK_RECURSION_ONE, std::memory_order_relaxed)) return;
+                    } else if (inflar(lock_word, word) == nullptr) {
+                        word = lock_word.load(std::memory_order_acquire);
+                    }
+                    break;
+                }
+                // Contenção: espera curta pela liberação do thin lock; depois infla
+                if (spins++ < MONITOR_SPIN_MIN) {
+                    pausar_spin();
+                    word = lock_word.load(std::memory_order_relaxed);
+                } else {
+                    inflar(lock_word, word);
+                    word = lock_word.load(std::memory_order_acquire);
+                }
+                break;
+
+            default: // LOCK_INFLATED
+                entrar_inflado(monitor_de(word), id);
+                return;
+        }
+    }
+}
+
+bool monitor_exit(LockWord& lock_word, JavaThread* self) {
+    const uint32_t id = self->id;
+    uintptr_t word = lock_word.load(std::memory_order_relaxed);
+    for (;;) {
+        switch (word & LOCK_TAG_MASK) {
+            case LOCK_THIN: {
+                if (dono_thin(word) != id) return false;
+                uintptr_t novo = recursoes_thin(word) > 0 ? word - LOCK_RECURSION_ONE : LOCK_UNLOCKED;
+                if (lock_word.compare_exchange_weak(word, novo, std::memory_order_release, std::memory_order_relaxed)) return true;
+                break; // Inflado por outra thread (ou falha espúria): relê
+            }
+            case LOCK_INFLATED: {
+                Monitor* monitor = monitor_de(word);
+                if (monitor->owner.load(std::memory_order_relaxed) != id) return false;
+                sair_inflado(monitor);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+// =======================================================================
+// 4. wait / notify
+// =======================================================================
+
+// Monitor inflado de um lock que a thread possui (infla um thin lock; nullptr: não é a dona)
+static Monitor* monitor_possuido(LockWord& lock_word, uint32_t id) {
+    uintptr_t word = lock_word.load(std::memory_order_acquire);
+    for (;;) {
+        switch (word & LOCK_TAG_MASK) {
+            case LOCK_THIN: {
+                if (dono_thin(word) != id) return nullptr;
+                Monitor* monitor = inflar(lock_word, word);
+                if (monitor) return monitor;
+                word = lock_word.load(std::memory_order_acquire);
+                break;
+            }
+            case LOCK_INFLATED: {
+                Monitor* monitor = monitor_de(word);
+                return monitor->owner.load(std::memory_order_relaxed) == id ? monitor : nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+}
+
+ResultadoMonitor monitor_wait(LockWord& lock_word, JavaThread* self, int64_t timeout_ms) {
+    Monitor* monitor = monitor_possuido(lock_word, self->id);
+    if (!monitor) return MONITOR_NOT_OWNER;
+
+    // Libera a posse por completo (inclusive reentradas) e entra no wait set
+    const uint32_t recursions = monitor->recursions;
+    std::unique_lock<std::mutex> lock(monitor->mutex);
+    monitor->recursions = 0;
+    monitor->owner.store(0, std::memory_order_release);
+    if (monitor->bloqueados > 0) monitor->entrada.notify_one();
+
+    monitor->esperando++;
+    auto notificado = [monitor] { return monitor->sinais > 0; };
+    bool sinalizado;
+    if (timeout_ms > 0) {
+        sinalizado = monitor->espera.wait_for(lock, std::chrono::milliseconds(timeout_ms), notificado);
+    } else {
+        monitor->espera.wait(lock, notificado);
+        sinalizado = true;
+    }
+    if (sinalizado) monitor->sinais--;
+    monitor->esperando--;
+
+    aguardar_posse(monitor, lock, self->id);
+    monitor->recursions = recursions;
+    return MONITOR_OK;
+}
+
+ResultadoMonitor monitor_notify(LockWord& lock_word, JavaThread* self, bool todos) {
+    uintptr_t word = lock_word.load(std::memory_order_acquire);
+    switch (word & LOCK_TAG_MASK) {
+        case LOCK_THIN:
+            // Thin lock não tem wait set (wait sempre infla): nada a acordar
+            return dono_thin(word) == self->id ? MONITOR_OK : MONITOR_NOT_OWNER;
+        case LOCK_INFLATED: {
+            Monitor* monitor = monitor_de(word);
+            if (monitor->owner.load(std::memory_order_relaxed) != self->id) return MONITOR_NOT_OWNER;
+
+            std::lock_guard<std::mutex> lock(monitor->mutex);
+            if (todos) {
+                monitor->sinais = monitor->esperando;
+                monitor->espera.notify_all();
+            } else if (monitor->sinais < monitor->esperando) {
+                monitor->sinais++;
+                monitor->espera.notify_one();
+            }
+            return MONITOR_OK;
+        }
+        default:
+            return MONITOR_NOT_OWNER;
+    }
+}
+
+void monitor_descartar(LockWord& lock_word) {
+    uintptr_t word = lock_word.load(std::memory_order_relaxed);
+    if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) delete monitor_de(word);
+    lock_word.store(LOCK_UNLOCKED, std::memory_order_relaxed);
+}
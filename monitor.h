@@ -0,0 +1,82 @@
+// monitor.h
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "thread.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// =======================================================================
+// MONITORES: THIN LOCKS NO CABEÇALHO DO OBJETO, INFLADOS SOB CONTENÇÃO
+// =======================================================================
+
+/**
+ * @brief Palavra de lock do cabeçalho de cada objeto. Os 2 bits baixos são a etiqueta:
+ *
+ *   00  livre
+ *   01  thin lock: [id da thread dona : 32][recursões : 30][01]
+ *   10  inflado:   ponteiro para o Monitor | 10
+ *
+ * O caminho sem contenção é um único CAS livre -> thin; a reentrada pela dona
+ * só incrementa o contador. A inflação acontece apenas quando outra thread
+ * esgota o spin sobre um thin lock, ou para wait/notify.
+ */
+typedef std::atomic<uintptr_t> LockWord;
+
+#define LOCK_UNLOCKED        ((uintptr_t)0)
+#define LOCK_THIN            ((uintptr_t)1)
+#define LOCK_INFLATED        ((uintptr_t)2)
+#define LOCK_TAG_MASK        ((uintptr_t)3)
+#define LOCK_RECURSION_SHIFT 2
+#define LOCK_RECURSION_MASK  ((uintptr_t)0x3FFFFFFF << LOCK_RECURSION_SHIFT)
+#define LOCK_OWNER_SHIFT     32
+
+// Limites do spin adaptativo (iterações antes de bloquear no mutex do monitor)
+#define MONITOR_SPIN_MIN   16
+#define MONITOR_SPIN_MAX   4096
+
+/**
+ * @brief Monitor inflado, apoiado em mutex e variáveis de condição do SO.
+ * 'owner' é o id da thread dona (0: livre); o mutex protege apenas as filas
+ * (entrada e wait set), não a posse. Monitores não são desinflados.
+ */
+struct Monitor {
+    std::atomic<uint32_t> owner;
+    uint32_t recursions;             // Reentradas além da primeira (só a dona altera)
+    std::atomic<int> spin_limit;     // Ajustado pelo sucesso dos spins anteriores
+
+    std::mutex mutex;
+    std::condition_variable entrada; // Threads bloqueadas em monitorenter
+    std::condition_variable espera;  // Wait set
+    uint32_t bloqueados;
+    uint32_t esperando;
+    uint32_t sinais;                 // notify ainda não consumidos por threads do wait set
+
+    Monitor() : owner(0), recursions(0), spin_limit(MONITOR_SPIN_MIN), bloqueados(0), esperando(0), sinais(0) {}
+};
+
+// Resultado de monitor_wait (exceções são lançadas por quem chama)
+enum ResultadoMonitor {
+    MONITOR_OK,
+    MONITOR_NOT_OWNER // IllegalMonitorStateException
+};
+
+// monitorenter (e entrada de métodos synchronized). Bloqueia até obter o lock.
+void monitor_enter(LockWord& lock_word, JavaThread* self);
+
+// monitorexit (e saída de métodos synchronized). false: a thread não é a dona.
+bool monitor_exit(LockWord& lock_word, JavaThread* self);
+
+// Object.wait: libera o lock por completo e o readquire. 'timeout_ms' 0: sem prazo.
+ResultadoMonitor monitor_wait(LockWord& lock_word, JavaThread* self, int64_t timeout_ms);
+
+// Object.notify / notifyAll
+ResultadoMonitor monitor_notify(LockWord& lock_word, JavaThread* self, bool todos);
+
+// Objeto coletado pelo GC: libera o monitor inflado, se houver (ninguém mais o alcança)
+void monitor_descartar(LockWord& lock_word);
+
+#endif // MONITOR_H
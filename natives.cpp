@@ -0,0 +1,996 @@
+// natives.cpp
+
+#include "natives.h"
+#include "gc.h"
+#include "printstream.h"
+#include "simd.h"
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <climits>
+
+// =======================================================================
+// 1. AUXILIARES
+// =======================================================================
+
+static inline float pop_jfloat(Frame& frame) {
+    jword bits = pop_jword(frame);
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+static inline void push_jfloat(Frame& frame, float value) {
+    jword bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    push_jword(frame, bits);
+}
+
+// Conversão com as regras do Java: NaN vira 0 e valores fora da faixa saturam
+static int64_t arredondar_long(double value) {
+    if (std::isnan(value)) return 0;
+    double r = std::floor(value);
+    if (value - r >= 0.5) r += 1.0;
+    if (r >= 9.2233720368547758e18) return LLONG_MAX;
+    if (r <= -9.2233720368547758e18) return LLONG_MIN;
+    return (int64_t)r;
+}
+
+static int32_t arredondar_int(float value) {
+    if (std::isnan(value)) return 0;
+    double r = std::floor((double)value);
+    if ((double)value - r >= 0.5) r += 1.0;
+    if (r >= 2147483647.0) return INT_MAX;
+    if (r <= -2147483648.0) return INT_MIN;
+    return (int32_t)r;
+}
+
+// Math.max/min: NaN se propaga e -0.0 < 0.0
+static double max_java(double a, double b) {
+    if (a != a) return a;
+    if (b != b) return b;
+    if (a == 0.0 && b == 0.0) return std::signbit(a) ? b : a;
+    return a >= b ? a : b;
+}
+
+static double min_java(double a, double b) {
+    if (a != a) return a;
+    if (b != b) return b;
+    if (a == 0.0 && b == 0.0) return std::signbit(a) ? a : b;
+    return a <= b ? a : b;
+}
+
+/**
+ * @brief Formata um double/float como Double.toString/Float.toString: o menor
+ * número de dígitos que reproduz o valor, em notação decimal para magnitudes
+ * em [1e-3, 1e7) e científica ("1.0E10") fora dessa faixa.
+ */
+static std::string formatar_ponto_flutuante(double value, bool is_float) {
+    if (std::isnan(value)) return "NaN";
+    if (std::isinf(value)) return value > 0 ? "Infinity" : "-Infinity";
+    if (value == 0.0) return std::signbit(value) ? "-0.0" : "0.0";
+
+    char buf[40];
+    int max_digits = is_float ? 9 : 17;
+    for (int p = 1; p <= max_digits; p++) {
+        std::snprintf(buf, sizeof(buf), "%.*e", p - 1, value);
+        if (is_float ? (std::strtof(buf, nullptr) == (float)value) : (std::strtod(buf, nullptr) == value)) break;
+    }
+
+    // buf = "[-]d.ddde[+-]XX": separa sinal, dígitos e expoente
+    std::string s(buf);
+    std::string sign = (s[0] == '-') ? "-" : "";
+    if (!sign.empty()) s = s.substr(1);
+    size_t e_pos = s.find('e');
+    int exponent = std::atoi(s.c_str() + e_pos + 1);
+    std::string digits;
+    for (size_t i = 0; i < e_pos; i++) {
+        if (s[i] != '.') digits += s[i];
+    }
+    while (digits.size() > 1 && digits.back() == '0') digits.pop_back();
+
+    double magnitude = std::fabs(value);
+    if (magnitude >= 1e-3 && magnitude < 1e7) {
+        std::string int_part, frac_part;
+        if (exponent >= 0) {
+            int_part = digits.substr(0, std::min(digits.size(), (size_t)exponent + 1));
+            while ((int)int_part.size() < exponent + 1) int_part += '0';
+            frac_part = digits.size() > (size_t)exponent + 1 ? digits.substr(exponent + 1) : "0";
+        } else {
+            int_part = "0";
+            frac_part = std::string(-exponent - 1, '0') + digits;
+        }
+        return sign + int_part + "." + frac_part;
+    }
+    return sign + digits.substr(0, 1) + "." + (digits.size() > 1 ? digits.substr(1) : "0") + "E" + std::to_string(exponent);
+}
+
+// Hash de identidade: fixado no cabeçalho no primeiro pedido (não depende do endereço depois disso)
+static jword hash_identidade(jref ref) {
+    HeapObject& obj = heap[ref];
+    if (obj.hash == 0) obj.hash = ref; // ref nunca é 0 aqui: está acima da zona nula
+    return obj.hash;
+}
+
+static std::string texto_objeto(jref ref) {
+    if (ref == 0) return "null";
+    if (heap[ref].klass->layout == LAYOUT_STRING) return texto_string(ref);
+    std::string name = heap[ref].klass->name;
+    for (char& c : name) if (c == '/') c = '.';
+    char hash[16];
+    std::snprintf(hash, sizeof(hash), "@%x", hash_identidade(ref));
+    return name + hash;
+}
+
+static void lancar_number_format(Frame& frame, uint32_t pc, const std::string& message) {
+    lancar_excecao(frame, pc, criar_excecao("java/lang/NumberFormatException", message, 0));
+}
+
+/**
+ * @brief Integer.parseInt/Long.parseLong: sinal opcional e dígitos na base dada,
+ * com detecção de overflow no limite do tipo.
+ * @return false se o texto não é um número válido na faixa [min, max].
+ */
+static bool converter_inteiro(const std::string& text, int radix, int64_t min, int64_t max, int64_t& out) {
+    if (text.empty() || radix < 2 || radix > 36) return false;
+    size_t i = 0;
+    bool negative = false;
+    if (text[0] == '-' || text[0] == '+') {
+        negative = text[0] == '-';
+        if (++i == text.size()) return false;
+    }
+
+    // Acumula em negativo: a faixa negativa é maior (comporta o mínimo do tipo)
+    uint64_t limit = negative ? (uint64_t)(-(min + 1)) + 1 : (uint64_t)max;
+    uint64_t acc = 0;
+    for (; i < text.size(); i++) {
+        char c = text[i];
+        int digit = (c >= '0' && c <= '9') ? c - '0' :
+                    (c >= 'a' && c <= 'z') ? c - 'a' + 10 :
+                    (c >= 'A' && c <= 'Z') ? c - 'A' + 10 : 99;
+        if (digit >= radix) return false;
+        if (acc > (limit - digit) / radix) return false;
+        acc = acc * radix + digit;
+    }
+    out = negative ? (int64_t)(0 - acc) : (int64_t)acc;
+    return true;
+}
+
+static void parse_inteiro(Frame& frame, uint32_t pc, int radix, bool is_long) {
+    jref string_ref = pop_jword(frame);
+    if (string_ref == 0) {
+        lancar_number_format(frame, pc, "Cannot parse null string: null");
+        return;
+    }
+
+    std::string text = texto_string(string_ref);
+    int64_t value;
+    if (!converter_inteiro(text, radix, is_long ? LLONG_MIN : INT_MIN, is_long ? LLONG_MAX : INT_MAX, value)) {
+        std::string message = "For input string: \"" + text + "\"";
+        if (radix != 10) message += " under radix " + std::to_string(radix);
+        lancar_number_format(frame, pc, message);
+        return;
+    }
+    if (is_long) push_jlong(frame, value);
+    else push_jword(frame, (jword)(int32_t)value);
+}
+
+// =======================================================================
+// 2. java/io/PrintStream
+// =======================================================================
+
+// Fluxo do PrintStream pelo campo 'fd' (1: System.out, 2: System.err)
+static FluxoSaida& fluxo_print_stream(jref print_stream) {
+    static const uint32_t off_fd = find_field(carregar_classe("java/io/PrintStream"), "fd", "I")->offset;
+    jword fd;
+    std::memcpy(&fd, heap[print_stream].bytes() + off_fd, 4);
+    return fluxo_saida((int)fd);
+}
+
+// O argumento já foi desempilhado: resta o próprio PrintStream
+static void escrever(Frame& frame, const char* text, size_t n, bool newline) {
+    FluxoSaida& fluxo = fluxo_print_stream(pop_jword(frame));
+    fluxo_escrever(fluxo, text, n);
+    if (newline) fluxo_nova_linha(fluxo);
+}
+
+static void escrever(Frame& frame, const std::string& text, bool newline) {
+    escrever(frame, text.data(), text.size(), newline);
+}
+
+static void escrever_inteiro(Frame& frame, int64_t value, bool newline) {
+    FluxoSaida& fluxo = fluxo_print_stream(pop_jword(frame));
+    fluxo_escrever_inteiro(fluxo, value);
+    if (newline) fluxo_nova_linha(fluxo);
+}
+
+// Strings são codificadas direto dos chars do heap, sem std::string intermediária
+static void escrever_objeto(Frame& frame, jref ref, bool newline) {
+    if (ref != 0 && heap[ref].klass->layout == LAYOUT_STRING) {
+        FluxoSaida& fluxo = fluxo_print_stream(pop_jword(frame));
+        HeapObject& str = heap[ref];
+        if (string_utf16(str)) {
+            fluxo_escrever_utf16(fluxo, reinterpret_cast<const uint16_t*>(string_chars(str)), string_length(str));
+        } else {
+            fluxo_escrever_latin1(fluxo, string_chars(str), string_length(str));
+        }
+        if (newline) fluxo_nova_linha(fluxo);
+        return;
+    }
+    escrever(frame, texto_objeto(ref), newline);
+}
+
+// print/println para cada tipo de argumento
+#define PRINT_NATIVES(metodo, nl)                                                                              \
+    {"java/io/PrintStream", metodo, "(I)V", [](Frame& f, uint32_t) { escrever_inteiro(f, (int32_t)pop_jword(f), nl); }}, \
+    {"java/io/PrintStream", metodo, "(J)V", [](Frame& f, uint32_t) { escrever_inteiro(f, pop_jlong(f), nl); }}, \
+    {"java/io/PrintStream", metodo, "(D)V", [](Frame& f, uint32_t) { std::string t = formatar_ponto_flutuante(pop_jdouble(f), false); escrever(f, t, nl); }}, \
+    {"java/io/PrintStream", metodo, "(F)V", [](Frame& f, uint32_t) { std::string t = formatar_ponto_flutuante(pop_jfloat(f), true); escrever(f, t, nl); }}, \
+    {"java/io/PrintStream", metodo, "(Z)V", [](Frame& f, uint32_t) { bool b = pop_jword(f) != 0; escrever(f, b ? "true" : "false", b ? 4 : 5, nl); }}, \
+    {"java/io/PrintStream", metodo, "(C)V", [](Frame& f, uint32_t) { uint16_t c = (uint16_t)pop_jword(f); FluxoSaida& s = fluxo_print_stream(pop_jword(f)); fluxo_escrever_utf16(s, &c, 1); if (nl) fluxo_nova_linha(s); }}, \
+    {"java/io/PrintStream", metodo, "(Ljava/lang/String;)V", [](Frame& f, uint32_t) { escrever_objeto(f, pop_jword(f), nl); }}, \
+    {"java/io/PrintStream", metodo, "(Ljava/lang/Object;)V", [](Frame& f, uint32_t) { escrever_objeto(f, pop_jword(f), nl); }}
+
+// =======================================================================
+// 3. java/lang/System
+// =======================================================================
+
+static void system_arraycopy(Frame& frame, uint32_t pc) {
+    int32_t length = (int32_t)pop_jword(frame);
+    int32_t dest_pos = (int32_t)pop_jword(frame);
+    jref dest = pop_jword(frame);
+    int32_t src_pos = (int32_t)pop_jword(frame);
+    jref src = pop_jword(frame);
+
+    if (src == 0 || dest == 0) {
+        handle_exception(frame, pc, EXC_NULL_POINTER);
+        return;
+    }
+
+    // Ambos arrays; primitivos só entre arrays do mesmo tipo, referências entre arrays de referências
+    const RuntimeClass* src_class = heap[src].klass;
+    const RuntimeClass* dest_class = heap[dest].klass;
+    bool src_ref = src_class->element_class != nullptr;
+    bool dest_ref = dest_class->element_class != nullptr;
+    if (src_class->name[0] != '[' || dest_class->name[0] != '[' ||
+        src_ref != dest_ref || (!src_ref && src_class != dest_class)) {
+        lancar_excecao(frame, pc, criar_excecao("java/lang/ArrayStoreException",
+                                                "arraycopy: " + src_class->name + " -> " + dest_class->name, 0));
+        return;
+    }
+
+    if (length < 0 || src_pos < 0 || dest_pos < 0 ||
+        (int64_t)src_pos + length > (int64_t)heap[src].length ||
+        (int64_t)dest_pos + length > (int64_t)heap[dest].length) {
+        handle_exception(frame, pc, EXC_ARRAY_INDEX);
+        return;
+    }
+
+    // Referências sem garantia de tipo (o elemento da origem não é subtipo do do destino): elemento a
+    // elemento, com a verificação do aastore; os anteriores ao primeiro inválido ficam copiados
+    if (dest_ref && !is_subtype_of(src_class->element_class, dest_class->element_class)) {
+        RuntimeClass* destino = dest_class->element_class;
+        for (int32_t i = 0; i < length; i++) {
+            jref value = heap[src].data()[src_pos + i];
+            if (value != 0 && !is_subtype_of(heap[value].klass, destino)) {
+                lancar_excecao(frame, pc, criar_excecao("java/lang/ArrayStoreException",
+                                                        "arraycopy: element type mismatch: " + heap[value].klass->name +
+                                                        " -> " + dest_class->name, 0));
+                return;
+            }
+            heap[dest].data()[dest_pos + i] = value;
+            gc_barreira(dest, value);
+        }
+        return;
+    }
+
+    // memmove: origem e destino podem ser o mesmo array (mesma largura de elemento dos dois lados)
+    const size_t largura = src_class->element_size;
+    if (length > 0) {
+        std::memmove(heap[dest].bytes() + dest_pos * largura, heap[src].bytes() + src_pos * largura,
+                     (size_t)length * largura);
+    }
+
+    // Barreira de escrita: o cartão do cabeçalho cobre o array inteiro (um teste vetorial por cópia)
+    if (dest_ref && !gc_no_bercario(dest) &&
+        simd_algum_acima(heap[dest].data() + dest_pos, (size_t)length, HEAP_NURSERY_BASE)) {
+        gc_sujar_cartao(dest);
+    }
+}
+
+// =======================================================================
+// 3.1. java/lang/Object: wait e notify (sobre o monitor inflado do objeto)
+// =======================================================================
+
+static void lancar_monitor_ilegal(Frame& frame, uint32_t pc) {
+    lancar_excecao(frame, pc, criar_excecao("java/lang/IllegalMonitorStateException", "current thread is not owner", 0));
+}
+
+static void object_wait(Frame& frame, uint32_t pc, int64_t timeout_ms) {
+    jref ref = pop_jword(frame);
+    if (timeout_ms < 0) {
+        lancar_excecao(frame, pc, criar_excecao("java/lang/IllegalArgumentException", "timeout value is negative", 0));
+        return;
+    }
+    if (monitor_wait(heap[ref].lock_word, thread_atual(), timeout_ms) != MONITOR_OK) lancar_monitor_ilegal(frame, pc);
+}
+
+static void object_notify(Frame& frame, uint32_t pc, bool todos) {
+    jref ref = pop_jword(frame);
+    if (monitor_notify(heap[ref].lock_word, thread_atual(), todos) != MONITOR_OK) lancar_monitor_ilegal(frame, pc);
+}
+
+// =======================================================================
+// 3.2. java/util/Arrays: intrínsecos sobre arrays de primitivos (simd.h)
+// =======================================================================
+
+// null e limites são testados uma vez por chamada; os kernels percorrem os dados direto no heap
+
+static bool array_nao_nulo(Frame& frame, uint32_t pc, jref ref) {
+    if (ref == 0) handle_exception(frame, pc, EXC_NULL_POINTER);
+    return ref != 0;
+}
+
+// Intervalo [from, to) de um array de 'length' elementos (regras de Arrays.rangeCheck)
+static bool intervalo_valido(Frame& frame, uint32_t pc, uint32_t length, int32_t from, int32_t to) {
+    if (from > to) {
+        lancar_excecao(frame, pc, criar_excecao("java/lang/IllegalArgumentException",
+                                                "fromIndex(" + std::to_string(from) + ") > toIndex(" + std::to_string(to) + ")", 0));
+        return false;
+    }
+    if (from < 0 || (uint32_t)to > length) {
+        handle_exception(frame, pc, EXC_ARRAY_INDEX);
+        return false;
+    }
+    return true;
+}
+
+// fill(a, val) e fill(a, from, to, val): o valor tem 1 ou 2 slots conforme o tipo
+static void arrays_fill(Frame& frame, uint32_t pc, char tipo, bool intervalo) {
+    uint64_t valor = (tipo == 'J' || tipo == 'D') ? (uint64_t)pop_jlong(frame) : (uint64_t)pop_jword(frame);
+    if (tipo == 'Z') valor &= 1;
+    int32_t to = intervalo ? (int32_t)pop_jword(frame) : 0;
+    int32_t from = intervalo ? (int32_t)pop_jword(frame) : 0;
+    jref ref = pop_jword(frame);
+    if (!array_nao_nulo(frame, pc, ref)) return;
+
+    HeapObject& array = heap[ref];
+    if (!intervalo) to = (int32_t)array.length;
+    if (!intervalo_valido(frame, pc, array.length, from, to)) return;
+
+    const size_t largura = array.klass->element_size;
+    simd_preencher(array.bytes() + (size_t)from * largura, (size_t)(to - from), largura, valor);
+}
+
+// Arrays.equals de float/double compara floatToIntBits: NaNs de bits diferentes são iguais
+template <typename T, typename Bits>
+static bool iguais_com_nan(const T* a, const T* b, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        Bits x, y;
+        std::memcpy(&x, &a[i], sizeof(T));
+        std::memcpy(&y, &b[i], sizeof(T));
+        if (x != y && !(std::isnan(a[i]) && std::isnan(b[i]))) return false;
+    }
+    return true;
+}
+
+static void arrays_equals(Frame& frame, char tipo) {
+    jref b = pop_jword(frame);
+    jref a = pop_jword(frame);
+    bool iguais;
+    if (a == b) {
+        iguais = true;
+    } else if (a == 0 || b == 0 || heap[a].length != heap[b].length) {
+        iguais = false;
+    } else {
+        const uint32_t n = heap[a].length;
+        iguais = simd_iguais(heap[a].bytes(), heap[b].bytes(), (size_t)n * heap[a].klass->element_size);
+        // Bits diferentes ainda podem ser iguais só por NaNs com payloads distintos
+        if (!iguais && tipo == 'F') {
+            iguais = iguais_com_nan<float, uint32_t>(reinterpret_cast<float*>(heap[a].bytes()), reinterpret_cast<float*>(heap[b].bytes()), n);
+        } else if (!iguais && tipo == 'D') {
+            iguais = iguais_com_nan<double, uint64_t>(reinterpret_cast<double*>(heap[a].bytes()), reinterpret_cast<double*>(heap[b].bytes()), n);
+        }
+    }
+    push_jword(frame, iguais ? 1 : 0);
+}
+
+// Hash de cada elemento como em Float.hashCode, Double.hashCode, Long.hashCode e Boolean.hashCode
+static uint32_t hash_elemento(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, 4);
+    return std::isnan(v) ? 0x7fc00000u : bits;
+}
+static uint32_t hash_elemento(int64_t v) { return (uint32_t)((uint64_t)v ^ ((uint64_t)v >> 32)); }
+static uint32_t hash_elemento(double v) {
+    int64_t bits;
+    std::memcpy(&bits, &v, 8);
+    return hash_elemento(std::isnan(v) ? (int64_t)0x7ff8000000000000ll : bits);
+}
+static uint32_t hash_elemento(bool v) { return v ? 1231 : 1237; }
+
+template <typename T, typename Elemento>
+static int32_t hash_escalar(const uint8_t* dados, uint32_t n) {
+    uint32_t h = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        T v;
+        std::memcpy(&v, dados + (size_t)i * sizeof(T), sizeof(T));
+        h = 31 * h + hash_elemento((Elemento)v);
+    }
+    return (int32_t)h;
+}
+
+static void arrays_hash(Frame& frame, char tipo) {
+    jref ref = pop_jword(frame);
+    if (ref == 0) {
+        push_jword(frame, 0);
+        return;
+    }
+    uint8_t* dados = heap[ref].bytes();
+    const uint32_t n = heap[ref].length;
+    int32_t h;
+    switch (tipo) {
+        case 'I': h = simd_hash(reinterpret_cast<const int32_t*>(dados), n, 1); break;
+        case 'S': h = simd_hash(reinterpret_cast<const int16_t*>(dados), n, 1); break;
+        case 'C': h = simd_hash(reinterpret_cast<const uint16_t*>(dados), n, 1); break;
+        case 'B': h = simd_hash(reinterpret_cast<const int8_t*>(dados), n, 1); break;
+        case 'J': h = hash_escalar<int64_t, int64_t>(dados, n); break;
+        case 'F': h = hash_escalar<float, float>(dados, n); break;
+        case 'D': h = hash_escalar<double, double>(dados, n); break;
+        default:  h = hash_escalar<uint8_t, bool>(dados, n); break; // 'Z'
+    }
+    push_jword(frame, (jword)h);
+}
+
+// Ordem de Float.compare/Double.compare: -0.0 antes de 0.0 e NaNs no fim
+template <typename T>
+static bool menor_ponto_flutuante(T a, T b) {
+    if (std::isnan(a)) return false;
+    if (std::isnan(b)) return true;
+    if (a < b) return true;
+    return a == b && std::signbit(a) && !std::signbit(b);
+}
+
+template <typename T>
+static void ordenar(T* v, size_t n) { std::sort(v, v + n); }
+template <>
+void ordenar<float>(float* v, size_t n) { std::sort(v, v + n, menor_ponto_flutuante<float>); }
+template <>
+void ordenar<double>(double* v, size_t n) { std::sort(v, v + n, menor_ponto_flutuante<double>); }
+
+// sort(a) e sort(a, from, to): os elementos são ordenados no lugar, no heap
+template <typename T>
+static void arrays_sort(Frame& frame, uint32_t pc, bool intervalo) {
+    int32_t to = intervalo ? (int32_t)pop_jword(frame) : 0;
+    int32_t from = intervalo ? (int32_t)pop_jword(frame) : 0;
+    jref ref = pop_jword(frame);
+    if (!array_nao_nulo(frame, pc, ref)) return;
+
+    HeapObject& array = heap[ref];
+    if (!intervalo) to = (int32_t)array.length;
+    if (!intervalo_valido(frame, pc, array.length, from, to)) return;
+    ordenar(reinterpret_cast<T*>(array.bytes()) + from, (size_t)(to - from));
+}
+
+// =======================================================================
+// 3.3. java/lang/String: intrínsecos sobre a representação compacta (simd.h)
+// =======================================================================
+
+// O receptor nunca é null aqui (testado no invoke); argumentos String são testados por quem precisa
+
+static size_t bytes_string(HeapObject& s) {
+    return (size_t)string_length(s) * (string_utf16(s) ? 2 : 1);
+}
+
+// String.hashCode: calculado uma vez e guardado nos dados da String (hash 0 é recalculado, como no JDK)
+static jword hash_string(jref ref) {
+    HeapObject& s = heap[ref];
+    uint32_t h;
+    std::memcpy(&h, s.bytes(), STRING_HASH_BYTES);
+    if (h == 0) {
+        h = (uint32_t)(string_utf16(s) ? simd_hash(reinterpret_cast<const uint16_t*>(string_chars(s)), string_length(s), 0)
+                                       : simd_hash(string_chars(s), string_length(s), 0));
+        std::memcpy(s.bytes(), &h, STRING_HASH_BYTES);
+    }
+    return h;
+}
+
+// Mesma codificação e mesmos bytes ('length' inclui o bit de codificação); hashes já calculados e diferentes descartam antes
+static bool strings_iguais(jref a, jref b) {
+    if (a == b) return true;
+    if (b == 0 || heap[b].klass->layout != LAYOUT_STRING) return false;
+    HeapObject& x = heap[a];
+    HeapObject& y = heap[b];
+    if (x.length != y.length) return false;
+    uint32_t hx, hy;
+    std::memcpy(&hx, x.bytes(), STRING_HASH_BYTES);
+    std::memcpy(&hy, y.bytes(), STRING_HASH_BYTES);
+    if (hx != 0 && hy != 0 && hx != hy) return false;
+    return simd_iguais(string_chars(x), string_chars(y), bytes_string(x));
+}
+
+/**
+ * @brief Primeira ocorrência de 'padrao' (m chars) em 'texto' (n chars) a partir
+ * de 'from': os candidatos saem do kernel de busca do primeiro char e são
+ * confirmados comparando o resto em bloco.
+ * @return -1 se não houver.
+ */
+template <typename T>
+static int32_t buscar_chars(const T* texto, size_t n, const T* padrao, size_t m, size_t from) {
+    if (m == 0) return (int32_t)std::min(from, n);
+    for (size_t i = from; i + m <= n; i++) {
+        i += simd_indice(texto + i, n - m + 1 - i, padrao[0]);
+        if (i + m > n) break;
+        if (simd_iguais(reinterpret_cast<const uint8_t*>(texto + i + 1), reinterpret_cast<const uint8_t*>(padrao + 1),
+                        (m - 1) * sizeof(T))) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+// indexOf(String, from) sobre as codificações dos dois lados
+static int32_t indice_string(HeapObject& s, HeapObject& p, int32_t from) {
+    const size_t n = string_length(s);
+    const size_t m = string_length(p);
+    const size_t inicio = from < 0 ? 0 : (size_t)from;
+    if (!string_utf16(s)) {
+        // Padrão em UTF-16 tem algum char fora do Latin-1: não ocorre num texto Latin-1
+        if (string_utf16(p)) return -1;
+        return buscar_chars(string_chars(s), n, string_chars(p), m, inicio);
+    }
+    const uint16_t* texto = reinterpret_cast<const uint16_t*>(string_chars(s));
+    if (string_utf16(p)) return buscar_chars(texto, n, reinterpret_cast<const uint16_t*>(string_chars(p)), m, inicio);
+    std::vector<uint16_t> largo(string_chars(p), string_chars(p) + m);
+    return buscar_chars(texto, n, largo.data(), m, inicio);
+}
+
+// indexOf(int ch, from): code points suplementares viram a busca do par de surrogates
+static int32_t indice_char(HeapObject& s, int32_t c, int32_t from) {
+    const size_t n = string_length(s);
+    const size_t inicio = from < 0 ? 0 : (size_t)from;
+    if (inicio >= n || c < 0 || c > 0x10FFFF) return -1;
+    if (!string_utf16(s)) {
+        if (c > 0xFF) return -1;
+        size_t i = inicio + simd_indice(string_chars(s) + inicio, n - inicio, (uint8_t)c);
+        return i < n ? (int32_t)i : -1;
+    }
+    const uint16_t* texto = reinterpret_cast<const uint16_t*>(string_chars(s));
+    if (c > 0xFFFF) {
+        const uint16_t par[2] = {(uint16_t)(0xD800 + ((c - 0x10000) >> 10)), (uint16_t)(0xDC00 + ((c - 0x10000) & 0x3FF))};
+        return buscar_chars(texto, n, par, 2, inicio);
+    }
+    size_t i = inicio + simd_indice(texto + inicio, n - inicio, (uint16_t)c);
+    return i < n ? (int32_t)i : -1;
+}
+
+// compareTo: primeira diferença pelo kernel quando as codificações coincidem
+static int32_t comparar_strings(HeapObject& a, HeapObject& b) {
+    const uint32_t n = string_length(a);
+    const uint32_t m = string_length(b);
+    const uint32_t comum = std::min(n, m);
+    uint32_t k = 0;
+    if (string_utf16(a) == string_utf16(b)) {
+        const size_t largura = string_utf16(a) ? 2 : 1;
+        k = (uint32_t)(simd_primeira_diferenca(string_chars(a), string_chars(b), comum * largura) / largura);
+    } else {
+        while (k < comum && string_char_at(a, k) == string_char_at(b, k)) k++;
+    }
+    if (k < comum) return (int32_t)string_char_at(a, k) - (int32_t)string_char_at(b, k);
+    return (int32_t)n - (int32_t)m;
+}
+
+static void string_char_at_nativo(Frame& frame, uint32_t pc) {
+    int32_t index = (int32_t)pop_jword(frame);
+    HeapObject& s = heap[pop_jword(frame)];
+    if ((uint32_t)index >= string_length(s)) {
+        lancar_excecao(frame, pc, criar_excecao("java/lang/StringIndexOutOfBoundsException",
+                                                "Index " + std::to_string(index) + " out of bounds for length " +
+                                                std::to_string(string_length(s)), 0));
+        return;
+    }
+    push_jword(frame, string_char_at(s, (uint32_t)index));
+}
+
+static void string_index_of(Frame& frame, uint32_t pc, bool com_from) {
+    int32_t from = com_from ? (int32_t)pop_jword(frame) : 0;
+    jref padrao = pop_jword(frame);
+    jref ref = pop_jword(frame);
+    if (padrao == 0) {
+        handle_exception(frame, pc, EXC_NULL_POINTER);
+        return;
+    }
+    push_jword(frame, (jword)indice_string(heap[ref], heap[padrao], from));
+}
+
+static void string_compare_to(Frame& frame, uint32_t pc) {
+    jref outra = pop_jword(frame);
+    jref ref = pop_jword(frame);
+    if (outra == 0) {
+        handle_exception(frame, pc, EXC_NULL_POINTER);
+        return;
+    }
+    push_jword(frame, (jword)comparar_strings(heap[ref], heap[outra]));
+}
+
+// =======================================================================
+// 4. TABELA DE NATIVOS EMBUTIDOS
+// =======================================================================
+
+struct NativoEmbutido {
+    const char* class_name;
+    const char* name;
+    const char* descriptor;
+    NativeMethod fn;
+};
+
+#define MATH_D_D(metodo, expr) \
+    {"java/lang/Math", metodo, "(D)D", [](Frame& f, uint32_t) { double a = pop_jdouble(f); push_jdouble(f, expr); }}
+#define MATH_DD_D(metodo, expr) \
+    {"java/lang/Math", metodo, "(DD)D", [](Frame& f, uint32_t) { double b = pop_jdouble(f); double a = pop_jdouble(f); push_jdouble(f, expr); }}
+
+#define ARRAYS_NATIVES(tipo, desc) \
+    {"java/util/Arrays", "fill", "([" desc desc ")V", [](Frame& f, uint32_t pc) { arrays_fill(f, pc, tipo, false); }}, \
+    {"java/util/Arrays", "fill", "([" desc "II" desc ")V", [](Frame& f, uint32_t pc) { arrays_fill(f, pc, tipo, true); }}, \
+    {"java/util/Arrays", "equals", "([" desc "[" desc ")Z", [](Frame& f, uint32_t) { arrays_equals(f, tipo); }}, \
+    {"java/util/Arrays", "hashCode", "([" desc ")I", [](Frame& f, uint32_t) { arrays_hash(f, tipo); }}
+#define ARRAYS_SORT(desc, T) \
+    {"java/util/Arrays", "sort", "([" desc ")V", [](Frame& f, uint32_t pc) { arrays_sort<T>(f, pc, false); }}, \
+    {"java/util/Arrays", "sort", "([" desc "II)V", [](Frame& f, uint32_t pc) { arrays_sort<T>(f, pc, true); }}
+
+static const NativoEmbutido nativos_embutidos[] = {
+    // --- java/io/PrintStream ---
+    PRINT_NATIVES("print", false),
+    PRINT_NATIVES("println", true),
+    {"java/io/PrintStream", "println", "()V", [](Frame& f, uint32_t) { fluxo_nova_linha(fluxo_print_stream(pop_jword(f))); }},
+    {"java/io/PrintStream", "flush", "()V", [](Frame& f, uint32_t) { fluxo_flush(fluxo_print_stream(pop_jword(f))); }},
+
+    // --- java/lang/Math (intrínsecos) ---
+    {"java/lang/Math", "abs", "(I)I", [](Frame& f, uint32_t) {
+        int32_t a = (int32_t)pop_jword(f);
+        push_jword(f, a < 0 ? 0u - (jword)a : (jword)a); // abs(MIN_VALUE) == MIN_VALUE
+    }},
+    {"java/lang/Math", "abs", "(J)J", [](Frame& f, uint32_t) {
+        int64_t a = pop_jlong(f);
+        push_jlong(f, a < 0 ? (int64_t)(0ull - (uint64_t)a) : a);
+    }},
+    {"java/lang/Math", "abs", "(F)F", [](Frame& f, uint32_t) { push_jfloat(f, std::fabs(pop_jfloat(f))); }},
+    MATH_D_D("abs", std::fabs(a)),
+    {"java/lang/Math", "max", "(II)I", [](Frame& f, uint32_t) {
+        int32_t b = (int32_t)pop_jword(f), a = (int32_t)pop_jword(f);
+        push_jword(f, (jword)(a >= b ? a : b));
+    }},
+    {"java/lang/Math", "min", "(II)I", [](Frame& f, uint32_t) {
+        int32_t b = (int32_t)pop_jword(f), a = (int32_t)pop_jword(f);
+        push_jword(f, (jword)(a <= b ? a : b));
+    }},
+    {"java/lang/Math", "max", "(JJ)J", [](Frame& f, uint32_t) {
+        int64_t b = pop_jlong(f), a = pop_jlong(f);
+        push_jlong(f, a >= b ? a : b);
+    }},
+    {"java/lang/Math", "min", "(JJ)J", [](Frame& f, uint32_t) {
+        int64_t b = pop_jlong(f), a = pop_jlong(f);
+        push_jlong(f, a <= b ? a : b);
+    }},
+    {"java/lang/Math", "max", "(FF)F", [](Frame& f, uint32_t) {
+        float b = pop_jfloat(f), a = pop_jfloat(f);
+        push_jfloat(f, (float)max_java(a, b));
+    }},
+    {"java/lang/Math", "min", "(FF)F", [](Frame& f, uint32_t) {
+        float b = pop_jfloat(f), a = pop_jfloat(f);
+        push_jfloat(f, (float)min_java(a, b));
+    }},
+    MATH_DD_D("max", max_java(a, b)),
+    MATH_DD_D("min", min_java(a, b)),
+    MATH_D_D("sqrt", std::sqrt(a)),
+    MATH_D_D("cbrt", std::cbrt(a)),
+    MATH_D_D("sin", std::sin(a)),
+    MATH_D_D("cos", std::cos(a)),
+    MATH_D_D("tan", std::tan(a)),
+    MATH_D_D("asin", std::asin(a)),
+    MATH_D_D("acos", std::acos(a)),
+    MATH_D_D("atan", std::atan(a)),
+    MATH_D_D("exp", std::exp(a)),
+    MATH_D_D("log", std::log(a)),
+    MATH_D_D("log10", std::log10(a)),
+    MATH_D_D("floor", std::floor(a)),
+    MATH_D_D("ceil", std::ceil(a)),
+    MATH_D_D("rint", std::nearbyint(a)),
+    MATH_DD_D("pow", std::pow(a, b)),
+    MATH_DD_D("atan2", std::atan2(a, b)),
+    MATH_DD_D("hypot", std::hypot(a, b)),
+    {"java/lang/Math", "round", "(D)J", [](Frame& f, uint32_t) { push_jlong(f, arredondar_long(pop_jdouble(f))); }},
+    {"java/lang/Math", "round", "(F)I", [](Frame& f, uint32_t) { push_jword(f, (jword)arredondar_int(pop_jfloat(f))); }},
+
+    // --- java/lang/Integer e java/lang/Long ---
+    {"java/lang/Integer", "parseInt", "(Ljava/lang/String;)I", [](Frame& f, uint32_t pc) { parse_inteiro(f, pc, 10, false); }},
+    {"java/lang/Integer", "parseInt", "(Ljava/lang/String;I)I", [](Frame& f, uint32_t pc) {
+        int radix = (int32_t)pop_jword(f);
+        parse_inteiro(f, pc, radix, false);
+    }},
+    {"java/lang/Long", "parseLong", "(Ljava/lang/String;)J", [](Frame& f, uint32_t pc) { parse_inteiro(f, pc, 10, true); }},
+    {"java/lang/Long", "parseLong", "(Ljava/lang/String;I)J", [](Frame& f, uint32_t pc) {
+        int radix = (int32_t)pop_jword(f);
+        parse_inteiro(f, pc, radix, true);
+    }},
+    {"java/lang/Integer", "toString", "(I)Ljava/lang/String;", [](Frame& f, uint32_t) {
+        push_jword(f, criar_string_literal(std::to_string((int32_t)pop_jword(f))));
+    }},
+    {"java/lang/Long", "toString", "(J)Ljava/lang/String;", [](Frame& f, uint32_t) {
+        push_jword(f, criar_string_literal(std::to_string(pop_jlong(f))));
+    }},
+    {"java/lang/Integer", "bitCount", "(I)I", [](Frame& f, uint32_t) { push_jword(f, (jword)__builtin_popcount(pop_jword(f))); }},
+    {"java/lang/Integer", "numberOfLeadingZeros", "(I)I", [](Frame& f, uint32_t) {
+        jword a = pop_jword(f);
+        push_jword(f, a == 0 ? 32 : (jword)__builtin_clz(a));
+    }},
+    {"java/lang/Integer", "numberOfTrailingZeros", "(I)I", [](Frame& f, uint32_t) {
+        jword a = pop_jword(f);
+        push_jword(f, a == 0 ? 32 : (jword)__builtin_ctz(a));
+    }},
+
+    // --- java/lang/System ---
+    {"java/lang/System", "nanoTime", "()J", [](Frame& f, uint32_t) {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        push_jlong(f, (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }},
+    {"java/lang/System", "currentTimeMillis", "()J", [](Frame& f, uint32_t) {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        push_jlong(f, (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+    }},
+    {"java/lang/System", "gc", "()V", [](Frame&, uint32_t) { gc_pedir_coleta(); }},
+    {"java/lang/System", "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V", system_arraycopy},
+    {"java/lang/System", "identityHashCode", "(Ljava/lang/Object;)I", [](Frame& f, uint32_t) {
+        jref ref = pop_jword(f);
+        push_jword(f, ref != 0 ? hash_identidade(ref) : 0);
+    }},
+
+    // --- java/lang/Object ---
+    // Receptor String com tipo estático Object: o método da String (não há despacho virtual para classes de sistema)
+    {"java/lang/Object", "hashCode", "()I", [](Frame& f, uint32_t) {
+        jref ref = pop_jword(f);
+        push_jword(f, heap[ref].klass->layout == LAYOUT_STRING ? hash_string(ref) : hash_identidade(ref));
+    }},
+    {"java/lang/Object", "equals", "(Ljava/lang/Object;)Z", [](Frame& f, uint32_t) {
+        jref outro = pop_jword(f);
+        jref ref = pop_jword(f);
+        push_jword(f, (ref == outro || (heap[ref].klass->layout == LAYOUT_STRING && strings_iguais(ref, outro))) ? 1 : 0);
+    }},
+    {"java/lang/Object", "wait", "()V", [](Frame& f, uint32_t pc) { object_wait(f, pc, 0); }},
+    {"java/lang/Object", "wait", "(J)V", [](Frame& f, uint32_t pc) {
+        int64_t timeout = pop_jlong(f);
+        object_wait(f, pc, timeout);
+    }},
+    {"java/lang/Object", "wait", "(JI)V", [](Frame& f, uint32_t pc) {
+        int32_t nanos = (int32_t)pop_jword(f);
+        int64_t timeout = pop_jlong(f);
+        object_wait(f, pc, (nanos > 0 && timeout < INT64_MAX) ? timeout + 1 : timeout);
+    }},
+    {"java/lang/Object", "notify", "()V", [](Frame& f, uint32_t pc) { object_notify(f, pc, false); }},
+    {"java/lang/Object", "notifyAll", "()V", [](Frame& f, uint32_t pc) { object_notify(f, pc, true); }},
+
+    // --- java/lang/String ---
+    {"java/lang/String", "length", "()I", [](Frame& f, uint32_t) { push_jword(f, string_length(heap[pop_jword(f)])); }},
+    {"java/lang/String", "isEmpty", "()Z", [](Frame& f, uint32_t) { push_jword(f, string_length(heap[pop_jword(f)]) == 0 ? 1 : 0); }},
+    {"java/lang/String", "charAt", "(I)C", string_char_at_nativo},
+    {"java/lang/String", "hashCode", "()I", [](Frame& f, uint32_t) { push_jword(f, hash_string(pop_jword(f))); }},
+    {"java/lang/String", "equals", "(Ljava/lang/Object;)Z", [](Frame& f, uint32_t) {
+        jref outro = pop_jword(f);
+        push_jword(f, strings_iguais(pop_jword(f), outro) ? 1 : 0);
+    }},
+    {"java/lang/String", "indexOf", "(I)I", [](Frame& f, uint32_t) {
+        int32_t c = (int32_t)pop_jword(f);
+        push_jword(f, (jword)indice_char(heap[pop_jword(f)], c, 0));
+    }},
+    {"java/lang/String", "indexOf", "(II)I", [](Frame& f, uint32_t) {
+        int32_t from = (int32_t)pop_jword(f);
+        int32_t c = (int32_t)pop_jword(f);
+        push_jword(f, (jword)indice_char(heap[pop_jword(f)], c, from));
+    }},
+    {"java/lang/String", "indexOf", "(Ljava/lang/String;)I", [](Frame& f, uint32_t pc) { string_index_of(f, pc, false); }},
+    {"java/lang/String", "indexOf", "(Ljava/lang/String;I)I", [](Frame& f, uint32_t pc) { string_index_of(f, pc, true); }},
+    {"java/lang/String", "compareTo", "(Ljava/lang/String;)I", string_compare_to},
+    {"java/lang/String", "intern", "()Ljava/lang/String;", [](Frame& f, uint32_t) { push_jword(f, internar_string(pop_jword(f))); }},
+    {"java/lang/String", "toString", "()Ljava/lang/String;", [](Frame&, uint32_t) {}}, // O próprio receptor
+
+    // --- java/util/Arrays ---
+    ARRAYS_NATIVES('I', "I"), ARRAYS_NATIVES('J', "J"), ARRAYS_NATIVES('S', "S"), ARRAYS_NATIVES('C', "C"),
+    ARRAYS_NATIVES('B', "B"), ARRAYS_NATIVES('Z', "Z"), ARRAYS_NATIVES('F', "F"), ARRAYS_NATIVES('D', "D"),
+    ARRAYS_SORT("I", int32_t), ARRAYS_SORT("J", int64_t), ARRAYS_SORT("S", int16_t), ARRAYS_SORT("C", uint16_t),
+    ARRAYS_SORT("B", int8_t), ARRAYS_SORT("F", float), ARRAYS_SORT("D", double),
+};
+
+// =======================================================================
+// 5. REGISTRO
+// =======================================================================
+
+static std::string chave_nativo(const std::string& class_name, const std::string& name, const std::string& descriptor) {
+    return class_name + "." + name + descriptor;
+}
+
+// Tabela única: classe.nome(descritor) -> implementação (preenchida com os embutidos no primeiro uso)
+static std::unordered_map<std::string, NativeMethod>& tabela_nativos() {
+    static std::unordered_map<std::string, NativeMethod> tabela;
+    if (tabela.empty()) {
+        for (const auto& n : nativos_embutidos) {
+            tabela[chave_nativo(n.class_name, n.name, n.descriptor)] = n.fn;
+        }
+    }
+    return tabela;
+}
+
+void registrar_nativo(const std::string& class_name, const std::string& name,
+                      const std::string& descriptor, NativeMethod fn) {
+    tabela_nativos()[chave_nativo(class_name, name, descriptor)] = fn;
+}
+
+NativeMethod buscar_nativo(const RuntimeClass* cls, const std::string& name, const std::string& descriptor) {
+    const auto& tabela = tabela_nativos();
+    for (const RuntimeClass* c = cls; c != nullptr; c = c->super) {
+        auto it = tabela.find(chave_nativo(c->name, name, descriptor));
+        if (it != tabela.end()) return it->second;
+    }
+    return nullptr;
+}
+
+// =======================================================================
+// 6. java/lang/invoke/StringConcatFactory (alvo dos sites de concatenação)
+// =======================================================================
+
+static size_t contar_digitos(int64_t value) {
+    uint64_t magnitude = value < 0 ? 0ull - (uint64_t)value : (uint64_t)value;
+    size_t count = value < 0 ? 2 : 1;
+    while (magnitude >= 10) {
+        magnitude /= 10;
+        count++;
+    }
+    return count;
+}
+
+// Grava o decimal de 'value' em out[0, len), com 'len' = contar_digitos(value)
+template <typename Char>
+static void gravar_decimal(Char* out, size_t len, int64_t value) {
+    uint64_t magnitude = value < 0 ? 0ull - (uint64_t)value : (uint64_t)value;
+    Char* p = out + len;
+    do {
+        *--p = (Char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--p = '-';
+}
+
+/**
+ * @brief String.valueOf do argumento objeto no slot 'index' da pilha de operandos:
+ * o slot passa a conter a String (e a mantém alcançável). Objetos com toString()
+ * em bytecode o executam numa ativação aninhada; os demais usam o texto padrão.
+ * @return false se o toString() lançou uma exceção (já lançada no frame).
+ */
+static bool converter_para_string(Frame& frame, uint32_t pc, size_t index) {
+    jref ref = frame.operand_stack[index];
+    if (ref == 0 || heap[ref].klass->layout == LAYOUT_STRING) return true;
+
+    RuntimeMethod* to_string = find_method(heap[ref].klass, "toString", "()Ljava/lang/String;");
+    if (to_string && to_string->has_code()) {
+        push_jword(frame, ref);
+        if (!invocar_metodo_java(frame, pc, to_string, true)) return false;
+        frame.operand_stack[index] = pop_jword(frame);
+    } else {
+        frame.operand_stack[index] = criar_string_literal(texto_objeto(ref));
+    }
+    return true;
+}
+
+static int64_t ler_long(const SlotsFrame& stack, size_t pos) {
+    return (int64_t)(((uint64_t)stack[pos + 1] << 32) | stack[pos]);
+}
+
+// Preenche o resultado em ordem, com chars de 1 byte (Latin-1) ou 2 (UTF-16)
+template <typename Char>
+static void preencher_concatenacao(Char* out, const CallSite& site, const SlotsFrame& stack, size_t base,
+                                   const std::vector<std::string>& flutuantes) {
+    size_t next_float = 0;
+    for (const ConcatPart& part : site.parts) {
+        jword v = part.type ? stack[base + part.slot] : 0;
+        const char* text = nullptr;
+        size_t n = 0;
+        switch (part.type) {
+            case 0: out = std::copy(part.literal.begin(), part.literal.end(), out); break; // Latin-1: todos <= 0xFF
+            case 'L': {
+                if (v == 0) { text = "null"; n = 4; break; }
+                HeapObject& str = heap[v];
+                const uint32_t len = string_length(str);
+                if (string_utf16(str)) {
+                    // Só quando o resultado também é UTF-16 (Char de 2 bytes)
+                    std::memcpy(out, string_chars(str), (size_t)len * 2);
+                    out += len;
+                } else {
+                    out = std::copy(string_chars(str), string_chars(str) + len, out);
+                }
+                break;
+            }
+            case 'Z': text = v ? "true" : "false"; n = v ? 4 : 5; break;
+            case 'C': *out++ = (Char)v; break;
+            case 'F': case 'D': text = flutuantes[next_float].data(); n = flutuantes[next_float++].size(); break;
+            case 'J': {
+                int64_t value = ler_long(stack, base + part.slot);
+                size_t len = contar_digitos(value);
+                gravar_decimal(out, len, value);
+                out += len;
+                break;
+            }
+            default: {
+                size_t len = contar_digitos((int32_t)v);
+                gravar_decimal(out, len, (int32_t)v);
+                out += len;
+                break;
+            }
+        }
+        for (size_t i = 0; i < n; i++) *out++ = (Char)(uint8_t)text[i];
+    }
+}
+
+void concatenar_strings(Frame& frame, uint32_t pc, const CallSite& site) {
+    static RuntimeClass* string_class = carregar_classe("java/lang/String");
+    const size_t base = frame.operand_stack.size() - site.arg_slots;
+    const SlotsFrame& stack = frame.operand_stack;
+
+    // 1. Objetos viram Strings antes de medir (toString pode executar bytecode)
+    for (const ConcatPart& part : site.parts) {
+        if (part.type == 'L' && !converter_para_string(frame, pc, base + part.slot)) return;
+    }
+
+    // 2. Tamanho exato e codificação do resultado (UTF-16 só se algum char não couber em Latin-1);
+    // float/double são formatados uma única vez
+    std::vector<std::string> flutuantes;
+    size_t length = site.literal_chars;
+    bool utf16 = site.literal_utf16;
+    for (const ConcatPart& part : site.parts) {
+        jword v = part.type ? stack[base + part.slot] : 0;
+        switch (part.type) {
+            case 0: break;
+            case 'L':
+                if (v != 0) {
+                    length += string_length(heap[v]);
+                    utf16 |= string_utf16(heap[v]);
+                } else {
+                    length += 4;
+                }
+                break;
+            case 'Z': length += v ? 4 : 5; break;
+            case 'C': length += 1; utf16 |= (v & 0xFFFF) > 0xFF; break;
+            case 'J': length += contar_digitos(ler_long(stack, base + part.slot)); break;
+            case 'F': {
+                float f;
+                std::memcpy(&f, &v, sizeof(float));
+                flutuantes.push_back(formatar_ponto_flutuante(f, true));
+                length += flutuantes.back().size();
+                break;
+            }
+            case 'D': {
+                uint64_t bits = (uint64_t)ler_long(stack, base + part.slot);
+                double d;
+                std::memcpy(&d, &bits, sizeof(double));
+                flutuantes.push_back(formatar_ponto_flutuante(d, false));
+                length += flutuantes.back().size();
+                break;
+            }
+            default: length += contar_digitos((int32_t)v); break; // I, S, B
+        }
+    }
+
+    // 3. Uma alocação, preenchida em ordem
+    jref result = allocate_heap_object(string_class, (uint32_t)length | (utf16 ? STRING_UTF16 : 0));
+    if (utf16) {
+        preencher_concatenacao(reinterpret_cast<uint16_t*>(string_chars(heap[result])), site, stack, base, flutuantes);
+    } else {
+        preencher_concatenacao(string_chars(heap[result]), site, stack, base, flutuantes);
+    }
+
+    frame.operand_stack.resize(base);
+    push_jword(frame, result);
+}
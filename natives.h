@@ -0,0 +1,35 @@
+// natives.h
+
+#ifndef NATIVES_H
+#define NATIVES_H
+
+#include "interpreter.h"
+#include <string>
+
+// =======================================================================
+// REGISTRO DE MÉTODOS NATIVOS E INTRÍNSECOS
+// =======================================================================
+
+/**
+ * @brief Registra a implementação C++ de um método, identificado por classe,
+ * nome e descritor (ex.: "java/lang/Math", "abs", "(I)I").
+ * Deve ser chamado antes da resolução das chamadas ao método.
+ */
+void registrar_nativo(const std::string& class_name, const std::string& name,
+                      const std::string& descriptor, NativeMethod fn);
+
+/**
+ * @brief Busca a implementação nativa para o método de 'cls', subindo pelas
+ * superclasses (métodos de sistema são criados na primeira classe sintética da
+ * hierarquia, não necessariamente na que declara o nativo).
+ * @return nullptr se não houver nativo registrado.
+ */
+NativeMethod buscar_nativo(const RuntimeClass* cls, const std::string& name, const std::string& descriptor);
+
+/**
+ * @brief Alvo dos sites invokedynamic do StringConcatFactory: converte os argumentos
+ * objeto em String, mede o resultado exato e o preenche numa única alocação.
+ */
+void concatenar_strings(Frame& frame, uint32_t pc, const CallSite& site);
+
+#endif // NATIVES_H
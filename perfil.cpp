@@ -0,0 +1,318 @@
+// perfil.cpp
+
+#include "perfil.h"
+#include "gc.h"
+#include "printstream.h"
+#include "trace.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <time.h>
+
+// =======================================================================
+// 1. AMOSTRAGEM DAS ALOCAÇÕES
+// =======================================================================
+
+thread_local int64_t perfil_restante = INT64_MAX;
+
+// Pilha distinta com a classe alocada e o que as amostras dela representam
+struct PilhaAmostrada {
+    RuntimeClass* klass;
+    std::vector<uint32_t> frames; // Pares (id do método, pc), do topo para a base
+    bool truncada;                // Mais de PERFIL_MAX_FRAMES frames: a base foi omitida
+    uint64_t amostras;
+    double bytes;                 // Bytes alocados estimados
+};
+
+static const char* prefixo = nullptr;       // JVM_HEAP_PROFILE (nullptr: desligado)
+static double intervalo = PERFIL_AMOSTRA_PADRAO;
+static std::mutex amostras_lock;
+static std::unordered_map<std::string, PilhaAmostrada> amostras; // Chave: klass e frames em bytes
+static uint64_t total_amostras = 0;
+static thread_local uint64_t semente = 0;
+
+// Intervalo exponencial de média 'intervalo' (xorshift64*; u em (0, 1])
+static double proximo_intervalo() {
+    semente ^= semente >> 12;
+    semente ^= semente << 25;
+    semente ^= semente >> 27;
+    const double u = (double)(((semente * 2685821657736338717ull) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    return -std::log(u) * intervalo;
+}
+
+void perfil_amostrar(RuntimeClass* klass, size_t bytes) {
+    // Os pontos do processo que caem dentro do mesmo objeto são uma só amostra
+    do {
+        perfil_restante += (int64_t)proximo_intervalo();
+    } while (perfil_restante < 0);
+
+    // Um objeto de 'bytes' é amostrado com probabilidade 1 - e^(-bytes / intervalo)
+    const double estimados = (double)bytes / -std::expm1(-(double)bytes / intervalo);
+
+    const size_t profundidade = jvm_stack.size();
+    const size_t n = std::min<size_t>(profundidade, PERFIL_MAX_FRAMES);
+    std::vector<uint32_t> frames;
+    frames.reserve(2 * n);
+    for (size_t i = 0; i < n; i++) {
+        const Frame& f = jvm_stack[profundidade - 1 - i];
+        frames.push_back(f.method->id);
+        frames.push_back(i == 0 ? f.instr_pc : f.call_pc);
+    }
+
+    std::string chave(reinterpret_cast<const char*>(&klass), sizeof(klass));
+    chave.append(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(uint32_t));
+    {
+        std::lock_guard<std::mutex> lock(amostras_lock);
+        PilhaAmostrada& a = amostras[chave];
+        if (a.amostras == 0) {
+            a.klass = klass;
+            a.frames.swap(frames);
+            a.truncada = profundidade > n;
+        }
+        a.amostras++;
+        a.bytes += estimados;
+        total_amostras++;
+    }
+    TRACE(TRACE_HEAP, TRACE_FINE, "Amostra de alocacao. Classe: {}, Bytes: {}", klass->name, bytes);
+}
+
+// =======================================================================
+// 2. NOMES NOS RELATÓRIOS
+// =======================================================================
+
+// "java/lang/String" -> "java.lang.String", "[[I" -> "int[][]", "[Ljava/lang/Object;" -> "java.lang.Object[]"
+static std::string nome_classe(const std::string& nome) {
+    size_t dims = 0;
+    while (dims < nome.size() && nome[dims] == '[') dims++;
+
+    std::string base;
+    if (dims == 0) {
+        base = nome;
+    } else if (nome[dims] == 'L') {
+        base = nome.substr(dims + 1, nome.size() - dims - 2);
+    } else {
+        switch (nome[dims]) {
+            case 'Z': base = "boolean"; break;
+            case 'B': base = "byte"; break;
+            case 'C': base = "char"; break;
+            case 'S': base = "short"; break;
+            case 'I': base = "int"; break;
+            case 'J': base = "long"; break;
+            case 'F': base = "float"; break;
+            case 'D': base = "double"; break;
+            default: base = nome.substr(dims); break;
+        }
+    }
+    std::replace(base.begin(), base.end(), '/', '.');
+    for (size_t i = 0; i < dims; i++) base += "[]";
+    return base;
+}
+
+static std::string nome_metodo(uint32_t id) {
+    const RuntimeMethod* m = method_registry[id];
+    return nome_classe(m->owner->name) + "." + m->name;
+}
+
+static FILE* abrir_relatorio(const std::string& caminho) {
+    FILE* f = std::fopen(caminho.c_str(), "w");
+    if (!f) std::cerr << "[PERFIL] Falha ao gravar " << caminho << std::endl;
+    return f;
+}
+
+// =======================================================================
+// 3. HISTOGRAMA DO HEAP
+// =======================================================================
+
+struct LinhaHistograma {
+    RuntimeClass* klass;
+    uint64_t instancias;
+    uint64_t bytes;
+};
+
+static std::unordered_map<RuntimeClass*, LinhaHistograma> histograma;
+
+static void contar_objeto(const HeapObject& obj, size_t bytes) {
+    LinhaHistograma& linha = histograma[obj.klass];
+    linha.klass = obj.klass;
+    linha.instancias++;
+    linha.bytes += bytes;
+}
+
+/**
+ * @brief Texto no formato do jmap -histo; nas pilhas dobradas, os pacotes são
+ * os frames (o flamegraph mostra a ocupação por pacote e classe).
+ */
+static void gravar_histograma(const std::string& base) {
+    histograma.clear();
+    gc_percorrer_vivos(contar_objeto);
+
+    std::vector<LinhaHistograma> linhas;
+    linhas.reserve(histograma.size());
+    uint64_t instancias = 0, bytes = 0;
+    for (const auto& par : histograma) {
+        linhas.push_back(par.second);
+        instancias += par.second.instancias;
+        bytes += par.second.bytes;
+    }
+    std::sort(linhas.begin(), linhas.end(), [](const LinhaHistograma& a, const LinhaHistograma& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.klass->name < b.klass->name;
+    });
+
+    if (FILE* f = abrir_relatorio(base + ".histo.txt")) {
+        std::fprintf(f, "# Histograma do heap: objetos vivos depois de uma coleta completa\n");
+        std::fprintf(f, " num     #instancias         #bytes  classe\n");
+        for (size_t i = 0; i < linhas.size(); i++) {
+            std::fprintf(f, "%4zu: %15llu %14llu  %s\n", i + 1, (unsigned long long)linhas[i].instancias,
+                         (unsigned long long)linhas[i].bytes, nome_classe(linhas[i].klass->name).c_str());
+        }
+        std::fprintf(f, "Total %15llu %14llu\n", (unsigned long long)instancias, (unsigned long long)bytes);
+        std::fclose(f);
+    }
+    if (FILE* f = abrir_relatorio(base + ".histo.folded")) {
+        for (const LinhaHistograma& l : linhas) {
+            std::string pilha = l.klass->name[0] == '[' ? nome_classe(l.klass->name) : l.klass->name;
+            std::replace(pilha.begin(), pilha.end(), '/', ';');
+            std::fprintf(f, "%s %llu\n", pilha.c_str(), (unsigned long long)l.bytes);
+        }
+        std::fclose(f);
+    }
+    histograma.clear();
+}
+
+// =======================================================================
+// 4. RELATÓRIO DAS ALOCAÇÕES AMOSTRADAS
+// =======================================================================
+
+// Texto: primeiro os locais de alocação (classe, método e pc do topo), depois cada pilha
+static void gravar_alocacoes(const std::string& base) {
+    std::lock_guard<std::mutex> lock(amostras_lock);
+
+    std::vector<const PilhaAmostrada*> pilhas;
+    pilhas.reserve(amostras.size());
+    double total_bytes = 0;
+    for (const auto& par : amostras) {
+        pilhas.push_back(&par.second);
+        total_bytes += par.second.bytes;
+    }
+    std::sort(pilhas.begin(), pilhas.end(), [](const PilhaAmostrada* a, const PilhaAmostrada* b) {
+        return a->bytes > b->bytes;
+    });
+
+    // Local de alocação: (classe, método << 32 | pc); pilha vazia (alocação da VM): ~0
+    std::map<std::pair<RuntimeClass*, uint64_t>, PilhaAmostrada> locais;
+    for (const PilhaAmostrada* p : pilhas) {
+        const uint64_t site = p->frames.empty() ? ~0ull : ((uint64_t)p->frames[0] << 32 | p->frames[1]);
+        PilhaAmostrada& local = locais[std::make_pair(p->klass, site)];
+        if (local.amostras == 0) {
+            local.klass = p->klass;
+            local.frames.assign(p->frames.begin(), p->frames.begin() + std::min<size_t>(2, p->frames.size()));
+        }
+        local.amostras += p->amostras;
+        local.bytes += p->bytes;
+    }
+    std::vector<const PilhaAmostrada*> ordem;
+    for (const auto& par : locais) ordem.push_back(&par.second);
+    std::sort(ordem.begin(), ordem.end(), [](const PilhaAmostrada* a, const PilhaAmostrada* b) {
+        return a->bytes > b->bytes;
+    });
+
+    if (FILE* f = abrir_relatorio(base + ".alloc.txt")) {
+        std::fprintf(f, "# Alocacoes amostradas: %llu amostras a cada %.0f bytes em media, %.0f bytes estimados\n",
+                     (unsigned long long)total_amostras, intervalo, total_bytes);
+        std::fprintf(f, "# Locais: bytes estimados, amostras, classe, metodo@pc\n");
+        for (const PilhaAmostrada* p : ordem) {
+            std::fprintf(f, "%14.0f %8llu  %s  %s\n", p->bytes, (unsigned long long)p->amostras,
+                         nome_classe(p->klass->name).c_str(),
+                         p->frames.empty() ? "[vm]" : (nome_metodo(p->frames[0]) + "@" + std::to_string(p->frames[1])).c_str());
+        }
+        std::fprintf(f, "# Pilhas: bytes estimados, amostras, classe, metodo@pc < chamador@pc ...\n");
+        for (const PilhaAmostrada* p : pilhas) {
+            std::string pilha = p->frames.empty() ? "[vm]" : "";
+            for (size_t i = 0; i < p->frames.size(); i += 2) {
+                if (i > 0) pilha += " < ";
+                pilha += nome_metodo(p->frames[i]) + "@" + std::to_string(p->frames[i + 1]);
+            }
+            if (p->truncada) pilha += " < ...";
+            std::fprintf(f, "%14.0f %8llu  %s  %s\n", p->bytes, (unsigned long long)p->amostras,
+                         nome_classe(p->klass->name).c_str(), pilha.c_str());
+        }
+        std::fclose(f);
+    }
+
+    // Pilhas dobradas: da base para o topo, com a classe alocada como folha
+    if (FILE* f = abrir_relatorio(base + ".alloc.folded")) {
+        for (const PilhaAmostrada* p : pilhas) {
+            std::string pilha = p->truncada ? "[truncada];" : (p->frames.empty() ? "[vm];" : "");
+            for (size_t i = p->frames.size(); i > 0; i -= 2) pilha += nome_metodo(p->frames[i - 2]) + ";";
+            pilha += nome_classe(p->klass->name);
+            std::fprintf(f, "%s %lld\n", pilha.c_str(), (long long)std::llround(p->bytes));
+        }
+        std::fclose(f);
+    }
+}
+
+// =======================================================================
+// 5. DESPEJO POR SINAL E NO FIM DA EXECUÇÃO
+// =======================================================================
+
+static JavaThread* thread_perfil = nullptr;
+static unsigned despejos = 0;
+
+static void despejar_no_safepoint(JavaThread*) {
+    const std::string base = std::string(prefixo) + "." + std::to_string(++despejos);
+    gravar_histograma(base);
+    gravar_alocacoes(base);
+    descarregar_saidas(); // O que o programa já escreveu vem antes da mensagem da VM
+    std::cout << "\t[PERFIL] Histograma e alocacoes gravados em " << base << ".*" << std::endl;
+}
+
+// Assíncrono-seguro: o despejo acontece no próximo safepoint da thread
+static void tratar_sigquit(int) {
+    if (thread_perfil) armar_safepoint(thread_perfil, SAFEPOINT_DESPEJO);
+}
+
+void perfil_iniciar(JavaThread* thread) {
+    prefixo = std::getenv("JVM_HEAP_PROFILE");
+    if (!prefixo || !*prefixo) {
+        prefixo = nullptr;
+        return;
+    }
+    if (const char* kb = std::getenv("JVM_ALLOC_SAMPLE_KB")) {
+        intervalo = (double)std::max(1, std::atoi(kb)) * 1024;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    semente = ((uint64_t)ts.tv_nsec << 20) ^ (uint64_t)ts.tv_sec ^ 0x9E3779B97F4A7C15ull;
+    perfil_restante = (int64_t)proximo_intervalo();
+
+    thread_perfil = thread;
+    registrar_operacao_safepoint(SAFEPOINT_DESPEJO, despejar_no_safepoint);
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = tratar_sigquit;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGQUIT, &sa, nullptr);
+}
+
+void perfil_finalizar() {
+    if (!prefixo) return;
+    thread_perfil = nullptr; // Sem safepoints daqui em diante: pedidos tardios são descartados
+    perfil_restante = INT64_MAX;
+
+    gravar_histograma(prefixo);
+    gravar_alocacoes(prefixo);
+    std::cout << "\t[PERFIL] " << total_amostras << " amostras de alocacao. Relatorios em " << prefixo
+              << ".{histo,alloc}.{txt,folded}" << std::endl;
+}
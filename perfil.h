@@ -0,0 +1,50 @@
+// perfil.h
+
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include "interpreter.h"
+#include <cstddef>
+#include <cstdint>
+
+// =======================================================================
+// HISTOGRAMA DO HEAP E PERFIL AMOSTRADO DE ALOCAÇÕES
+// =======================================================================
+
+/**
+ * Ligado por JVM_HEAP_PROFILE=<prefixo>. Dois relatórios, cada um em texto
+ * compacto (.txt) e em pilhas dobradas (.folded, entrada do flamegraph.pl):
+ *
+ *   <prefixo>.histo.*  instâncias e bytes por classe dos objetos vivos, depois
+ *                      de uma coleta completa (no fim da execução: os que
+ *                      continuam alcançáveis pelos estáticos e raízes da VM)
+ *   <prefixo>.alloc.*  alocações amostradas: classe, método, pc e pilha Java
+ *
+ * Os relatórios saem no fim da execução e a cada SIGQUIT (kill -3), num
+ * safepoint, como <prefixo>.<n>.*. As amostras são um processo de Poisson
+ * sobre os bytes alocados (média JVM_ALLOC_SAMPLE_KB): o caminho de alocação
+ * só decrementa um contador da thread, e cada amostra vale a estimativa
+ * não enviesada dos bytes que representa.
+ */
+
+#define PERFIL_AMOSTRA_PADRAO (512u * 1024) // Bytes médios entre amostras (JVM_ALLOC_SAMPLE_KB)
+#define PERFIL_MAX_FRAMES     64            // Frames do topo guardados por amostra
+
+// Bytes até a próxima amostra da thread (INT64_MAX: perfil desligado)
+extern thread_local int64_t perfil_restante;
+
+// Lê JVM_HEAP_PROFILE e JVM_ALLOC_SAMPLE_KB e instala o tratador de SIGQUIT (sem efeito se desligado)
+void perfil_iniciar(JavaThread* thread);
+
+// Caminho lento de perfil_alocacao: registra a pilha corrente e sorteia a próxima amostra
+void perfil_amostrar(RuntimeClass* klass, size_t bytes);
+
+// Chamada a cada alocação de objeto (ou grupo contíguo de objetos de 'klass')
+inline void perfil_alocacao(RuntimeClass* klass, size_t bytes) {
+    if ((perfil_restante -= (int64_t)bytes) < 0) perfil_amostrar(klass, bytes);
+}
+
+// Relatórios do fim da execução (com a pilha Java vazia)
+void perfil_finalizar();
+
+#endif // PERFIL_H
@@ -0,0 +1,204 @@
+// printstream.cpp
+
+#include "printstream.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// =======================================================================
+// 1. FLUXOS
+// =======================================================================
+
+static FluxoSaida* fluxos[3] = {nullptr, nullptr, nullptr};
+
+FluxoSaida& fluxo_saida(int fd) {
+    if (fd != 2) fd = 1;
+    if (!fluxos[fd]) {
+        static bool atexit_registrado = false;
+        if (!atexit_registrado) {
+            std::atexit(descarregar_saidas);
+            atexit_registrado = true;
+        }
+
+        FluxoSaida* fluxo = new FluxoSaida();
+        fluxo->fd = fd;
+        fluxo->flush_por_linha = (fd == 2) || isatty(fd);
+        fluxo->buffer.resize(PRINTSTREAM_BUFFER_SIZE);
+        fluxo->usado = 0;
+        fluxo->surrogate = 0;
+        fluxos[fd] = fluxo;
+    }
+    return *fluxos[fd];
+}
+
+// =======================================================================
+// 2. ESCRITA NO DESCRITOR
+// =======================================================================
+
+/**
+ * @brief writev até esgotar os vetores, tratando escritas parciais e EINTR.
+ * Erros de E/S descartam o restante (como o PrintStream, que não lança exceções).
+ */
+static void escrever_vetores(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        size_t restante = (size_t)written;
+        while (count > 0 && restante >= iov->iov_len) {
+            restante -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + restante;
+            iov->iov_len -= restante;
+        }
+    }
+}
+
+// Envia o buffer (o surrogate em espera continua em espera)
+static void enviar_buffer(FluxoSaida& fluxo) {
+    if (fluxo.usado == 0) return;
+    struct iovec iov = {fluxo.buffer.data(), fluxo.usado};
+    escrever_vetores(fluxo.fd, &iov, 1);
+    fluxo.usado = 0;
+}
+
+static void soltar_surrogate(FluxoSaida& fluxo);
+
+void fluxo_flush(FluxoSaida& fluxo) {
+    soltar_surrogate(fluxo);
+    enviar_buffer(fluxo);
+}
+
+void fluxo_escrever(FluxoSaida& fluxo, const char* data, size_t n) {
+    soltar_surrogate(fluxo);
+    if (fluxo.usado + n <= fluxo.buffer.size()) {
+        std::memcpy(fluxo.buffer.data() + fluxo.usado, data, n);
+        fluxo.usado += n;
+        return;
+    }
+
+    // Não cabe: pendente + novo numa única chamada de sistema
+    struct iovec iov[2] = {
+        {fluxo.buffer.data(), fluxo.usado},
+        {const_cast<char*>(data), n},
+    };
+    escrever_vetores(fluxo.fd, iov, 2);
+    fluxo.usado = 0;
+}
+
+// =======================================================================
+// 3. CODIFICAÇÃO
+// =======================================================================
+
+/**
+ * @brief Pior caso: 3 bytes UTF-8 por char (um par de surrogates vira um único
+ * code point de 4 bytes, 2 por char); processa em blocos que cabem no buffer.
+ * Um bloco nunca termina num surrogate alto seguido de outro char: ele passa
+ * para o bloco seguinte, junto com o seu par. Surrogates sem par saem com 3
+ * bytes, como em texto_string.
+ */
+template <typename Char>
+static void escrever_chars(FluxoSaida& fluxo, const Char* chars, size_t n) {
+    const size_t bloco_max = fluxo.buffer.size() / 3;
+    while (n > 0) {
+        size_t bloco = n < bloco_max ? n : bloco_max;
+        if (bloco < n && bloco > 1 && chars[bloco - 1] >= 0xD800 && chars[bloco - 1] < 0xDC00) bloco--;
+        if (fluxo.buffer.size() - fluxo.usado < bloco * 3) enviar_buffer(fluxo);
+
+        char* out = fluxo.buffer.data() + fluxo.usado;
+        for (size_t i = 0; i < bloco; i++) {
+            uint32_t c = chars[i];
+            if (c < 0x80) {
+                *out++ = (char)c;
+            } else if (c < 0x800) {
+                *out++ = (char)(0xC0 | (c >> 6));
+                *out++ = (char)(0x80 | (c & 0x3F));
+            } else if (c < 0xD800 || c >= 0xDC00 || i + 1 >= bloco ||
+                       chars[i + 1] < 0xDC00 || chars[i + 1] >= 0xE000) {
+                *out++ = (char)(0xE0 | (c >> 12));
+                *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (c & 0x3F));
+            } else {
+                c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)chars[++i] - 0xDC00);
+                *out++ = (char)(0xF0 | (c >> 18));
+                *out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+                *out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (c & 0x3F));
+            }
+        }
+        fluxo.usado = (size_t)(out - fluxo.buffer.data());
+        chars += bloco;
+        n -= bloco;
+    }
+}
+
+// O surrogate em espera não teve par: sai sozinho, com 3 bytes
+static void soltar_surrogate(FluxoSaida& fluxo) {
+    if (fluxo.surrogate == 0) return;
+    const uint16_t c = fluxo.surrogate;
+    fluxo.surrogate = 0;
+    escrever_chars(fluxo, &c, 1);
+}
+
+void fluxo_escrever_latin1(FluxoSaida& fluxo, const uint8_t* chars, size_t n) {
+    // Só ASCII (o caso comum): os bytes já são UTF-8
+    bool ascii = true;
+    for (size_t i = 0; i < n && ascii; i++) ascii = chars[i] < 0x80;
+    if (ascii) {
+        fluxo_escrever(fluxo, reinterpret_cast<const char*>(chars), n);
+        return;
+    }
+    soltar_surrogate(fluxo);
+    escrever_chars(fluxo, chars, n);
+}
+
+void fluxo_escrever_utf16(FluxoSaida& fluxo, const uint16_t* chars, size_t n) {
+    if (n == 0) return;
+    if (fluxo.surrogate != 0) {
+        if (chars[0] >= 0xDC00 && chars[0] < 0xE000) {
+            const uint16_t par[2] = {fluxo.surrogate, chars[0]};
+            fluxo.surrogate = 0;
+            escrever_chars(fluxo, par, 2);
+            chars++;
+            n--;
+        } else {
+            soltar_surrogate(fluxo);
+        }
+    }
+    // O surrogate alto final só entra em espera depois do resto: escrever_chars pode descarregar o buffer
+    const bool espera = n > 0 && chars[n - 1] >= 0xD800 && chars[n - 1] < 0xDC00;
+    escrever_chars(fluxo, chars, espera ? n - 1 : n);
+    if (espera) fluxo.surrogate = chars[n - 1];
+}
+
+void fluxo_escrever_inteiro(FluxoSaida& fluxo, int64_t value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint64_t magnitude = value < 0 ? 0ull - (uint64_t)value : (uint64_t)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--p = '-';
+    fluxo_escrever(fluxo, p, (size_t)(end - p));
+}
+
+void fluxo_nova_linha(FluxoSaida& fluxo) {
+    fluxo_escrever(fluxo, "\n", 1);
+    if (fluxo.flush_por_linha) fluxo_flush(fluxo);
+}
+
+void descarregar_saidas() {
+    for (FluxoSaida* fluxo : fluxos) {
+        if (fluxo) fluxo_flush(*fluxo);
+    }
+}
@@ -0,0 +1,58 @@
+// printstream.h
+
+#ifndef PRINTSTREAM_H
+#define PRINTSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =======================================================================
+// SAÍDA BUFFERIZADA DE System.out / System.err
+// =======================================================================
+
+// Capacidade do buffer em espaço de usuário de cada fluxo
+#define PRINTSTREAM_BUFFER_SIZE (64 * 1024)
+
+// Fluxo de saída associado a um descritor de arquivo (1: stdout, 2: stderr)
+struct FluxoSaida {
+    int fd;
+    bool flush_por_linha;      // Terminal interativo (ou stderr): descarrega a cada nova linha
+    std::vector<char> buffer;  // Capacidade fixa; 'usado' bytes pendentes
+    size_t usado;
+    uint16_t surrogate;        // Surrogate alto no fim da última escrita UTF-16, à espera do par (0: nenhum)
+};
+
+/**
+ * @brief Retorna o fluxo do descritor 'fd' (1 ou 2), criando-o no primeiro uso.
+ * A criação detecta terminal interativo (isatty) e registra a descarga no atexit.
+ */
+FluxoSaida& fluxo_saida(int fd);
+
+/**
+ * @brief Acrescenta 'n' bytes ao buffer. Escritas que não cabem são enviadas junto
+ * com o conteúdo pendente numa única chamada writev, sem cópia intermediária.
+ */
+void fluxo_escrever(FluxoSaida& fluxo, const char* data, size_t n);
+
+/**
+ * @brief Codifica os caracteres de uma String (Latin-1 ou UTF-16) em UTF-8 direto
+ * no buffer. Um surrogate alto no fim de uma escrita UTF-16 espera a próxima
+ * escrita do fluxo: print(char) de um par, um char por vez, sai como um code point.
+ */
+void fluxo_escrever_latin1(FluxoSaida& fluxo, const uint8_t* chars, size_t n);
+void fluxo_escrever_utf16(FluxoSaida& fluxo, const uint16_t* chars, size_t n);
+
+// Escreve um inteiro em decimal, sem alocações
+void fluxo_escrever_inteiro(FluxoSaida& fluxo, int64_t value);
+
+// Fim de linha: descarrega se o fluxo for por linha
+void fluxo_nova_linha(FluxoSaida& fluxo);
+
+// Envia o conteúdo pendente ao descritor
+void fluxo_flush(FluxoSaida& fluxo);
+
+// Descarrega stdout e stderr (fim da execução, atexit)
+void descarregar_saidas();
+
+#endif // PRINTSTREAM_H
@@ -0,0 +1,952 @@
+// runtime.cpp
+
+#include "runtime.h"
+#include "natives.h"
+#include "trace.h"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+// =======================================================================
+// 1. ESTRUTURAS GLOBAIS (Method Area e Tabela de Classes)
+// =======================================================================
+
+std::map<std::string, ClassFile> method_area;
+std::map<std::string, RuntimeClass> class_table;
+std::vector<RuntimeMethod*> method_registry;
+
+// =======================================================================
+// 2. AUXILIARES DE DESCRITOR
+// =======================================================================
+
+int contar_slots_argumentos(const std::string& desc) {
+    int slots = 0;
+    size_t i = 0;
+    if (desc.empty() || desc[i] != '(') return 0;
+    i++;
+    while (i < desc.length() && desc[i] != ')') {
+        if (desc[i] == 'J' || desc[i] == 'D') {
+            slots += 2; // Categoria 2
+            i++;
+            continue;
+        }
+        while (i < desc.length() && desc[i] == '[') i++;
+        if (i < desc.length() && desc[i] == 'L') {
+            while (i < desc.length() && desc[i] != ';') i++;
+        }
+        i++;
+        slots++;
+    }
+    return slots;
+}
+
+char tipo_retorno(const std::string& desc) {
+    size_t pos = desc.find(')');
+    if (pos == std::string::npos || pos + 1 >= desc.length()) return 'V';
+    return desc[pos + 1];
+}
+
+uint8_t tamanho_tipo(char type) {
+    switch (type) {
+        case 'B': case 'Z': return 1;
+        case 'C': case 'S': return 2;
+        case 'J': case 'D': return 8;
+        default:            return 4; // I, F e referências (jref)
+    }
+}
+
+// =======================================================================
+// 3. BUSCA DE MÉTODOS
+// =======================================================================
+
+// Busca apenas entre os métodos declarados pela própria classe
+static RuntimeMethod* find_declared_method(RuntimeClass* cls, const std::string& name, const std::string& descriptor) {
+    for (auto& m : cls->methods) {
+        if (m.name == name && m.descriptor == descriptor) return &m;
+    }
+    return nullptr;
+}
+
+RuntimeMethod* find_method(RuntimeClass* cls, const std::string& name, const std::string& descriptor) {
+    for (RuntimeClass* c = cls; c != nullptr; c = c->super) {
+        RuntimeMethod* m = find_declared_method(c, name, descriptor);
+        if (m) return m;
+    }
+    return nullptr;
+}
+
+static bool is_virtual(const RuntimeMethod& m) {
+    return !(m.access_flags & (ACC_STATIC | ACC_PRIVATE)) && m.name[0] != '<';
+}
+
+/**
+ * @brief Pré-indexa a exception_table do método: os limites de todas as entradas
+ * dividem o código em faixas disjuntas, e cada faixa guarda os handlers que a
+ * cobrem, preservando a ordem da tabela (a primeira entrada compatível vence).
+ */
+static void indexar_excecoes(RuntimeMethod& m) {
+    const auto& table = m.info->code_attribute.exception_table;
+    if (table.empty()) return;
+
+    std::vector<uint16_t> limites;
+    for (const auto& e : table) {
+        limites.push_back(e.start_pc);
+        limites.push_back(e.end_pc);
+    }
+    std::sort(limites.begin(), limites.end());
+    limites.erase(std::unique(limites.begin(), limites.end()), limites.end());
+
+    for (size_t i = 0; i + 1 < limites.size(); i++) {
+        ExceptionRange r;
+        r.start = limites[i];
+        r.end = limites[i + 1];
+        r.first = (uint16_t)m.exception_handlers.size();
+        for (size_t h = 0; h < table.size(); h++) {
+            if (table[h].start_pc <= r.start && r.start < table[h].end_pc) {
+                m.exception_handlers.push_back((uint16_t)h);
+            }
+        }
+        r.count = (uint16_t)(m.exception_handlers.size() - r.first);
+        if (r.count > 0) m.exception_ranges.push_back(r);
+    }
+}
+
+const ExceptionRange* buscar_faixa_excecao(const RuntimeMethod& method, uint32_t pc) {
+    const auto& ranges = method.exception_ranges;
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), pc,
+                               [](uint32_t p, const ExceptionRange& r) { return p < r.start; });
+    if (it == ranges.begin()) return nullptr;
+    --it;
+    return (pc < it->end) ? &*it : nullptr;
+}
+
+// =======================================================================
+// 3.1. SWITCHES COMPILADOS
+// =======================================================================
+
+static int32_t ler_s4(const std::vector<uint8_t>& code, uint32_t pos) {
+    return (int32_t)(((uint32_t)code[pos] << 24) | ((uint32_t)code[pos + 1] << 16) |
+                     ((uint32_t)code[pos + 2] << 8) | (uint32_t)code[pos + 3]);
+}
+
+uint32_t tamanho_instrucao(const std::vector<uint8_t>& code, uint32_t pc) {
+    // Tamanhos fixos por opcode (0: variável ou inválido)
+    static const uint8_t tamanhos[256] = {
+    //  0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x00
+        2, 3, 2, 3, 3, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, // 0x10
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x20
+        1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, // 0x30
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x40
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x50
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x60
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x70
+        1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x80
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, // 0x90
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 0, 0, 1, 1, 1, 1, // 0xa0
+        1, 1, 3, 3, 3, 3, 3, 3, 3, 5, 5, 3, 2, 3, 1, 1, // 0xb0
+        3, 3, 1, 1, 0, 4, 3, 3, 5, 5,                   // 0xc0
+    };
+
+    uint8_t opcode = code[pc];
+    switch (opcode) {
+        case 0xaa: { // tableswitch: padding até múltiplo de 4, default, low, high, offsets
+            uint32_t base = (pc + 4) & ~3u;
+            if (base + 12 > code.size()) return 0;
+            int64_t count = (int64_t)ler_s4(code, base + 8) - ler_s4(code, base + 4) + 1;
+            return count < 0 ? 0 : (uint32_t)(base - pc + 12 + 4 * count);
+        }
+        case 0xab: { // lookupswitch: padding, default, npairs, pares (chave, offset)
+            uint32_t base = (pc + 4) & ~3u;
+            if (base + 8 > code.size()) return 0;
+            int32_t npairs = ler_s4(code, base + 4);
+            return npairs < 0 ? 0 : (uint32_t)(base - pc + 8 + 8 * (uint32_t)npairs);
+        }
+        case 0xc4: // wide: iinc tem mais 2 bytes de constante
+            return (pc + 1 < code.size() && code[pc + 1] == 0x84) ? 6 : 4;
+        default:
+            return tamanhos[opcode];
+    }
+}
+
+/**
+ * @brief Procura um multiplicador que espalhe as chaves sem colisões numa tabela
+ * de 2^bits slots. Tenta algumas dezenas de multiplicadores ímpares.
+ */
+static bool hash_perfeito(SwitchTable& sw, const std::vector<int32_t>& keys,
+                          const std::vector<uint32_t>& targets, uint8_t bits) {
+    size_t slots = (size_t)1 << bits;
+    std::vector<uint8_t> ocupado(slots);
+    uint32_t mult = 0x9E3779B1u; // Razão áurea (Knuth)
+
+    for (int tentativa = 0; tentativa < 64; tentativa++, mult = mult * 1664525u + 1013904223u) {
+        mult |= 1;
+        std::fill(ocupado.begin(), ocupado.end(), 0);
+        bool colidiu = false;
+        for (int32_t k : keys) {
+            uint32_t slot = ((uint32_t)k * mult) >> (32 - bits);
+            if (ocupado[slot]) { colidiu = true; break; }
+            ocupado[slot] = 1;
+        }
+        if (colidiu) continue;
+
+        sw.kind = SWITCH_HASH;
+        sw.hash_mult = mult;
+        sw.hash_shift = (uint8_t)(32 - bits);
+        sw.keys.assign(slots, 0);
+        sw.targets.assign(slots, sw.default_target);
+        for (size_t i = 0; i < keys.size(); i++) {
+            uint32_t slot = ((uint32_t)keys[i] * mult) >> sw.hash_shift;
+            sw.keys[slot] = keys[i];
+            sw.targets[slot] = targets[i];
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Escolhe a forma de despacho de um lookupswitch pela distribuição das chaves:
+ * faixa densa vira tabela direta; muitas chaves esparsas, hash perfeito; o resto
+ * (ou quando não há hash sem colisões), busca binária.
+ */
+static void compilar_lookupswitch(SwitchTable& sw, const std::vector<int32_t>& keys, const std::vector<uint32_t>& targets) {
+    const size_t n = keys.size(); // Já ordenadas (exigido pela JVMS)
+    int64_t range = n ? (int64_t)keys.back() - keys.front() + 1 : 0;
+
+    if (n > 0 && range <= (int64_t)(2 * n + 4) && range <= 65536) {
+        sw.kind = SWITCH_DENSE;
+        sw.low = keys.front();
+        sw.targets.assign((size_t)range, sw.default_target);
+        for (size_t i = 0; i < n; i++) sw.targets[(uint32_t)keys[i] - (uint32_t)sw.low] = targets[i];
+        return;
+    }
+
+    if (n >= 8) {
+        uint8_t bits = 1;
+        while (((size_t)1 << bits) < 2 * n) bits++;
+        if (hash_perfeito(sw, keys, targets, bits) || (bits < 31 && hash_perfeito(sw, keys, targets, bits + 1))) return;
+    }
+
+    sw.kind = SWITCH_BINARY;
+    sw.keys = keys;
+    sw.targets = targets;
+}
+
+/**
+ * @brief Compila os tableswitch/lookupswitch do método uma única vez, na ligação.
+ * O tableswitch vira uma tabela de destinos absolutos indexada diretamente.
+ */
+static void compilar_switches(RuntimeMethod& m) {
+    const std::vector<uint8_t>& code = m.info->code_attribute.code;
+
+    for (uint32_t pc = 0; pc < code.size();) {
+        uint32_t len = tamanho_instrucao(code, pc);
+        if (len == 0 || pc + len > code.size()) break; // Bytecode inválido: o interpretador acusa ao executar
+
+        uint8_t opcode = code[pc];
+        if (opcode == 0xaa || opcode == 0xab) {
+            uint32_t base = (pc + 4) & ~3u;
+            SwitchTable sw;
+            sw.pc = pc;
+            sw.hash_shift = 0;
+            sw.hash_mult = 0;
+            sw.low = 0;
+            sw.default_target = pc + ler_s4(code, base);
+
+            if (opcode == 0xaa) {
+                sw.kind = SWITCH_DENSE;
+                sw.low = ler_s4(code, base + 4);
+                uint32_t count = (len - (base - pc) - 12) / 4;
+                for (uint32_t i = 0; i < count; i++) sw.targets.push_back(pc + ler_s4(code, base + 12 + 4 * i));
+            } else {
+                uint32_t npairs = (uint32_t)ler_s4(code, base + 4);
+                std::vector<int32_t> keys(npairs);
+                std::vector<uint32_t> targets(npairs);
+                for (uint32_t i = 0; i < npairs; i++) {
+                    keys[i] = ler_s4(code, base + 8 + 8 * i);
+                    targets[i] = pc + ler_s4(code, base + 12 + 8 * i);
+                }
+                compilar_lookupswitch(sw, keys, targets);
+
+                static const char* formas[] = {"tabela densa", "busca binaria", "hash perfeito"};
+                TRACE(TRACE_LINK, TRACE_INFO, "[SWITCH] {}.{} pc {}: lookupswitch com {} chave(s) -> {}",
+                      m.owner->name, m.name, pc, npairs, formas[sw.kind]);
+            }
+            m.switches.push_back(std::move(sw));
+        }
+        pc += len;
+    }
+}
+
+/**
+ * @brief Cria um CallSite (ainda não ligado) para cada invokedynamic do método e grava
+ * o índice do site nos dois bytes reservados da instrução: a execução chega ao site
+ * com uma leitura, sem busca.
+ */
+static void registrar_call_sites(RuntimeMethod& m) {
+    std::vector<uint8_t>& code = m.info->code_attribute.code;
+
+    for (uint32_t pc = 0; pc < code.size();) {
+        uint32_t len = tamanho_instrucao(code, pc);
+        if (len == 0 || pc + len > code.size()) break;
+
+        if (code[pc] == 0xba && m.call_sites.size() < 0xFFFF) {
+            CallSite site;
+            site.pc = pc;
+            site.cp_index = (uint16_t)((code[pc + 1] << 8) | code[pc + 2]);
+            site.arg_slots = 0;
+            site.target = nullptr;
+            site.literal_chars = 0;
+            site.literal_utf16 = false;
+
+            uint16_t index = (uint16_t)m.call_sites.size();
+            code[pc + 3] = (uint8_t)(index >> 8);
+            code[pc + 4] = (uint8_t)(index & 0xFF);
+            m.call_sites.push_back(std::move(site));
+        }
+        pc += len;
+    }
+}
+
+const SwitchTable* buscar_switch(const RuntimeMethod& method, uint32_t pc) {
+    const auto& switches = method.switches;
+    auto it = std::lower_bound(switches.begin(), switches.end(), pc,
+                               [](const SwitchTable& s, uint32_t p) { return s.pc < p; });
+    return (it != switches.end() && it->pc == pc) ? &*it : nullptr;
+}
+
+bool is_subtype_secundario(RuntimeClass* sub, RuntimeClass* super) {
+    if (__atomic_load_n(&sub->secondary_super_cache, __ATOMIC_RELAXED) == super) return true;
+
+    bool found = std::find(sub->secondary_supers.begin(), sub->secondary_supers.end(), super) != sub->secondary_supers.end();
+
+    // Covariância: S[] <: T[] se S <: T (arrays de primitivos só são subtipos de si mesmos)
+    if (!found && sub->element_class && super->element_class) {
+        found = is_subtype_of(sub->element_class, super->element_class);
+    }
+
+    if (found) __atomic_store_n(&sub->secondary_super_cache, super, __ATOMIC_RELAXED);
+    return found;
+}
+
+// Cria o método já na deque da classe e o registra em method_registry
+static RuntimeMethod& criar_runtime_method(RuntimeClass* owner, MethodInfo* info,
+                                           const std::string& name, const std::string& descriptor,
+                                           uint16_t access_flags) {
+    owner->methods.emplace_back();
+    RuntimeMethod& m = owner->methods.back();
+    m.id = (uint32_t)method_registry.size();
+    method_registry.push_back(&m);
+    m.owner = owner;
+    m.info = info;
+    m.name = name;
+    m.descriptor = descriptor;
+    m.access_flags = access_flags;
+    m.arg_slots = contar_slots_argumentos(descriptor);
+    m.return_type = tipo_retorno(descriptor);
+    m.impl_count = 0;
+    m.unique_impl = nullptr;
+    m.native = (!info || (access_flags & ACC_NATIVE)) ? buscar_nativo(owner, name, descriptor) : nullptr;
+    if (info) {
+        indexar_excecoes(m);
+        compilar_switches(m);
+        registrar_call_sites(m);
+    }
+    return m;
+}
+
+// =======================================================================
+// 4. CLASS HIERARCHY ANALYSIS (Incremental)
+// =======================================================================
+
+// Desfaz as ligações estáticas que dependiam de 'm' não ser sobrescrito
+static void invalidar_dependentes(RuntimeMethod& m) {
+    if (m.dependents.empty()) return;
+    TRACE(TRACE_LINK, TRACE_INFO, "[CHA] Invalidando {} site(s) ligado(s) a {}.{}{}",
+          m.dependents.size(), m.owner->name, m.name, m.descriptor);
+    // O flag sai antes do alvo: quem ainda ler o flag ligado vê o alvo antigo (válido) ou nullptr
+    for (CpCacheEntry* entry : m.dependents) {
+        __atomic_fetch_and(&entry->flags, (uint8_t)~CP_VFINAL, __ATOMIC_RELEASE);
+        __atomic_store_n(&entry->target, (RuntimeMethod*)nullptr, __ATOMIC_RELEASE);
+    }
+    m.dependents.clear();
+}
+
+/**
+ * @brief Atualiza a CHA com os métodos de uma classe recém-ligada.
+ * Cada implementação concreta é contada em todos os métodos de mesmo nome e
+ * descritor das superclasses. Quando o alvo único de um método muda, os sites
+ * de chamada que o ligaram estaticamente são invalidados.
+ */
+static void atualizar_cha(RuntimeClass& rc) {
+    for (auto& m : rc.methods) {
+        if (!is_virtual(m)) continue;
+
+        bool concreto = !(m.access_flags & ACC_ABSTRACT);
+        m.impl_count = concreto ? 1 : 0;
+        m.unique_impl = concreto ? &m : nullptr;
+        if (!concreto) continue;
+
+        for (RuntimeClass* anc = rc.super; anc != nullptr; anc = anc->super) {
+            RuntimeMethod* overridden = find_declared_method(anc, m.name, m.descriptor);
+            if (!overridden || !is_virtual(*overridden)) continue;
+
+            overridden->impl_count++;
+            overridden->unique_impl = (overridden->impl_count == 1) ? &m : nullptr;
+            invalidar_dependentes(*overridden);
+        }
+    }
+}
+
+// =======================================================================
+// 5. LAYOUT DE INSTÂNCIA
+// =======================================================================
+
+/**
+ * @brief Empacota os campos pendentes a partir de 'pos', de forma gulosa: a
+ * cada passo, o maior campo cujo alinhamento natural é satisfeito na posição
+ * atual. Isso preenche os buracos deixados pela superclasse antes de alinhar
+ * os campos de 8 bytes. Retorna o tamanho final (múltiplo de jword).
+ */
+static uint32_t empacotar_campos(std::vector<FieldLayout> pendentes, uint32_t pos, std::vector<FieldLayout>& out) {
+    // Maiores primeiro (estável: mantém a ordem de declaração entre campos do mesmo tamanho)
+    std::stable_sort(pendentes.begin(), pendentes.end(),
+                     [](const FieldLayout& a, const FieldLayout& b) { return a.size > b.size; });
+
+    while (!pendentes.empty()) {
+        auto escolhido = pendentes.end();
+        for (auto it = pendentes.begin(); it != pendentes.end(); ++it) {
+            if (pos % it->size == 0) { escolhido = it; break; }
+        }
+        if (escolhido == pendentes.end()) {
+            // Nenhum campo cabe alinhado: avança até o alinhamento do maior
+            uint32_t align = pendentes.front().size;
+            pos = (pos + align - 1) & ~(align - 1);
+            continue;
+        }
+        escolhido->offset = pos;
+        pos += escolhido->size;
+        out.push_back(*escolhido);
+        pendentes.erase(escolhido);
+    }
+
+    return (pos + sizeof(uint32_t) - 1) & ~(uint32_t)(sizeof(uint32_t) - 1);
+}
+
+static FieldLayout criar_field_layout(const std::string& name, const std::string& descriptor) {
+    FieldLayout fl;
+    fl.name = name;
+    fl.descriptor = descriptor;
+    fl.type = descriptor[0];
+    fl.size = tamanho_tipo(fl.type);
+    fl.offset = 0;
+    return fl;
+}
+
+// Campos de referência das instâncias (os herdados primeiro), percorridos pelo GC
+static void calcular_ref_offsets(RuntimeClass& rc) {
+    if (rc.super) rc.ref_offsets = rc.super->ref_offsets;
+    for (const auto& f : rc.fields) {
+        if (f.type == 'L' || f.type == '[') rc.ref_offsets.push_back(f.offset);
+    }
+}
+
+// Reserva o armazenamento estático (alinhado a 8 bytes e zerado)
+static void alocar_estaticos(RuntimeClass& rc, const std::vector<FieldLayout>& pendentes) {
+    uint32_t static_size = empacotar_campos(pendentes, 0, rc.static_fields);
+    rc.static_storage.assign((static_size + 7) / 8, 0);
+}
+
+/**
+ * @brief Calcula os layouts da classe: campos de instância (herdados ocupam o
+ * início do objeto, depois os próprios) e campos estáticos (área própria).
+ */
+static void calcular_layout(RuntimeClass& rc) {
+    std::vector<FieldLayout> instancia, estaticos;
+    const ConstantPool& pool = rc.class_file->constant_pool;
+    for (const auto& f : rc.class_file->fields) {
+        FieldLayout fl = criar_field_layout(get_utf8(pool, f.name_index), get_utf8(pool, f.descriptor_index));
+        if (f.access_flags & ACC_STATIC) estaticos.push_back(fl);
+        else instancia.push_back(fl);
+    }
+
+    rc.instance_size = empacotar_campos(instancia, rc.super ? rc.super->instance_size : 0, rc.fields);
+    calcular_ref_offsets(rc);
+    alocar_estaticos(rc, estaticos);
+}
+
+// Campos das classes de sistema sintéticas que o runtime conhece
+static void calcular_layout_sistema(RuntimeClass& rc) {
+    std::vector<FieldLayout> instancia, estaticos;
+    if (rc.name == "java/lang/Throwable") {
+        // 'backtrace' guarda apenas pares (id do método, pc) num int[]; as strings
+        // do stack trace só são montadas quando alguém pede
+        instancia.push_back(criar_field_layout("detailMessage", "Ljava/lang/String;"));
+        instancia.push_back(criar_field_layout("cause", "Ljava/lang/Throwable;"));
+        instancia.push_back(criar_field_layout("backtrace", "Ljava/lang/Object;"));
+    } else if (rc.name == "java/io/PrintStream") {
+        instancia.push_back(criar_field_layout("fd", "I")); // Descritor de arquivo (1: out, 2: err)
+    } else if (rc.name == "java/lang/StackTraceElement") {
+        instancia.push_back(criar_field_layout("declaringClass", "Ljava/lang/String;"));
+        instancia.push_back(criar_field_layout("methodName", "Ljava/lang/String;"));
+        instancia.push_back(criar_field_layout("fileName", "Ljava/lang/String;"));
+        instancia.push_back(criar_field_layout("lineNumber", "I"));
+    }
+    rc.instance_size = empacotar_campos(instancia, rc.super ? rc.super->instance_size : 0, rc.fields);
+    calcular_ref_offsets(rc);
+
+    if (rc.name == "java/lang/System") {
+        estaticos.push_back(criar_field_layout("out", "Ljava/io/PrintStream;"));
+        estaticos.push_back(criar_field_layout("err", "Ljava/io/PrintStream;"));
+        estaticos.push_back(criar_field_layout("in", "Ljava/io/InputStream;"));
+    }
+    alocar_estaticos(rc, estaticos);
+
+    // Sem <clinit>: apenas System precisa de inicialização (feita pelo interpretador)
+    if (estaticos.empty()) rc.init_state.store(CLASS_INITIALIZED);
+}
+
+const FieldLayout* find_static_field(RuntimeClass* cls, const std::string& name, const std::string& descriptor) {
+    for (const auto& f : cls->static_fields) {
+        if (f.name == name && f.descriptor == descriptor) return &f;
+    }
+    return nullptr;
+}
+
+const FieldLayout* find_field(RuntimeClass* cls, const std::string& name, const std::string& descriptor) {
+    for (RuntimeClass* c = cls; c != nullptr; c = c->super) {
+        for (const auto& f : c->fields) {
+            if (f.name == name && f.descriptor == descriptor) return &f;
+        }
+    }
+    return nullptr;
+}
+
+// =======================================================================
+// 6. CARREGAMENTO E LIGAÇÃO
+// =======================================================================
+
+// Superclasses das classes de sistema que o runtime lança ou que os programas capturam
+static std::string super_sistema(const std::string& name) {
+    static const std::map<std::string, std::string> hierarquia = {
+        {"java/lang/Throwable",                        "java/lang/Object"},
+        {"java/lang/Exception",                        "java/lang/Throwable"},
+        {"java/lang/Error",                            "java/lang/Throwable"},
+        {"java/lang/RuntimeException",                 "java/lang/Exception"},
+        {"java/lang/InterruptedException",             "java/lang/Exception"},
+        {"java/lang/CloneNotSupportedException",       "java/lang/Exception"},
+        {"java/lang/ArithmeticException",              "java/lang/RuntimeException"},
+        {"java/lang/NullPointerException",             "java/lang/RuntimeException"},
+        {"java/lang/ClassCastException",               "java/lang/RuntimeException"},
+        {"java/lang/ArrayStoreException",              "java/lang/RuntimeException"},
+        {"java/lang/NegativeArraySizeException",       "java/lang/RuntimeException"},
+        {"java/lang/IllegalArgumentException",         "java/lang/RuntimeException"},
+        {"java/lang/IllegalStateException",            "java/lang/RuntimeException"},
+        {"java/lang/IllegalMonitorStateException",     "java/lang/RuntimeException"},
+        {"java/lang/NumberFormatException",            "java/lang/IllegalArgumentException"},
+        {"java/lang/IndexOutOfBoundsException",        "java/lang/RuntimeException"},
+        {"java/lang/ArrayIndexOutOfBoundsException",   "java/lang/IndexOutOfBoundsException"},
+        {"java/lang/StringIndexOutOfBoundsException",  "java/lang/IndexOutOfBoundsException"},
+        {"java/lang/LinkageError",                     "java/lang/Error"},
+        {"java/lang/VerifyError",                      "java/lang/LinkageError"},
+        {"java/lang/NoClassDefFoundError",             "java/lang/LinkageError"},
+        {"java/lang/UnsatisfiedLinkError",             "java/lang/LinkageError"},
+        {"java/lang/ExceptionInInitializerError",      "java/lang/LinkageError"},
+        {"java/lang/BootstrapMethodError",             "java/lang/LinkageError"},
+        {"java/lang/VirtualMachineError",              "java/lang/Error"},
+        {"java/lang/StackOverflowError",               "java/lang/VirtualMachineError"},
+        {"java/lang/OutOfMemoryError",                 "java/lang/VirtualMachineError"},
+        {"java/lang/InternalError",                    "java/lang/VirtualMachineError"},
+    };
+    auto it = hierarquia.find(name);
+    return it != hierarquia.end() ? it->second : "java/lang/Object";
+}
+
+static void adicionar_secundario(RuntimeClass& rc, RuntimeClass* super) {
+    if (std::find(rc.secondary_supers.begin(), rc.secondary_supers.end(), super) == rc.secondary_supers.end()) {
+        rc.secondary_supers.push_back(super);
+    }
+}
+
+/**
+ * @brief Monta o display de supertipos primários (herdado da superclasse, mais a
+ * própria classe na sua profundidade) e a lista de supertipos secundários
+ * (interfaces diretas e as delas, herdadas da superclasse).
+ */
+static void calcular_supertipos(RuntimeClass& rc, const std::vector<RuntimeClass*>& interfaces) {
+    if (rc.super) {
+        std::copy(rc.super->primary_supers, rc.super->primary_supers + PRIMARY_SUPER_DEPTH, rc.primary_supers);
+        rc.depth = rc.super->depth + 1;
+        rc.secondary_supers = rc.super->secondary_supers;
+    }
+
+    bool no_display = (rc.access_flags & ACC_INTERFACE) || rc.name[0] == '[';
+    if (!no_display && rc.depth < PRIMARY_SUPER_DEPTH) {
+        rc.display_index = (int8_t)rc.depth;
+        rc.primary_supers[rc.depth] = &rc;
+    } else if (!no_display) {
+        adicionar_secundario(rc, &rc); // Classe profunda: testada pela lista secundária
+    }
+
+    for (RuntimeClass* i : interfaces) {
+        adicionar_secundario(rc, i);
+        for (RuntimeClass* s : i->secondary_supers) adicionar_secundario(rc, s);
+    }
+}
+
+// Classes de sistema sintéticas só descobrem que são interfaces quando alguém as implementa
+static RuntimeClass* carregar_interface(const std::string& name) {
+    RuntimeClass* i = carregar_classe(name);
+    if (!i->class_file && !(i->access_flags & ACC_INTERFACE)) {
+        i->access_flags |= ACC_INTERFACE | ACC_ABSTRACT;
+        i->display_index = -1;
+    }
+    return i;
+}
+
+static void ligar_classe(RuntimeClass& rc) {
+    ClassFile* cf = rc.class_file;
+
+    // 1. Superclasse (carregada recursivamente)
+    rc.super = nullptr;
+    if (cf) {
+        if (cf->super_class_idx != 0) {
+            rc.super = carregar_classe(get_class_name(cf->constant_pool, cf->super_class_idx));
+        }
+    } else if (rc.name != "java/lang/Object") {
+        rc.super = carregar_classe(super_sistema(rc.name));
+    }
+    if (rc.super) rc.super->subclasses.push_back(&rc);
+
+    // 2. Supertipos (display primário e interfaces)
+    std::vector<RuntimeClass*> interfaces;
+    if (cf) {
+        for (uint16_t idx : cf->interfaces) interfaces.push_back(carregar_interface(get_class_name(cf->constant_pool, idx)));
+    } else if (rc.name[0] == '[') {
+        // Array: elemento ("[I" não tem classe de elemento), Cloneable e Serializable
+        const std::string component = rc.name.substr(1);
+        if (component[0] == '[') rc.element_class = carregar_classe(component);
+        else if (component[0] == 'L') rc.element_class = carregar_classe(component.substr(1, component.size() - 2));
+        if (rc.element_class) rc.element_class->array_class = &rc;
+        interfaces.push_back(carregar_interface("java/lang/Cloneable"));
+        interfaces.push_back(carregar_interface("java/io/Serializable"));
+    }
+    calcular_supertipos(rc, interfaces);
+
+    if (rc.name[0] == '[') {
+        rc.layout = LAYOUT_ARRAY;
+        rc.element_size = tamanho_tipo(rc.name[1]); // Largura natural: byte[] usa 1 byte por elemento
+    } else if (rc.name == "java/lang/String") {
+        rc.layout = LAYOUT_STRING; // Tamanho pela codificação (tamanho_objeto)
+    }
+
+    if (!cf) {
+        // Classe de sistema: métodos sintéticos são criados sob demanda
+        calcular_layout_sistema(rc);
+        return;
+    }
+
+    // 3. Métodos
+    for (auto& info : cf->methods) {
+        criar_runtime_method(&rc, &info,
+                             get_utf8(cf->constant_pool, info.name_index),
+                             get_utf8(cf->constant_pool, info.descriptor_index),
+                             info.access_flags);
+    }
+
+    // 4. Cache do Constant Pool (preenchido na primeira execução de cada referência)
+    rc.cp_cache.resize(cf->constant_pool.size());
+
+    // 5. Layout dos campos (instância e estáticos)
+    calcular_layout(rc);
+
+    // 6. Hierarquia
+    atualizar_cha(rc);
+}
+
+RuntimeClass* registrar_classe(const std::string& class_name, ClassFile&& class_data) {
+    method_area[class_name] = std::move(class_data);
+
+    RuntimeClass& rc = class_table[class_name];
+    rc.name = class_name;
+    rc.class_file = &method_area[class_name];
+    rc.access_flags = rc.class_file->access_flags;
+    ligar_classe(rc);
+    return &rc;
+}
+
+RuntimeClass* carregar_classe(const std::string& class_name) {
+    // 1. Verificar se já está carregada
+    auto it = class_table.find(class_name);
+    if (it != class_table.end()) {
+        return &it->second;
+    }
+
+    // 2. Tentar carregar do disco (assumindo diretório atual e extensão .class)
+    std::string filename = class_name + ".class";
+    std::ifstream probe(filename, std::ios::binary);
+
+    if (!probe || class_name[0] == '[') {
+        // Sem .class disponível (java/lang/..., arrays): classe de sistema sintética
+        RuntimeClass& rc = class_table[class_name];
+        rc.name = class_name;
+        rc.class_file = nullptr;
+        rc.access_flags = ACC_PUBLIC;
+        ligar_classe(rc);
+        return &rc;
+    }
+    probe.close();
+
+    TRACE(TRACE_LOADER, TRACE_INFO, "Carregando classe: {} ({})", class_name, filename);
+
+    ClassFile new_class;
+    ler_class_file(filename, new_class);
+    return registrar_classe(class_name, std::move(new_class));
+}
+
+RuntimeClass* classe_array(RuntimeClass* element) {
+    if (!element->array_class) {
+        carregar_classe(element->name[0] == '[' ? "[" + element->name : "[L" + element->name + ";");
+    }
+    return element->array_class;
+}
+
+ClassFile* get_class_from_method_area(const std::string& class_name) {
+    try {
+        return carregar_classe(class_name)->class_file;
+    } catch (const std::exception& e) {
+        std::cerr << "[Loader] ERRO ao carregar classe " << class_name << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+// =======================================================================
+// 7. RESOLUÇÃO DE METHODREFS (Cache do CP + Devirtualização)
+// =======================================================================
+
+CpCacheEntry& resolver_methodref(RuntimeClass* cls, uint16_t cp_index) {
+    CpCacheEntry& entry = cls->cp_cache.at(cp_index);
+    if (entry.flags & CP_RESOLVED) return entry;
+
+    const ConstantPool& pool = cls->class_file->constant_pool;
+    const ConstantInfo& c = pool.at(cp_index);
+    const ConstantInfo& nat = pool.at(c.index2);
+    std::string name = get_utf8(pool, nat.index1);
+    std::string descriptor = get_utf8(pool, nat.index2);
+
+    RuntimeClass* ref_class = carregar_classe(get_class_name(pool, c.index1));
+    RuntimeMethod* m = find_method(ref_class, name, descriptor);
+
+    if (!m) {
+        // Métodos herdados de classes de sistema: cria o método sintético na
+        // primeira superclasse sem .class (onde o método real estaria)
+        RuntimeClass* sys = ref_class;
+        while (sys->class_file != nullptr && sys->super != nullptr) sys = sys->super;
+        if (sys->class_file != nullptr) {
+            throw std::runtime_error("NoSuchMethodError: " + ref_class->name + "." + name + descriptor);
+        }
+        m = &criar_runtime_method(sys, nullptr, name, descriptor, ACC_PUBLIC);
+    }
+
+    entry.method = m;
+    entry.flags |= CP_RESOLVED;
+
+    // Devirtualização: métodos de sistema ficam sempre no caminho virtual
+    if (m->info != nullptr && is_virtual(*m)) {
+        // O alvo é publicado antes do flag (os mesmos bits de flags que CP_INIT_DONE, também atômicos)
+        if ((m->access_flags & ACC_FINAL) || (m->owner->access_flags & ACC_FINAL)) {
+            __atomic_store_n(&entry.target, m, __ATOMIC_RELEASE);
+            __atomic_fetch_or(&entry.flags, (uint8_t)CP_VFINAL, __ATOMIC_RELEASE);
+        } else if (m->impl_count == 1) {
+            __atomic_store_n(&entry.target, m->unique_impl, __ATOMIC_RELEASE);
+            __atomic_fetch_or(&entry.flags, (uint8_t)CP_VFINAL, __ATOMIC_RELEASE);
+            m->dependents.push_back(&entry);
+        }
+    }
+    return entry;
+}
+
+// =======================================================================
+// 8. RESOLUÇÃO DE CLASSES E FIELDREFS
+// =======================================================================
+
+RuntimeClass* resolver_classe(RuntimeClass* cls, uint16_t cp_index) {
+    CpCacheEntry& entry = cls->cp_cache.at(cp_index);
+    if (!(entry.flags & CP_RESOLVED)) {
+        entry.klass = carregar_classe(get_class_name(cls->class_file->constant_pool, cp_index));
+        entry.flags |= CP_RESOLVED;
+    }
+    return entry.klass;
+}
+
+CpCacheEntry& resolver_fieldref(RuntimeClass* cls, uint16_t cp_index, bool is_static) {
+    CpCacheEntry& entry = cls->cp_cache.at(cp_index);
+    if (entry.flags & CP_RESOLVED) return entry;
+
+    const ConstantPool& pool = cls->class_file->constant_pool;
+    const ConstantInfo& c = pool.at(cp_index);
+    const ConstantInfo& nat = pool.at(c.index2);
+    std::string name = get_utf8(pool, nat.index1);
+    std::string descriptor = get_utf8(pool, nat.index2);
+
+    RuntimeClass* ref_class = carregar_classe(get_class_name(pool, c.index1));
+
+    if (is_static) {
+        // O campo pode ter sido declarado por uma superclasse: ela é quem será inicializada
+        for (RuntimeClass* decl = ref_class; decl != nullptr; decl = decl->super) {
+            const FieldLayout* field = find_static_field(decl, name, descriptor);
+            if (!field) continue;
+
+            entry.klass = decl;
+            entry.field_offset = field->offset;
+            entry.field_type = field->type;
+            entry.static_addr = decl->static_base() + field->offset;
+            entry.flags |= CP_RESOLVED;
+            return entry;
+        }
+        throw std::runtime_error("NoSuchFieldError: " + ref_class->name + "." + name);
+    }
+
+    const FieldLayout* field = find_field(ref_class, name, descriptor);
+    if (!field) {
+        throw std::runtime_error("NoSuchFieldError: " + ref_class->name + "." + name);
+    }
+
+    entry.klass = ref_class;
+    entry.field_offset = field->offset;
+    entry.field_type = field->type;
+    entry.flags |= CP_RESOLVED;
+    return entry;
+}
+
+// =======================================================================
+// 9. INVOKEDYNAMIC (Bootstrap dos sites de chamada)
+// =======================================================================
+
+// Marcadores das receitas do StringConcatFactory
+#define RECIPE_ARG   '\1'
+#define RECIPE_CONST '\2'
+
+// Texto de uma constante estática do bootstrap (argumentos \2 da receita)
+static bool texto_constante(const ConstantPool& pool, uint16_t index, std::string& out) {
+    const ConstantInfo& c = pool.at(index);
+    switch (c.tag) {
+        case CONSTANT_String:  out = get_utf8(pool, c.index1); return true;
+        case CONSTANT_Integer: out = std::to_string((int32_t)c.bytes4); return true;
+        case CONSTANT_Long:    out = std::to_string((int64_t)(((uint64_t)c.high_bytes << 32) | c.low_bytes)); return true;
+        default:               return false;
+    }
+}
+
+// Tipo ('L' também para arrays) e slot de cada argumento do descritor
+static std::vector<std::pair<char, uint16_t>> argumentos_descritor(const std::string& descriptor) {
+    std::vector<std::pair<char, uint16_t>> args;
+    uint16_t slot = 0;
+    for (size_t i = 1; i < descriptor.size() && descriptor[i] != ')'; i++) {
+        char type = descriptor[i];
+        while (descriptor[i] == '[') i++;
+        if (type == '[') type = 'L';
+        if (descriptor[i] == 'L') i = descriptor.find(';', i);
+        if (i == std::string::npos) break;
+        args.push_back({type, slot});
+        slot += (type == 'J' || type == 'D') ? 2 : 1;
+    }
+    return args;
+}
+
+/**
+ * @brief Compila a receita em partes: cada \1 consome o próximo argumento dinâmico,
+ * cada \2 a próxima constante estática; textos consecutivos viram uma só parte.
+ * A receita e as constantes são UTF-8 modificado: cada parte é decodificada uma vez, aqui.
+ */
+static bool compilar_receita(CallSite& site, const std::string& recipe, const std::vector<std::pair<char, uint16_t>>& args,
+                             const std::vector<std::string>& constants, std::string& erro) {
+    site.parts.clear();
+    site.literal_chars = 0;
+    site.literal_utf16 = false;
+    size_t next_arg = 0, next_const = 0;
+    std::string texto; // Parte constante em andamento, ainda em UTF-8 modificado
+    auto fechar_texto = [&]() {
+        if (texto.empty()) return;
+        std::vector<uint16_t> chars = decodificar_utf8(texto);
+        for (uint16_t c : chars) site.literal_utf16 |= c > 0xFF;
+        site.literal_chars += chars.size();
+        site.parts.push_back({0, 0, std::move(chars)});
+        texto.clear();
+    };
+
+    // Bytes de continuação do UTF-8 são >= 0x80: nunca se confundem com \1 ou \2
+    for (char c : recipe) {
+        if (c == RECIPE_ARG) {
+            if (next_arg >= args.size()) { erro = "receita com mais argumentos que o descritor"; return false; }
+            fechar_texto();
+            site.parts.push_back({args[next_arg].first, args[next_arg].second, std::vector<uint16_t>()});
+            next_arg++;
+        } else if (c == RECIPE_CONST) {
+            if (next_const >= constants.size()) { erro = "receita com mais constantes que o bootstrap"; return false; }
+            texto += constants[next_const++];
+        } else {
+            texto += c;
+        }
+    }
+    fechar_texto();
+    if (next_arg != args.size()) { erro = "argumentos do descritor sem uso na receita"; return false; }
+    return true;
+}
+
+bool ligar_call_site(RuntimeClass* cls, CallSite& site, std::string& erro) {
+    const ClassFile* cf = cls->class_file;
+    const ConstantPool& pool = cf->constant_pool;
+    const ConstantInfo& indy = pool.at(site.cp_index);
+    if (indy.tag != CONSTANT_InvokeDynamic || indy.index1 >= cf->bootstrap_methods.size()) {
+        erro = "entrada #" + std::to_string(site.cp_index) + " nao e um InvokeDynamic valido";
+        return false;
+    }
+
+    const BootstrapMethod& bsm = cf->bootstrap_methods[indy.index1];
+    const ConstantInfo& nat = pool.at(indy.index2);
+    const std::string descriptor = get_utf8(pool, nat.index2);
+
+    // MethodHandle -> Methodref do método de bootstrap
+    const ConstantInfo& handle = pool.at(bsm.method_ref);
+    const ConstantInfo& ref = pool.at(handle.index2);
+    const std::string bsm_class = get_class_name(pool, ref.index1);
+    const std::string bsm_name = get_utf8(pool, pool.at(ref.index2).index1);
+
+    if (bsm_class == "java/lang/invoke/StringConcatFactory" && tipo_retorno(descriptor) == 'L') {
+        const std::vector<std::pair<char, uint16_t>> args = argumentos_descritor(descriptor);
+        std::string recipe;
+        std::vector<std::string> constants;
+        if (bsm_name == "makeConcatWithConstants") {
+            if (bsm.arguments.empty() || pool.at(bsm.arguments[0]).tag != CONSTANT_String) {
+                erro = "makeConcatWithConstants sem receita";
+                return false;
+            }
+            recipe = get_utf8(pool, pool.at(bsm.arguments[0]).index1);
+            for (size_t i = 1; i < bsm.arguments.size(); i++) {
+                constants.emplace_back();
+                if (!texto_constante(pool, bsm.arguments[i], constants.back())) {
+                    erro = "constante de receita nao suportada (#" + std::to_string(bsm.arguments[i]) + ")";
+                    return false;
+                }
+            }
+        } else if (bsm_name == "makeConcat") {
+            recipe.assign(args.size(), RECIPE_ARG); // Sem constantes: só os argumentos, em ordem
+        } else {
+            erro = "bootstrap nao suportado: " + bsm_class + "." + bsm_name;
+            return false;
+        }
+
+        site.arg_slots = (uint16_t)contar_slots_argumentos(descriptor);
+        if (!compilar_receita(site, recipe, args, constants, erro)) return false;
+        site.target = concatenar_strings;
+        TRACE(TRACE_LINK, TRACE_INFO, "[INDY] {} pc {}: {} ligado ({} parte(s), {} char(s) constantes)",
+              cls->name, site.pc, bsm_name, site.parts.size(), site.literal_chars);
+        return true;
+    }
+
+    erro = "bootstrap nao suportado: " + bsm_class + "." + bsm_name;
+    return false;
+}
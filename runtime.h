@@ -0,0 +1,345 @@
+// runtime.h
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "classfile.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+// Flags de acesso (classes e métodos) usadas durante a ligação
+#define ACC_PUBLIC       0x0001
+#define ACC_PRIVATE      0x0002
+#define ACC_STATIC       0x0008
+#define ACC_FINAL        0x0010
+#define ACC_SYNCHRONIZED 0x0020
+#define ACC_NATIVE       0x0100
+#define ACC_INTERFACE    0x0200
+#define ACC_ABSTRACT     0x0400
+
+// Flags de uma entrada do cache do Constant Pool
+#define CP_RESOLVED      0x01 // Referência (Methodref, Fieldref ou Class) já resolvida
+#define CP_VFINAL        0x02 // Chamada efetivamente final (ligada estaticamente via CHA)
+#define CP_INIT_DONE     0x04 // Classe da referência já inicializada: acesso sem verificações
+
+// Profundidade do display de supertipos primários (java/lang/Object tem profundidade 0)
+#define PRIMARY_SUPER_DEPTH 8
+
+// Forma das instâncias de uma classe no heap (o cabeçalho do objeto só aponta para a classe)
+#define LAYOUT_INSTANCE     0 // Campos no layout da classe (instance_size bytes)
+#define LAYOUT_ARRAY        1 // length * element_size bytes de elementos
+#define LAYOUT_STRING       2 // java/lang/String: hash em cache e length chars (Latin-1 ou UTF-16)
+
+// Estados de inicialização de uma classe (JVMS 5.5)
+#define CLASS_LINKED        0
+#define CLASS_BEING_INIT    1
+#define CLASS_INITIALIZED   2
+#define CLASS_ERROR         3
+
+struct RuntimeClass;
+struct CpCacheEntry;
+struct Frame;
+
+// Implementação C++ de um método (nativo ou intrínseco): consome os argumentos da pilha
+// de operandos do chamador e empilha o retorno; 'pc' é o do invoke (para lançar exceções)
+typedef void (*NativeMethod)(Frame& frame, uint32_t pc);
+
+// =======================================================================
+// 1. METADADOS DE RUNTIME (Classes e Métodos ligados)
+// =======================================================================
+
+// Faixa de pcs [start, end) sem sobreposição parcial com outras faixas, com os
+// handlers da exception_table que a cobrem (na ordem da tabela)
+struct ExceptionRange {
+    uint16_t start;
+    uint16_t end;
+    uint16_t first;          // Primeiro índice em RuntimeMethod::exception_handlers
+    uint16_t count;
+};
+
+// Formas de despacho de um switch compilado
+#define SWITCH_DENSE     0 // Tabela indexada por (chave - low): tableswitch e lookupswitch densos
+#define SWITCH_BINARY    1 // Busca binária nas chaves ordenadas
+#define SWITCH_HASH      2 // Hash perfeito multiplicativo (chaves esparsas)
+
+// tableswitch/lookupswitch compilado na preparação do método, com destinos absolutos
+struct SwitchTable {
+    uint32_t pc;             // pc da instrução no método
+    uint8_t kind;
+    uint8_t hash_shift;      // SWITCH_HASH: slot = (chave * hash_mult) >> hash_shift
+    uint32_t hash_mult;
+    int32_t low;             // SWITCH_DENSE: menor chave
+    uint32_t default_target;
+    std::vector<int32_t> keys;     // SWITCH_BINARY: chaves ordenadas; SWITCH_HASH: chave de cada slot
+    std::vector<uint32_t> targets; // Destino de cada entrada (slots vazios apontam para o default)
+
+    uint32_t destino(int32_t key) const {
+        switch (kind) {
+            case SWITCH_DENSE: {
+                uint32_t i = (uint32_t)key - (uint32_t)low; // Chaves abaixo de 'low' dão a volta
+                return i < targets.size() ? targets[i] : default_target;
+            }
+            case SWITCH_HASH: {
+                uint32_t slot = ((uint32_t)key * hash_mult) >> hash_shift;
+                return keys[slot] == key ? targets[slot] : default_target;
+            }
+            default: {
+                auto it = std::lower_bound(keys.begin(), keys.end(), key);
+                return (it != keys.end() && *it == key) ? targets[it - keys.begin()] : default_target;
+            }
+        }
+    }
+};
+
+struct CallSite;
+
+// Alvo ligado de um invokedynamic: consome os argumentos dinâmicos e empilha o resultado
+typedef void (*CallSiteTarget)(Frame& frame, uint32_t pc, const CallSite& site);
+
+// Parte de uma receita de concatenação (StringConcatFactory): texto constante ou argumento
+struct ConcatPart {
+    char type;               // 0: constante; senão o tipo do argumento ('I', 'J', 'C', 'L', ...)
+    uint16_t slot;           // Argumento: slot a partir do primeiro argumento na pilha de operandos
+    std::vector<uint16_t> literal; // Constante: chars UTF-16 (constantes \2 já substituídas e unidas às vizinhas)
+};
+
+// Site de chamada invokedynamic. Cada instrução é um site próprio: os dois bytes
+// reservados do invokedynamic passam a guardar o índice do site em RuntimeMethod::call_sites.
+struct CallSite {
+    uint32_t pc;
+    uint16_t cp_index;       // CONSTANT_InvokeDynamic
+    uint16_t arg_slots;      // Slots dos argumentos dinâmicos
+    CallSiteTarget target;   // nullptr até a primeira execução (bootstrap)
+
+    // StringConcatFactory: receita compilada, total de chars constantes e se algum não cabe em Latin-1
+    std::vector<ConcatPart> parts;
+    size_t literal_chars;
+    bool literal_utf16;
+};
+
+// Sem estado no mapa de referências: meio de instrução ou pc inalcançável
+#define MAPA_SEM_ESTADO  0xFFFFFFFFu
+
+/**
+ * @brief Mapa de referências de um método (GC preciso): para cada início de
+ * instrução, quais slots das variáveis locais e da pilha de operandos guardam
+ * referências antes de a instrução executar. Calculado por análise de fluxo
+ * do bytecode na primeira coleta que encontra um frame do método.
+ */
+struct MapaReferencias {
+    std::vector<uint32_t> indice;       // Por pc: início do estado em 'slots' (ou MAPA_SEM_ESTADO)
+    std::vector<uint16_t> profundidade; // Por pc: altura da pilha de operandos
+    std::vector<uint8_t> slots;         // max_locals + profundidade bytes por estado (1: referência)
+
+    bool calculado() const { return !indice.empty(); }
+};
+
+// Método ligado: informações do descritor calculadas uma única vez
+struct RuntimeMethod {
+    uint32_t id;             // Índice em method_registry (identificador compacto, usado nos backtraces)
+    RuntimeClass* owner;
+    MethodInfo* info;        // nullptr para métodos de classes de sistema (sem .class)
+    std::string name;
+    std::string descriptor;
+    uint16_t access_flags;
+    int arg_slots;           // Slots dos argumentos, sem o 'this' (long/double ocupam 2)
+    char return_type;        // Primeiro caractere do tipo de retorno ('V', 'I', 'J', 'L', ...)
+    NativeMethod native;     // Ligado uma vez, na criação do método (sem bytecode ou ACC_NATIVE)
+
+    // --- Class Hierarchy Analysis ---
+    // Implementações concretas deste método na subárvore de 'owner' (incluindo ele mesmo).
+    // Com exatamente uma, 'unique_impl' é o único alvo possível de uma chamada virtual.
+    int impl_count;
+    RuntimeMethod* unique_impl;
+    // Sites de chamada ligados estaticamente assumindo que o método não é sobrescrito
+    std::vector<CpCacheEntry*> dependents;
+
+    // Índice da exception_table: faixas ordenadas por 'start' (busca binária pelo pc)
+    std::vector<ExceptionRange> exception_ranges;
+    std::vector<uint16_t> exception_handlers; // Índices na exception_table
+
+    std::vector<SwitchTable> switches;        // Switches do método, ordenados por pc
+    std::vector<CallSite> call_sites;         // Sites invokedynamic, na ordem do bytecode
+    MapaReferencias mapa_referencias;         // Raízes precisas dos frames deste método (gc.cpp)
+
+    bool has_code() const { return info != nullptr && info->code_attribute.code_length > 0; }
+};
+
+// Campo de instância no layout de uma classe
+struct FieldLayout {
+    std::string name;
+    std::string descriptor;
+    uint32_t offset;         // Deslocamento em bytes dentro dos dados do objeto
+    uint8_t size;            // 1, 2, 4 ou 8 bytes (referências ocupam um jword)
+    char type;               // Primeiro caractere do descritor ('I', 'J', 'L', '[', ...)
+};
+
+// Entrada do cache do Constant Pool (uma por índice do CP da classe)
+struct CpCacheEntry {
+    uint8_t flags;
+    RuntimeMethod* method;   // Método declarado, resolvido a partir da Methodref
+    RuntimeMethod* target;   // Alvo ligado estaticamente quando CP_VFINAL está ligado
+    RuntimeClass* klass;     // Classe resolvida (CONSTANT_Class)
+    uint32_t field_offset;   // Fieldref: deslocamento em bytes do campo
+    char field_type;         // Fieldref: tipo do campo
+    uint8_t* static_addr;    // Fieldref estática: endereço direto do valor
+    uint32_t* string;        // CONSTANT_String: slot (jref) da String internada, raiz do GC
+
+    CpCacheEntry() : flags(0), method(nullptr), target(nullptr), klass(nullptr),
+                     field_offset(0), field_type(0), static_addr(nullptr), string(nullptr) {}
+};
+
+struct RuntimeClass {
+    std::string name;
+    ClassFile* class_file;   // nullptr: classe de sistema sintética (java/lang/Object, ...)
+    uint16_t access_flags;
+    RuntimeClass* super;
+    std::vector<RuntimeClass*> subclasses; // Subclasses diretas já carregadas
+    std::deque<RuntimeMethod> methods;     // deque: ponteiros estáveis ao adicionar métodos
+    std::vector<CpCacheEntry> cp_cache;
+
+    // Layout de instância: campos herdados primeiro, depois os próprios,
+    // empacotados por tamanho e alinhamento
+    std::vector<FieldLayout> fields;       // Apenas os campos declarados por esta classe
+    uint32_t instance_size;                // Tamanho dos dados do objeto em bytes (múltiplo de jword)
+    std::vector<uint32_t> ref_offsets;     // Deslocamentos de todos os campos de referência (herdados inclusive)
+
+    // Campos estáticos: layout próprio e armazenamento (endereços fixos após a ligação)
+    std::vector<FieldLayout> static_fields;
+    std::vector<uint64_t> static_storage;
+    bool estaticos_sujos;                  // Algum estático recebeu uma referência ao berçário (gc.h)
+
+    // Inicialização (JVMS 5.5): 'init_state' é lido sem lock no caminho rápido
+    std::atomic<uint8_t> init_state;
+    std::thread::id init_thread;           // Thread executando o <clinit>
+    std::mutex init_lock;
+    std::condition_variable init_cv;
+
+    // Subtipagem: primary_supers[d] é o ancestral de profundidade d. Para uma classe T
+    // com display_index >= 0, "S <: T" é uma única comparação em S->primary_supers.
+    uint16_t depth;
+    int8_t display_index;                  // -1: interfaces, arrays e classes mais profundas que o display
+    RuntimeClass* primary_supers[PRIMARY_SUPER_DEPTH];
+    std::vector<RuntimeClass*> secondary_supers; // Interfaces (transitivas) e ancestrais fora do display
+    RuntimeClass* secondary_super_cache;   // Último supertipo secundário confirmado
+
+    // Arrays: classe do elemento (nullptr para arrays de primitivos); e a classe
+    // do array deste tipo, criada sob demanda
+    RuntimeClass* element_class;
+    RuntimeClass* array_class;
+
+    // Forma das instâncias: tamanho dos dados = instance_size ou length * element_size
+    uint8_t layout;
+    uint8_t element_size;                  // Arrays: largura natural do tipo (1, 2, 4 ou 8; jref: 4)
+
+    // Objeto que representa a classe: lock dos métodos static synchronized (0: ainda não criado)
+    uint32_t mirror;
+
+    RuntimeClass() : class_file(nullptr), access_flags(0), super(nullptr),
+                     instance_size(0), estaticos_sujos(false), init_state(CLASS_LINKED), depth(0), display_index(-1),
+                     primary_supers(), secondary_super_cache(nullptr),
+                     element_class(nullptr), array_class(nullptr),
+                     layout(LAYOUT_INSTANCE), element_size(0), mirror(0) {}
+
+    uint8_t* static_base() { return reinterpret_cast<uint8_t*>(static_storage.data()); }
+};
+
+// Method Area: Mapa de Nome da Classe -> ClassFile carregado
+extern std::map<std::string, ClassFile> method_area;
+
+// Classes ligadas: Nome da Classe -> metadados de runtime
+extern std::map<std::string, RuntimeClass> class_table;
+
+// Todos os métodos ligados, indexados por RuntimeMethod::id
+extern std::vector<RuntimeMethod*> method_registry;
+
+// =======================================================================
+// 2. CARREGAMENTO E LIGAÇÃO
+// =======================================================================
+
+// Função para obter (ou carregar) uma classe
+ClassFile* get_class_from_method_area(const std::string& class_name);
+
+/**
+ * @brief Registra um ClassFile já lido na Method Area e liga a classe
+ * (superclasse, métodos e atualização incremental da CHA).
+ */
+RuntimeClass* registrar_classe(const std::string& class_name, ClassFile&& class_data);
+
+/**
+ * @brief Retorna a classe ligada, carregando-a do disco se necessário.
+ * Classes sem .class disponível (java/...) viram classes de sistema sintéticas.
+ */
+RuntimeClass* carregar_classe(const std::string& class_name);
+
+// Busca um método pelo nome e descritor na classe e em suas superclasses
+RuntimeMethod* find_method(RuntimeClass* cls, const std::string& name, const std::string& descriptor);
+
+/**
+ * @brief Resolve a Methodref 'cp_index' do CP de 'cls' uma única vez (cache do CP).
+ * Chamadas virtuais com um único alvo possível são marcadas CP_VFINAL e
+ * registradas como dependência do método resolvido.
+ */
+CpCacheEntry& resolver_methodref(RuntimeClass* cls, uint16_t cp_index);
+
+// Resolve uma CONSTANT_Class do CP de 'cls' (carregando a classe) uma única vez
+RuntimeClass* resolver_classe(RuntimeClass* cls, uint16_t cp_index);
+
+/**
+ * @brief Resolve a Fieldref 'cp_index' uma única vez: o cache guarda o
+ * deslocamento em bytes e o tipo do campo. Para campos estáticos, guarda
+ * também a classe que declara o campo e o endereço direto do valor.
+ */
+CpCacheEntry& resolver_fieldref(RuntimeClass* cls, uint16_t cp_index, bool is_static = false);
+
+// Busca um campo de instância na classe e em suas superclasses
+const FieldLayout* find_field(RuntimeClass* cls, const std::string& name, const std::string& descriptor);
+
+// Busca um campo estático declarado pela própria classe
+const FieldLayout* find_static_field(RuntimeClass* cls, const std::string& name, const std::string& descriptor);
+
+/**
+ * @brief Busca a faixa de handlers que cobre 'pc' em O(log n).
+ * @return nullptr se nenhuma entrada da exception_table cobre o pc.
+ */
+const ExceptionRange* buscar_faixa_excecao(const RuntimeMethod& method, uint32_t pc);
+
+// Switch compilado da instrução em 'pc' (tableswitch ou lookupswitch)
+const SwitchTable* buscar_switch(const RuntimeMethod& method, uint32_t pc);
+
+/**
+ * @brief Liga o site invokedynamic executando (internamente) o seu método de bootstrap.
+ * Suporta StringConcatFactory.makeConcatWithConstants e makeConcat.
+ * @return false se o bootstrap não é suportado ou é inválido ('erro' descreve o motivo).
+ */
+bool ligar_call_site(RuntimeClass* cls, CallSite& site, std::string& erro);
+
+// Tamanho em bytes da instrução em 'pc' (inclui o padding dos switches e o prefixo wide)
+uint32_t tamanho_instrucao(const std::vector<uint8_t>& code, uint32_t pc);
+
+// Classe do array de elementos 'element' ("[L...;" ou "[[...")
+RuntimeClass* classe_array(RuntimeClass* element);
+
+// Caminho lento da subtipagem: lista secundária (com cache de uma entrada) e covariância de arrays
+bool is_subtype_secundario(RuntimeClass* sub, RuntimeClass* super);
+
+// Subtipagem (sub <: super) em tempo constante pelo display de supertipos primários
+inline bool is_subtype_of(RuntimeClass* sub, RuntimeClass* super) {
+    if (sub == super) return true;
+    if (super->display_index >= 0) return sub->primary_supers[super->display_index] == super;
+    return is_subtype_secundario(sub, super);
+}
+
+// Auxiliares de descritor
+int contar_slots_argumentos(const std::string& descriptor);
+char tipo_retorno(const std::string& descriptor);
+uint8_t tamanho_tipo(char type); // Bytes ocupados por um campo do tipo dado
+
+#endif // RUNTIME_H
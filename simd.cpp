@@ -0,0 +1,418 @@
+// simd.cpp
+
+#include "simd.h"
+#include "trace.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#define ALVO_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_X86 0
+#endif
+
+// =======================================================================
+// 1. ESCALAR
+// =======================================================================
+
+// Bits de 'valor' repetidos nos 8 bytes: o padrão de qualquer largura cabe num uint64_t
+static uint64_t replicar(size_t largura, uint64_t valor) {
+    switch (largura) {
+        case 1:  return (valor & 0xFF) * 0x0101010101010101ull;
+        case 2:  return (valor & 0xFFFF) * 0x0001000100010001ull;
+        case 4:  return (valor & 0xFFFFFFFF) * 0x0000000100000001ull;
+        default: return valor;
+    }
+}
+
+static void preencher_escalar(uint8_t* dst, size_t n, size_t largura, uint64_t valor) {
+    for (size_t i = 0; i < n; i++) std::memcpy(dst + i * largura, &valor, largura); // Little-endian: bytes baixos
+}
+
+static bool iguais_escalar(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    return std::memcmp(a, b, bytes) == 0;
+}
+
+// Aritmética em uint32_t: o estouro do int do Java vira módulo 2^32, sem comportamento indefinido
+template <typename T>
+static int32_t hash_escalar(const T* v, size_t n, int32_t h) {
+    uint32_t r = (uint32_t)h;
+    for (size_t i = 0; i < n; i++) r = 31 * r + (uint32_t)(int32_t)v[i];
+    return (int32_t)r;
+}
+
+static bool algum_acima_escalar(const uint32_t* v, size_t n, uint32_t limite) {
+    for (size_t i = 0; i < n; i++) {
+        if (v[i] >= limite) return true;
+    }
+    return false;
+}
+
+template <typename T>
+static size_t indice_escalar(const T* v, size_t n, T c) {
+    for (size_t i = 0; i < n; i++) {
+        if (v[i] == c) return i;
+    }
+    return n;
+}
+
+static size_t primeira_diferenca_escalar(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        if (a[i] != b[i]) return i;
+    }
+    return bytes;
+}
+
+// 31^e (mod 2^32) por quadrados sucessivos: O(log e) multiplicações
+static uint32_t potencia_31(size_t e) {
+    uint32_t p = 1;
+    uint32_t base = 31;
+    for (; e != 0; e >>= 1) {
+        if (e & 1) p *= base;
+        base *= base;
+    }
+    return p;
+}
+
+/**
+ * @brief Fecha um hash vetorial de 'lanes' faixas: cada faixa i acumulou
+ * acc_i = acc_i * 31^lanes + e, então o bloco inteiro vale
+ * h * 31^(lanes * blocos) + soma(acc_i * 31^(lanes - 1 - i)).
+ */
+static uint32_t fechar_hash(uint32_t h, size_t blocos, const uint32_t* acc, size_t lanes) {
+    uint32_t soma = 0;
+    for (size_t i = 0; i < lanes; i++) soma = 31 * soma + acc[i]; // Horner: acc_i * 31^(lanes - 1 - i)
+    return h * potencia_31(lanes * blocos) + soma;
+}
+
+#if SIMD_X86
+
+// =======================================================================
+// 2. SSE2 (base de todo x86-64)
+// =======================================================================
+
+static void preencher_sse2(uint8_t* dst, size_t n, size_t largura, uint64_t valor) {
+    const size_t bytes = n * largura;
+    const __m128i padrao = _mm_set1_epi64x((long long)replicar(largura, valor));
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), padrao);
+    preencher_escalar(dst + i, (bytes - i) / largura, largura, valor);
+}
+
+static bool iguais_sse2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
+    }
+    return iguais_escalar(a + i, b + i, bytes - i);
+}
+
+// SSE2 não tem multiplicação de 32 bits por faixa: pares e ímpares por _mm_mul_epu32
+static inline __m128i mul32_sse2(__m128i a, __m128i b) {
+    __m128i pares = _mm_mul_epu32(a, b);
+    __m128i impares = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(pares, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(impares, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// 4 elementos estendidos para int32 (com sinal, exceto char e Latin-1)
+static inline __m128i carregar4_sse2(const int32_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+static inline __m128i carregar4_sse2(const int16_t* p) {
+    __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+}
+static inline __m128i carregar4_sse2(const uint16_t* p) {
+    __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_unpacklo_epi16(x, _mm_setzero_si128());
+}
+static inline __m128i carregar4_sse2(const int8_t* p) {
+    int32_t quatro;
+    std::memcpy(&quatro, p, 4);
+    __m128i x = _mm_cvtsi32_si128(quatro);
+    x = _mm_unpacklo_epi8(x, x);
+    return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 24);
+}
+static inline __m128i carregar4_sse2(const uint8_t* p) {
+    int32_t quatro;
+    std::memcpy(&quatro, p, 4);
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(quatro), zero), zero);
+}
+
+// Quatro acumuladores independentes (16 faixas): a latência da multiplicação não serializa o laço
+template <typename T>
+static int32_t hash_sse2(const T* v, size_t n, int32_t h) {
+    const size_t blocos = n / 16;
+    const __m128i fator = _mm_set1_epi32((int)potencia_31(16));
+    __m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (size_t b = 0; b < blocos; b++) {
+        const T* p = v + 16 * b;
+        acc0 = _mm_add_epi32(mul32_sse2(acc0, fator), carregar4_sse2(p));
+        acc1 = _mm_add_epi32(mul32_sse2(acc1, fator), carregar4_sse2(p + 4));
+        acc2 = _mm_add_epi32(mul32_sse2(acc2, fator), carregar4_sse2(p + 8));
+        acc3 = _mm_add_epi32(mul32_sse2(acc3, fator), carregar4_sse2(p + 12));
+    }
+
+    uint32_t faixas[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(faixas), acc0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(faixas + 4), acc1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(faixas + 8), acc2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(faixas + 12), acc3);
+    uint32_t r = fechar_hash((uint32_t)h, blocos, faixas, 16);
+    return hash_escalar(v + 16 * blocos, n - 16 * blocos, (int32_t)r);
+}
+
+// Sem comparação sem sinal no SSE2: desloca os dois lados para a faixa com sinal
+static bool algum_acima_sse2(const uint32_t* v, size_t n, uint32_t limite) {
+    const __m128i sinal = _mm_set1_epi32((int)0x80000000u);
+    const __m128i abaixo = _mm_xor_si128(_mm_set1_epi32((int)(limite - 1)), sinal);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), sinal);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi32(x, abaixo)) != 0) return true;
+    }
+    return algum_acima_escalar(v + i, n - i, limite);
+}
+
+static size_t indice_sse2(const uint8_t* v, size_t n, uint8_t c) {
+    const __m128i alvo = _mm_set1_epi8((char)c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), alvo));
+        if (m != 0) return i + (size_t)__builtin_ctz((unsigned)m);
+    }
+    return i + indice_escalar(v + i, n - i, c);
+}
+
+// Cada char igual acende 2 bits da máscara de bytes
+static size_t indice_sse2(const uint16_t* v, size_t n, uint16_t c) {
+    const __m128i alvo = _mm_set1_epi16((short)c);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int m = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), alvo));
+        if (m != 0) return i + (size_t)__builtin_ctz((unsigned)m) / 2;
+    }
+    return i + indice_escalar(v + i, n - i, c);
+}
+
+static size_t primeira_diferenca_sse2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        unsigned iguais = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (iguais != 0xFFFF) return i + (size_t)__builtin_ctz(~iguais);
+    }
+    return i + primeira_diferenca_escalar(a + i, b + i, bytes - i);
+}
+
+// =======================================================================
+// 3. AVX2
+// =======================================================================
+
+ALVO_AVX2 static void preencher_avx2(uint8_t* dst, size_t n, size_t largura, uint64_t valor) {
+    const size_t bytes = n * largura;
+    const __m256i padrao = _mm256_set1_epi64x((long long)replicar(largura, valor));
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), padrao);
+    preencher_escalar(dst + i, (bytes - i) / largura, largura, valor);
+}
+
+ALVO_AVX2 static bool iguais_avx2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFFu) return false;
+    }
+    return iguais_sse2(a + i, b + i, bytes - i);
+}
+
+// 8 elementos estendidos para int32 (com sinal, exceto char e Latin-1)
+ALVO_AVX2 static inline __m256i carregar8_avx2(const int32_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+ALVO_AVX2 static inline __m256i carregar8_avx2(const int16_t* p) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+ALVO_AVX2 static inline __m256i carregar8_avx2(const uint16_t* p) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+ALVO_AVX2 static inline __m256i carregar8_avx2(const int8_t* p) {
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+ALVO_AVX2 static inline __m256i carregar8_avx2(const uint8_t* p) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+// Quatro acumuladores independentes (32 faixas), como em hash_sse2
+template <typename T>
+ALVO_AVX2 static int32_t hash_avx2(const T* v, size_t n, int32_t h) {
+    const size_t blocos = n / 32;
+    const __m256i fator = _mm256_set1_epi32((int)potencia_31(32));
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (size_t b = 0; b < blocos; b++) {
+        const T* p = v + 32 * b;
+        acc0 = _mm256_add_epi32(_mm256_mullo_epi32(acc0, fator), carregar8_avx2(p));
+        acc1 = _mm256_add_epi32(_mm256_mullo_epi32(acc1, fator), carregar8_avx2(p + 8));
+        acc2 = _mm256_add_epi32(_mm256_mullo_epi32(acc2, fator), carregar8_avx2(p + 16));
+        acc3 = _mm256_add_epi32(_mm256_mullo_epi32(acc3, fator), carregar8_avx2(p + 24));
+    }
+
+    uint32_t faixas[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(faixas), acc0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(faixas + 8), acc1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(faixas + 16), acc2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(faixas + 24), acc3);
+    uint32_t r = fechar_hash((uint32_t)h, blocos, faixas, 32);
+    return hash_sse2(v + 32 * blocos, n - 32 * blocos, (int32_t)r);
+}
+
+// v >= limite  <=>  max(v, limite) == v (comparação sem sinal do AVX2)
+ALVO_AVX2 static bool algum_acima_avx2(const uint32_t* v, size_t n, uint32_t limite) {
+    const __m256i lim = _mm256_set1_epi32((int)limite);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(x, lim), x)) != 0) return true;
+    }
+    return algum_acima_escalar(v + i, n - i, limite);
+}
+
+ALVO_AVX2 static size_t indice_avx2(const uint8_t* v, size_t n, uint8_t c) {
+    const __m256i alvo = _mm256_set1_epi8((char)c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), alvo));
+        if (m != 0) return i + (size_t)__builtin_ctz(m);
+    }
+    return i + indice_sse2(v + i, n - i, c);
+}
+
+ALVO_AVX2 static size_t indice_avx2(const uint16_t* v, size_t n, uint16_t c) {
+    const __m256i alvo = _mm256_set1_epi16((short)c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), alvo));
+        if (m != 0) return i + (size_t)__builtin_ctz(m) / 2;
+    }
+    return i + indice_sse2(v + i, n - i, c);
+}
+
+ALVO_AVX2 static size_t primeira_diferenca_avx2(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        unsigned iguais = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (iguais != 0xFFFFFFFFu) return i + (size_t)__builtin_ctz(~iguais);
+    }
+    return i + primeira_diferenca_sse2(a + i, b + i, bytes - i);
+}
+
+#endif // SIMD_X86
+
+// =======================================================================
+// 4. DESPACHO
+// =======================================================================
+
+struct Kernels {
+    NivelSimd nivel;
+    void (*preencher)(uint8_t*, size_t, size_t, uint64_t);
+    bool (*iguais)(const uint8_t*, const uint8_t*, size_t);
+    int32_t (*hash_int)(const int32_t*, size_t, int32_t);
+    int32_t (*hash_short)(const int16_t*, size_t, int32_t);
+    int32_t (*hash_char)(const uint16_t*, size_t, int32_t);
+    int32_t (*hash_byte)(const int8_t*, size_t, int32_t);
+    int32_t (*hash_latin1)(const uint8_t*, size_t, int32_t);
+    bool (*algum_acima)(const uint32_t*, size_t, uint32_t);
+    size_t (*indice_byte)(const uint8_t*, size_t, uint8_t);
+    size_t (*indice_char)(const uint16_t*, size_t, uint16_t);
+    size_t (*primeira_diferenca)(const uint8_t*, const uint8_t*, size_t);
+};
+
+static NivelSimd detectar_nivel() {
+    NivelSimd nivel = SIMD_ESCALAR;
+#if SIMD_X86
+    __builtin_cpu_init();
+    nivel = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+#endif
+    // JVM_SIMD só rebaixa: pedir AVX2 numa CPU sem AVX2 não tem efeito
+    if (const char* pedido = std::getenv("JVM_SIMD")) {
+        const std::string p = pedido;
+        if (p == "escalar" && nivel > SIMD_ESCALAR) nivel = SIMD_ESCALAR;
+        else if (p == "sse2" && nivel > SIMD_SSE2) nivel = SIMD_SSE2;
+    }
+    return nivel;
+}
+
+static Kernels criar_kernels() {
+    Kernels k = {SIMD_ESCALAR, preencher_escalar, iguais_escalar, hash_escalar<int32_t>, hash_escalar<int16_t>,
+                 hash_escalar<uint16_t>, hash_escalar<int8_t>, hash_escalar<uint8_t>, algum_acima_escalar,
+                 indice_escalar<uint8_t>, indice_escalar<uint16_t>, primeira_diferenca_escalar};
+    const NivelSimd nivel = detectar_nivel();
+#if SIMD_X86
+    if (nivel == SIMD_SSE2) {
+        k = {SIMD_SSE2, preencher_sse2, iguais_sse2, hash_sse2<int32_t>, hash_sse2<int16_t>,
+             hash_sse2<uint16_t>, hash_sse2<int8_t>, hash_sse2<uint8_t>, algum_acima_sse2,
+             indice_sse2, indice_sse2, primeira_diferenca_sse2};
+    } else if (nivel == SIMD_AVX2) {
+        k = {SIMD_AVX2, preencher_avx2, iguais_avx2, hash_avx2<int32_t>, hash_avx2<int16_t>,
+             hash_avx2<uint16_t>, hash_avx2<int8_t>, hash_avx2<uint8_t>, algum_acima_avx2,
+             indice_avx2, indice_avx2, primeira_diferenca_avx2};
+    }
+#endif
+    TRACE(TRACE_HEAP, TRACE_INFO, "Kernels de array: {}", simd_nome_nivel(k.nivel));
+    return k;
+}
+
+// Escolhidos no primeiro uso (inicialização de static local: segura entre threads)
+static const Kernels& kernels() {
+    static const Kernels k = criar_kernels();
+    return k;
+}
+
+NivelSimd simd_nivel() {
+    return kernels().nivel;
+}
+
+const char* simd_nome_nivel(NivelSimd nivel) {
+    switch (nivel) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE2: return "sse2";
+        default:        return "escalar";
+    }
+}
+
+void simd_preencher(uint8_t* dst, size_t n, size_t largura, uint64_t valor) {
+    kernels().preencher(dst, n, largura, valor);
+}
+
+bool simd_iguais(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    return kernels().iguais(a, b, bytes);
+}
+
+int32_t simd_hash(const int32_t* v, size_t n, int32_t h) { return kernels().hash_int(v, n, h); }
+int32_t simd_hash(const int16_t* v, size_t n, int32_t h) { return kernels().hash_short(v, n, h); }
+int32_t simd_hash(const uint16_t* v, size_t n, int32_t h) { return kernels().hash_char(v, n, h); }
+int32_t simd_hash(const int8_t* v, size_t n, int32_t h) { return kernels().hash_byte(v, n, h); }
+int32_t simd_hash(const uint8_t* v, size_t n, int32_t h) { return kernels().hash_latin1(v, n, h); }
+
+bool simd_algum_acima(const uint32_t* v, size_t n, uint32_t limite) {
+    return kernels().algum_acima(v, n, limite);
+}
+
+size_t simd_indice(const uint8_t* v, size_t n, uint8_t c) { return kernels().indice_byte(v, n, c); }
+size_t simd_indice(const uint16_t* v, size_t n, uint16_t c) { return kernels().indice_char(v, n, c); }
+
+size_t simd_primeira_diferenca(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    return kernels().primeira_diferenca(a, b, bytes);
+}
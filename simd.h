@@ -0,0 +1,52 @@
+// simd.h
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// =======================================================================
+// KERNELS VETORIAIS SOBRE OS DADOS DE ARRAYS (AVX2, SSE2 OU ESCALAR)
+// =======================================================================
+
+/**
+ * Cada kernel tem versões AVX2, SSE2 e escalar. O nível é escolhido uma vez,
+ * no primeiro uso, pela CPU (JVM_SIMD=avx2|sse2|escalar força um nível mais
+ * baixo, para comparação). Os kernels recebem ponteiros já validados: testes de
+ * null e de limites ficam com quem chama, uma vez por chamada.
+ */
+
+enum NivelSimd {
+    SIMD_ESCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+};
+
+NivelSimd simd_nivel();
+const char* simd_nome_nivel(NivelSimd nivel);
+
+// Preenche 'n' elementos de 'largura' bytes (1, 2, 4 ou 8) com os bits de 'valor'
+void simd_preencher(uint8_t* dst, size_t n, size_t largura, uint64_t valor);
+
+// 'bytes' bytes iguais nos dois blocos
+bool simd_iguais(const uint8_t* a, const uint8_t* b, size_t bytes);
+
+// Arrays.hashCode sobre elementos inteiros: h = 31 * h + e, a partir de 'h'
+int32_t simd_hash(const int32_t* v, size_t n, int32_t h);
+int32_t simd_hash(const int16_t* v, size_t n, int32_t h);
+int32_t simd_hash(const uint16_t* v, size_t n, int32_t h);
+int32_t simd_hash(const int8_t* v, size_t n, int32_t h);
+int32_t simd_hash(const uint8_t* v, size_t n, int32_t h); // Latin-1: sem sinal
+
+// Primeira posição de 'c' em v[0, n) (n: não encontrado)
+size_t simd_indice(const uint8_t* v, size_t n, uint8_t c);
+size_t simd_indice(const uint16_t* v, size_t n, uint16_t c);
+
+// Primeiro byte diferente entre os dois blocos ('bytes': iguais)
+size_t simd_primeira_diferenca(const uint8_t* a, const uint8_t* b, size_t bytes);
+
+// Algum dos 'n' valores (sem sinal) é >= 'limite' (barreira de arraycopy: referências ao berçário)
+bool simd_algum_acima(const uint32_t* v, size_t n, uint32_t limite);
+
+#endif // SIMD_H
@@ -0,0 +1,224 @@
+// thread.cpp
+
+#include "thread.h"
+#include "trace.h"
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// =======================================================================
+// 1. THREAD CORRENTE
+// =======================================================================
+
+static thread_local JavaThread* thread_corrente = nullptr;
+
+JavaThread* thread_atual() {
+    return thread_corrente;
+}
+
+// =======================================================================
+// 2. TRATADOR DE SIGSEGV
+// =======================================================================
+
+static struct sigaction tratador_anterior;
+
+// Zona nula do heap (registrar_zona_nula)
+static uint8_t* zona_nula_inicio = nullptr;
+static uint8_t* zona_nula_fim = nullptr;
+
+// Falha que não é da JVM: devolve o sinal ao tratador anterior (ou ao padrão, que encerra o processo)
+static void repassar_sinal(int sig, siginfo_t* info, void* context) {
+    if (tratador_anterior.sa_flags & SA_SIGINFO) {
+        if (tratador_anterior.sa_sigaction) {
+            tratador_anterior.sa_sigaction(sig, info, context);
+            return;
+        }
+    } else if (tratador_anterior.sa_handler != SIG_DFL && tratador_anterior.sa_handler != SIG_IGN) {
+        tratador_anterior.sa_handler(sig);
+        return;
+    }
+    // Reexecuta a instrução com o tratamento padrão
+    signal(sig, SIG_DFL);
+}
+
+static void escrever_erro(const char* message) {
+    ssize_t ignored = write(STDERR_FILENO, message, std::strlen(message));
+    (void)ignored;
+}
+
+/**
+ * @brief Só chamadas assíncronas-seguras: mprotect, write e siglongjmp.
+ * Na zona amarela, desativa a zona (o StackOverflowError é entregue com ela
+ * liberada) e retoma a ativação do interpretador. Na zona nula, retoma a
+ * ativação para lançar o NullPointerException; na página de polling, para
+ * parar no safepoint.
+ */
+static void tratar_sigsegv(int sig, siginfo_t* info, void* context) {
+    JavaThread* thread = thread_corrente;
+    uint8_t* addr = static_cast<uint8_t*>(info->si_addr);
+
+    if (thread && addr >= thread->stack_limit && addr < thread->stack_end) {
+        if (addr < thread->red_zone && thread->yellow_armed && thread->recuperacao) {
+            mprotect(thread->stack_limit, (size_t)(thread->red_zone - thread->stack_limit), PROT_READ | PROT_WRITE);
+            thread->yellow_armed = false;
+            thread->stack_overflows++;
+            siglongjmp(*thread->recuperacao, RECUPERACAO_STACK_OVERFLOW);
+        }
+        escrever_erro("\nERRO FATAL: estouro da pilha Java na zona vermelha\n");
+    }
+    if (thread && thread->recuperacao && addr >= zona_nula_inicio && addr < zona_nula_fim) {
+        siglongjmp(*thread->recuperacao, RECUPERACAO_NULL_POINTER);
+    }
+    if (thread && thread->recuperacao && addr == thread->polling_page &&
+        (thread->safepoint_pedidos & SAFEPOINT_ARMADO)) {
+        siglongjmp(*thread->recuperacao, RECUPERACAO_SAFEPOINT);
+    }
+    repassar_sinal(sig, info, context);
+}
+
+static void instalar_tratador_sigsegv() {
+    static bool instalado = false;
+    if (instalado) return;
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = tratar_sigsegv;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGSEGV, &sa, &tratador_anterior) != 0) {
+        throw std::runtime_error("Falha ao instalar o tratador de SIGSEGV");
+    }
+    instalado = true;
+}
+
+// =======================================================================
+// 3. CRIAÇÃO DA PILHA
+// =======================================================================
+
+JavaThread* criar_java_thread(size_t stack_bytes) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t usable = (stack_bytes + page - 1) / page * page;
+    const size_t total = usable + (YELLOW_ZONE_PAGES + RED_ZONE_PAGES) * page;
+
+    void* region = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Falha ao mapear a pilha Java (" + std::to_string(total) + " bytes)");
+    }
+
+    static std::atomic<uint32_t> proximo_id(1);
+    JavaThread* thread = new JavaThread();
+    thread->id = proximo_id.fetch_add(1, std::memory_order_relaxed);
+    thread->stack_base = static_cast<uint8_t*>(region);
+    thread->stack_limit = thread->stack_base + usable;
+    thread->red_zone = thread->stack_limit + YELLOW_ZONE_PAGES * page;
+    thread->stack_end = thread->stack_base + total;
+    thread->recuperacao = nullptr;
+    thread->stack_overflows = 0;
+
+    void* polling = mmap(nullptr, page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (polling == MAP_FAILED) {
+        throw std::runtime_error("Falha ao mapear a pagina de polling de safepoint");
+    }
+    thread->polling_page = static_cast<uint8_t*>(polling);
+    thread->safepoint_pedidos = 0;
+    thread->safepoint_armado_ns = 0;
+    thread->safepoints = SafepointStats{0, 0, 0};
+
+    if (mprotect(thread->stack_limit, total - usable, PROT_NONE) != 0) {
+        throw std::runtime_error("Falha ao proteger as paginas de guarda da pilha Java");
+    }
+    thread->yellow_armed = true;
+
+    instalar_tratador_sigsegv();
+    thread_corrente = thread;
+    return thread;
+}
+
+void rearmar_zona_amarela(JavaThread* thread) {
+    if (thread->yellow_armed) return;
+    mprotect(thread->stack_limit, (size_t)(thread->red_zone - thread->stack_limit), PROT_NONE);
+    thread->yellow_armed = true;
+}
+
+void registrar_zona_nula(uint8_t* inicio, size_t tamanho) {
+    zona_nula_inicio = inicio;
+    zona_nula_fim = inicio + tamanho;
+    instalar_tratador_sigsegv();
+}
+
+// =======================================================================
+// 4. SAFEPOINTS
+// =======================================================================
+
+static uint64_t agora_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#define SAFEPOINT_BITS 8
+static OperacaoSafepoint operacoes_safepoint[SAFEPOINT_BITS]; // Indexadas pela posição do bit SAFEPOINT_*
+
+void registrar_operacao_safepoint(int bit, OperacaoSafepoint operacao) {
+    operacoes_safepoint[__builtin_ctz((unsigned)bit)] = operacao;
+}
+
+void armar_safepoint(JavaThread* thread, int operacoes) {
+    // Só quem acende SAFEPOINT_ARMADO protege a página; os demais apenas somam seus bits
+    const int antes = __atomic_fetch_or(&thread->safepoint_pedidos, operacoes | SAFEPOINT_ARMADO, __ATOMIC_ACQ_REL);
+    if (antes & SAFEPOINT_ARMADO) return;
+    thread->safepoint_armado_ns = agora_ns();
+    mprotect(thread->polling_page, (size_t)sysconf(_SC_PAGESIZE), PROT_NONE);
+}
+
+void parar_no_safepoint(JavaThread* thread) {
+    const uint64_t tts = agora_ns() - thread->safepoint_armado_ns;
+
+    // Desprotege antes de recolher os pedidos: um pedido depois da troca volta a
+    // proteger a página e fica para o próximo poll; um antes dela é executado agora
+    mprotect(thread->polling_page, (size_t)sysconf(_SC_PAGESIZE), PROT_READ);
+    const int pedidos = __atomic_exchange_n(&thread->safepoint_pedidos, 0, __ATOMIC_ACQ_REL);
+
+    SafepointStats& stats = thread->safepoints;
+    stats.count++;
+    stats.total_ns += tts;
+    if (tts > stats.max_ns) stats.max_ns = tts;
+    TRACE(TRACE_SAFEPOINT, TRACE_INFO, "Thread parada (TTS: {} ns)", tts);
+
+    for (int i = 0; i < SAFEPOINT_BITS; i++) {
+        if ((pedidos & (1 << i)) && operacoes_safepoint[i]) operacoes_safepoint[i](thread);
+    }
+}
+
+static JavaThread* thread_periodica = nullptr;
+
+static void tratar_sigalrm(int) {
+    if (thread_periodica) armar_safepoint(thread_periodica, 0);
+}
+
+void iniciar_safepoints_periodicos(JavaThread* thread, unsigned intervalo_ms) {
+    struct itimerval timer;
+    std::memset(&timer, 0, sizeof(timer));
+    timer.it_interval.tv_sec = intervalo_ms / 1000;
+    timer.it_interval.tv_usec = (intervalo_ms % 1000) * 1000;
+    timer.it_value = timer.it_interval;
+
+    if (intervalo_ms != 0) {
+        thread_periodica = thread;
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = tratar_sigalrm;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGALRM, &sa, nullptr);
+    }
+    setitimer(ITIMER_REAL, &timer, nullptr);
+    if (intervalo_ms == 0) thread_periodica = nullptr;
+}
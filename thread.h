@@ -0,0 +1,119 @@
+// thread.h
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <csetjmp>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+// =======================================================================
+// THREADS JAVA: PILHA COM PÁGINAS DE GUARDA E TRATAMENTO DE SIGSEGV
+// =======================================================================
+
+// Zonas de guarda acima da pilha Java (ela cresce para endereços maiores)
+#define YELLOW_ZONE_PAGES 2 // Estouro recuperável: vira StackOverflowError
+#define RED_ZONE_PAGES    1 // Estouro com a zona amarela desativada: erro fatal
+
+// Valores de retorno de sigsetjmp na ativação do interpretador
+#define RECUPERACAO_STACK_OVERFLOW 1 // Falha na zona amarela
+#define RECUPERACAO_NULL_POINTER   2 // Falha na zona nula do heap (acesso pela referência 0)
+#define RECUPERACAO_SAFEPOINT      3 // Falha na página de polling armada
+
+struct JavaThread;
+
+// Operação da VM executada com a thread parada num safepoint
+typedef void (*OperacaoSafepoint)(JavaThread* thread);
+
+// Operações que um safepoint pode executar: bits de JavaThread::safepoint_pedidos
+#define SAFEPOINT_COLETA  0x01 // Coleta de lixo pedida pelo caminho de alocação
+#define SAFEPOINT_DESPEJO 0x02 // Relatórios do perfil de heap pedidos por SIGQUIT
+#define SAFEPOINT_ARMADO  0x80 // Página de polling protegida (uso interno)
+
+// Métrica de time-to-safepoint: do armar da página até a thread parar num poll
+struct SafepointStats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+/**
+ * @brief Estado de uma thread Java. A região da pilha é mapeada com mmap:
+ *
+ *   [stack_base, stack_limit)  frames (leitura e escrita)
+ *   [stack_limit, red_zone)    zona amarela (PROT_NONE enquanto armada)
+ *   [red_zone, stack_end)      zona vermelha (sempre PROT_NONE)
+ *
+ * Empilhar um frame não compara com o limite: o primeiro acesso a um slot
+ * na zona amarela gera SIGSEGV, e o tratador retoma a ativação corrente do
+ * interpretador (via 'recuperacao') para lançar o StackOverflowError.
+ */
+struct JavaThread {
+    uint32_t id;             // Identificador (> 0) gravado nos thin locks que a thread possui
+    uint8_t* stack_base;
+    uint8_t* stack_limit;
+    uint8_t* red_zone;
+    uint8_t* stack_end;
+    bool yellow_armed;
+
+    // Ponto de retomada da ativação corrente de run_frame (nullptr fora do interpretador)
+    sigjmp_buf* recuperacao;
+    size_t stack_overflows;  // Estouros entregues como StackOverflowError
+
+    // Safepoints: a página é legível; armar = PROT_NONE, e o próximo poll falha
+    uint8_t* polling_page;
+    volatile sig_atomic_t safepoint_pedidos; // Bits SAFEPOINT_*, alterados só com operações atômicas
+    uint64_t safepoint_armado_ns;
+    SafepointStats safepoints;
+};
+
+/**
+ * @brief Poll de safepoint (retornos e desvios para trás): uma única leitura
+ * da página de polling. Sem safepoint pendente, nada acontece; armado, gera
+ * SIGSEGV e a ativação retoma com RECUPERACAO_SAFEPOINT.
+ */
+inline void poll_safepoint(const volatile uint8_t* polling_page) {
+    (void)*polling_page;
+}
+
+/**
+ * @brief Cria a thread Java corrente com uma pilha de pelo menos 'stack_bytes'
+ * utilizáveis (arredondado para páginas) e instala o tratador de SIGSEGV.
+ */
+JavaThread* criar_java_thread(size_t stack_bytes);
+
+// Thread Java em execução na thread nativa corrente (nullptr antes de criar_java_thread)
+JavaThread* thread_atual();
+
+// Volta a proteger a zona amarela depois de entregue o StackOverflowError
+void rearmar_zona_amarela(JavaThread* thread);
+
+/**
+ * @brief Registra a faixa sem permissões no início do heap. Uma falha nela,
+ * durante o interpretador, retoma a ativação corrente com
+ * RECUPERACAO_NULL_POINTER (verificação de null implícita).
+ */
+void registrar_zona_nula(uint8_t* inicio, size_t tamanho);
+
+// Associa a operação ao seu bit SAFEPOINT_* (na inicialização, antes de qualquer pedido)
+void registrar_operacao_safepoint(int bit, OperacaoSafepoint operacao);
+
+/**
+ * @brief Pede que a thread pare no próximo poll e execute as operações dos
+ * bits em 'operacoes' (0: só parar). Assíncrona-segura: pode ser chamada de um
+ * tratador de sinal ou de outra thread. Pedidos com o safepoint já armado
+ * acumulam-se no mesmo safepoint; nenhum é perdido.
+ */
+void armar_safepoint(JavaThread* thread, int operacoes);
+
+// Chamada pelo interpretador ao retomar de um poll: desarma, mede o TTS e executa as operações pedidas
+void parar_no_safepoint(JavaThread* thread);
+
+/**
+ * @brief Arma um safepoint a cada 'intervalo_ms' (SIGALRM), para amostragem e
+ * operações periódicas da VM. 0 desliga.
+ */
+void iniciar_safepoints_periodicos(JavaThread* thread, unsigned intervalo_ms);
+
+#endif // THREAD_H
@@ -0,0 +1,125 @@
+// trace.cpp
+
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+// =======================================================================
+// 1. CATEGORIAS
+// =======================================================================
+
+const char* trace_nome_categoria(uint8_t categoria) {
+    static const char* const nomes[TRACE_CATEGORIAS] = {
+        "DISPATCH", "STACK", "HEAP", "LOADER", "LINK", "UNWIND", "INIT", "GUARD", "SAFEPOINT", "MONITOR", "GC",
+    };
+    return categoria < TRACE_CATEGORIAS ? nomes[categoria] : "?";
+}
+
+uint64_t trace_agora_ns() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+// =======================================================================
+// 2. ANÉIS POR THREAD
+// =======================================================================
+
+// Anéis de todas as threads (o lock protege só a lista: registrar não o usa)
+static std::mutex buffers_lock;
+static std::vector<TraceBuffer*> buffers;
+static thread_local TraceBuffer* buffer_corrente = nullptr;
+
+static void descarregar_no_atexit() {
+    const char* caminho = std::getenv("JVM_TRACE_FILE");
+    trace_descarregar(caminho ? caminho : "jvm.trace");
+}
+
+TraceBuffer& trace_buffer_atual() {
+    if (!buffer_corrente) {
+        TraceBuffer* b = new TraceBuffer();
+        b->escritos.store(0, std::memory_order_relaxed);
+        b->registros = new TraceRecord[TRACE_RING_SIZE];
+
+        std::lock_guard<std::mutex> lock(buffers_lock);
+        if (buffers.empty()) std::atexit(descarregar_no_atexit);
+        b->thread = (uint32_t)buffers.size() + 1;
+        buffers.push_back(b);
+        buffer_corrente = b;
+    }
+    return *buffer_corrente;
+}
+
+// =======================================================================
+// 3. ARQUIVO
+// =======================================================================
+
+static void escrever_u32(FILE* f, uint32_t v) { std::fwrite(&v, sizeof(v), 1, f); }
+static void escrever_u64(FILE* f, uint64_t v) { std::fwrite(&v, sizeof(v), 1, f); }
+
+static void escrever_string(FILE* f, const char* s, size_t n) {
+    escrever_u32(f, (uint32_t)n);
+    std::fwrite(s, 1, n, f);
+}
+
+/**
+ * Layout (inteiros no formato nativo):
+ *   magic[8] versao:u32
+ *   n_formatos:u32 { len:u32 bytes }...
+ *   n_threads:u32 { thread:u32 escritos:u64 n_strings:u32 { len:u32 bytes }...
+ *                   n_registros:u32 TraceRecordArquivo... }...
+ * Os registros de cada thread vão do mais antigo ainda no anel ao mais recente.
+ */
+void trace_descarregar(const char* caminho) {
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    if (buffers.empty()) return;
+
+    FILE* f = std::fopen(caminho, "wb");
+    if (!f) return;
+
+    // Janela de cada anel, lida uma vez: a tabela de formatos cobre exatamente o que é escrito
+    std::vector<uint64_t> fim(buffers.size()), inicio(buffers.size());
+    std::map<const char*, uint32_t> formatos;
+    std::vector<const char*> ordem;
+    for (size_t t = 0; t < buffers.size(); t++) {
+        fim[t] = buffers[t]->escritos.load(std::memory_order_acquire);
+        inicio[t] = fim[t] > TRACE_RING_SIZE ? fim[t] - TRACE_RING_SIZE : 0;
+        for (uint64_t i = inicio[t]; i < fim[t]; i++) {
+            const char* formato = buffers[t]->registros[i & (TRACE_RING_SIZE - 1)].formato;
+            if (formatos.emplace(formato, (uint32_t)ordem.size()).second) ordem.push_back(formato);
+        }
+    }
+
+    std::fwrite(TRACE_ARQUIVO_MAGIC, 1, 8, f);
+    escrever_u32(f, TRACE_ARQUIVO_VERSAO);
+    escrever_u32(f, (uint32_t)ordem.size());
+    for (const char* formato : ordem) escrever_string(f, formato, std::strlen(formato));
+
+    escrever_u32(f, (uint32_t)buffers.size());
+    for (size_t t = 0; t < buffers.size(); t++) {
+        const TraceBuffer& b = *buffers[t];
+        escrever_u32(f, b.thread);
+        escrever_u64(f, fim[t]);
+        escrever_u32(f, (uint32_t)b.strings.size());
+        for (const std::string& s : b.strings) escrever_string(f, s.data(), s.size());
+
+        escrever_u32(f, (uint32_t)(fim[t] - inicio[t]));
+        for (uint64_t i = inicio[t]; i < fim[t]; i++) {
+            const TraceRecord& r = b.registros[i & (TRACE_RING_SIZE - 1)];
+            TraceRecordArquivo a;
+            std::memset(&a, 0, sizeof(a));
+            a.tempo_ns = r.tempo_ns;
+            a.formato = formatos[r.formato];
+            a.categoria = r.categoria;
+            a.nivel = r.nivel;
+            a.args = r.args;
+            a.slots = r.slots;
+            a.tipos = r.tipos;
+            std::memcpy(a.valores, r.valores, r.slots * sizeof(uint32_t));
+            std::fwrite(&a, sizeof(a), 1, f);
+        }
+    }
+    std::fclose(f);
+}
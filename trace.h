@@ -0,0 +1,222 @@
+// trace.h
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// =======================================================================
+// TRACING ESTRUTURADO: CATEGORIAS COMPILADAS, REGISTROS BINÁRIOS EM ANEL
+// =======================================================================
+
+enum TraceCategoria : uint8_t {
+    TRACE_DISPATCH,   // Uma entrada por instrução executada
+    TRACE_STACK,      // Criação de frames
+    TRACE_HEAP,       // Alocações
+    TRACE_LOADER,     // Leitura e carregamento de classes
+    TRACE_LINK,       // Ligação: CHA, invokedynamic, switches, despacho virtual
+    TRACE_UNWIND,     // Desenrolar de exceções
+    TRACE_INIT,       // <clinit>
+    TRACE_GUARD,      // Zonas protegidas (estouro de pilha, null implícito)
+    TRACE_SAFEPOINT,
+    TRACE_MONITOR,
+    TRACE_GC,         // Coletas (pausas, bytes liberados)
+    TRACE_CATEGORIAS
+};
+
+enum TraceNivel : uint8_t {
+    TRACE_INFO = 1,   // Eventos raros (ligação, exceções, inflação de locks)
+    TRACE_DEBUG = 2,  // Eventos por chamada (frames, alocações)
+    TRACE_FINE = 3    // Eventos por instrução
+};
+
+/**
+ * Flags de compilação (ex.: make TRACE=0x7FF TRACE_NIVEL=2):
+ *   JVM_TRACE_CATEGORIAS  máscara de bits (1 << TraceCategoria) das categorias compiladas
+ *   JVM_TRACE_NIVEL       nível máximo compilado
+ * Sem categorias, toda chamada TRACE vira código morto: nem os argumentos são avaliados.
+ */
+#ifndef JVM_TRACE_CATEGORIAS
+#define JVM_TRACE_CATEGORIAS 0
+#endif
+#ifndef JVM_TRACE_NIVEL
+#define JVM_TRACE_NIVEL TRACE_FINE
+#endif
+
+// Registros por thread no anel (potência de 2): os mais antigos são sobrescritos
+#define TRACE_RING_SIZE  (1u << 16)
+#define TRACE_MAX_SLOTS  6
+
+// Nome exibido pelo decodificador
+const char* trace_nome_categoria(uint8_t categoria);
+
+// Tipo de cada argumento (3 bits por argumento em TraceRecord::tipos)
+enum TraceTipo : uint8_t {
+    TRACE_T_I32 = 1,
+    TRACE_T_U32 = 2,
+    TRACE_T_I64 = 3,  // 2 slots
+    TRACE_T_U64 = 4,  // 2 slots
+    TRACE_T_F32 = 5,
+    TRACE_T_F64 = 6,  // 2 slots
+    TRACE_T_STR = 7   // Id da string internada no anel da thread
+};
+
+/**
+ * @brief Registro binário de tamanho fixo (48 bytes). O formato é o literal
+ * passado a TRACE (endereço estável durante a execução), com um "{}" por
+ * argumento; "{x}" exibe inteiros em hexadecimal e "{4}" define largura mínima.
+ * Os argumentos são palavras de 32 bits cujo tipo vem do tipo C++ do argumento.
+ */
+struct TraceRecord {
+    uint64_t tempo_ns;
+    const char* formato;
+    uint8_t categoria;
+    uint8_t nivel;
+    uint8_t args;
+    uint8_t slots;
+    uint32_t tipos;
+    uint32_t valores[TRACE_MAX_SLOTS];
+};
+
+// Anel de uma thread: produtor único, sem locks; 'escritos' é publicado com release
+struct TraceBuffer {
+    uint32_t thread;
+    std::atomic<uint64_t> escritos;
+    TraceRecord* registros;
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, uint32_t> string_ids;
+
+    uint32_t internar(const std::string& s) {
+        auto it = string_ids.find(s);
+        if (it != string_ids.end()) return it->second;
+        uint32_t id = (uint32_t)strings.size();
+        strings.push_back(s);
+        string_ids.emplace(s, id);
+        return id;
+    }
+};
+
+// Anel da thread corrente (criado no primeiro registro; a descarga no arquivo é registrada no atexit)
+TraceBuffer& trace_buffer_atual();
+
+uint64_t trace_agora_ns();
+
+/**
+ * @brief Grava o conteúdo dos anéis em 'caminho' (JVM_TRACE_FILE ou "jvm.trace"
+ * no atexit). O arquivo é autocontido: tabela de formatos, strings e registros.
+ */
+void trace_descarregar(const char* caminho);
+
+// --- Codificação dos argumentos por tipo ---
+
+namespace trace_detalhe {
+
+struct Codificador {
+    TraceBuffer& buffer;
+    uint32_t valores[TRACE_MAX_SLOTS];
+    uint8_t args;
+    uint8_t slots;
+    uint32_t tipos;
+
+    explicit Codificador(TraceBuffer& b) : buffer(b), args(0), slots(0), tipos(0) {}
+
+    // Argumentos além da capacidade do registro são descartados (o decodificador mostra '?')
+    void arg(TraceTipo tipo, uint32_t lo, uint32_t hi, bool duplo) {
+        if (args >= 10 || slots + (duplo ? 2 : 1) > TRACE_MAX_SLOTS) return;
+        tipos |= (uint32_t)tipo << (3 * args++);
+        valores[slots++] = lo;
+        if (duplo) valores[slots++] = hi;
+    }
+};
+
+inline void codificar(Codificador& c, int32_t v)  { c.arg(TRACE_T_I32, (uint32_t)v, 0, false); }
+inline void codificar(Codificador& c, uint32_t v) { c.arg(TRACE_T_U32, v, 0, false); }
+inline void codificar(Codificador& c, int64_t v)  { c.arg(TRACE_T_I64, (uint32_t)v, (uint32_t)((uint64_t)v >> 32), true); }
+inline void codificar(Codificador& c, uint64_t v) { c.arg(TRACE_T_U64, (uint32_t)v, (uint32_t)(v >> 32), true); }
+inline void codificar(Codificador& c, const void* p) { codificar(c, (uint64_t)(uintptr_t)p); }
+inline void codificar(Codificador& c, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, 4);
+    c.arg(TRACE_T_F32, bits, 0, false);
+}
+inline void codificar(Codificador& c, double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    c.arg(TRACE_T_F64, (uint32_t)bits, (uint32_t)(bits >> 32), true);
+}
+inline void codificar(Codificador& c, const std::string& s) { c.arg(TRACE_T_STR, c.buffer.internar(s), 0, false); }
+inline void codificar(Codificador& c, const char* s) { c.arg(TRACE_T_STR, c.buffer.internar(s), 0, false); }
+
+inline void codificar_todos(Codificador&) {}
+
+template <typename T, typename... Resto>
+inline void codificar_todos(Codificador& c, const T& v, const Resto&... resto) {
+    codificar(c, v);
+    codificar_todos(c, resto...);
+}
+
+} // namespace trace_detalhe
+
+// --- Conjuntos de handlers: a especialização decide, em compilação, se a categoria existe ---
+
+template <TraceCategoria C, TraceNivel N,
+          bool Ativo = ((JVM_TRACE_CATEGORIAS >> C) & 1) != 0 && N <= JVM_TRACE_NIVEL>
+struct TraceHandler {
+    static constexpr bool ativo = false;
+    template <typename... Args>
+    static void registrar(const char*, const Args&...) {}
+};
+
+template <TraceCategoria C, TraceNivel N>
+struct TraceHandler<C, N, true> {
+    static constexpr bool ativo = true;
+
+    template <typename... Args>
+    static void registrar(const char* formato, const Args&... args) {
+        TraceBuffer& b = trace_buffer_atual();
+        trace_detalhe::Codificador c(b);
+        trace_detalhe::codificar_todos(c, args...);
+
+        const uint64_t i = b.escritos.load(std::memory_order_relaxed);
+        TraceRecord& r = b.registros[i & (TRACE_RING_SIZE - 1)];
+        r.tempo_ns = trace_agora_ns();
+        r.formato = formato;
+        r.categoria = C;
+        r.nivel = N;
+        r.args = c.args;
+        r.slots = c.slots;
+        r.tipos = c.tipos;
+        std::memcpy(r.valores, c.valores, c.slots * sizeof(uint32_t));
+        b.escritos.store(i + 1, std::memory_order_release);
+    }
+};
+
+// Ponto de tracing: 'if' constante (argumentos não avaliados quando a categoria não foi compilada)
+#define TRACE(categoria, nivel, ...) \
+    do { \
+        if (TraceHandler<categoria, nivel>::ativo) TraceHandler<categoria, nivel>::registrar(__VA_ARGS__); \
+    } while (0)
+
+// --- Arquivo de trace (escrito por trace_descarregar, lido pelo tracedump) ---
+
+#define TRACE_ARQUIVO_MAGIC "JVMTRACE"
+#define TRACE_ARQUIVO_VERSAO 1
+
+// Registro no arquivo: o formato vira índice na tabela de formatos
+struct TraceRecordArquivo {
+    uint64_t tempo_ns;
+    uint32_t formato;
+    uint8_t categoria;
+    uint8_t nivel;
+    uint8_t args;
+    uint8_t slots;
+    uint32_t tipos;
+    uint32_t valores[TRACE_MAX_SLOTS];
+};
+
+#endif // TRACE_H
@@ -0,0 +1,146 @@
+// tracedump.cpp
+//
+// Decodificador offline dos arquivos de trace da JVM (trace.h): converte os
+// registros binários na forma legível, uma linha por registro.
+//
+// Uso: tracedump [arquivo.trace]   (padrão: jvm.trace)
+
+#include "trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// =======================================================================
+// 1. LEITURA
+// =======================================================================
+
+struct Leitor {
+    FILE* f;
+
+    void ler(void* out, size_t n) {
+        if (std::fread(out, 1, n, f) != n) throw std::runtime_error("arquivo de trace truncado");
+    }
+    uint32_t u32() { uint32_t v; ler(&v, sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v; ler(&v, sizeof(v)); return v; }
+    std::string str() {
+        std::string s(u32(), '\0');
+        if (!s.empty()) ler(&s[0], s.size());
+        return s;
+    }
+};
+
+// =======================================================================
+// 2. FORMATAÇÃO
+// =======================================================================
+
+// Texto de um argumento; 'spec' é o conteúdo das chaves ("", "x" ou uma largura)
+static std::string formatar_arg(const TraceRecordArquivo& r, uint32_t arg, size_t& slot, const std::string& spec,
+                                const std::vector<std::string>& strings) {
+    const uint8_t tipo = (uint8_t)((r.tipos >> (3 * arg)) & 7);
+    const bool duplo = tipo == TRACE_T_I64 || tipo == TRACE_T_U64 || tipo == TRACE_T_F64;
+    if (arg >= r.args || slot + (duplo ? 2 : 1) > r.slots) return "?";
+
+    const uint32_t lo = r.valores[slot++];
+    const uint32_t hi = duplo ? r.valores[slot++] : 0;
+    const uint64_t v64 = ((uint64_t)hi << 32) | lo;
+    const bool hex = spec == "x";
+    const int largura = (!spec.empty() && !hex) ? std::atoi(spec.c_str()) : 0;
+
+    char buffer[64];
+    switch (tipo) {
+        case TRACE_T_I32: std::snprintf(buffer, sizeof(buffer), hex ? "%*x" : "%*d", largura, (int32_t)lo); break;
+        case TRACE_T_U32: std::snprintf(buffer, sizeof(buffer), hex ? "%*x" : "%*u", largura, lo); break;
+        case TRACE_T_I64: std::snprintf(buffer, sizeof(buffer), hex ? "%*llx" : "%*lld", largura, (long long)(int64_t)v64); break;
+        case TRACE_T_U64: std::snprintf(buffer, sizeof(buffer), hex ? "%*llx" : "%*llu", largura, (unsigned long long)v64); break;
+        case TRACE_T_F32: {
+            float f;
+            std::memcpy(&f, &lo, 4);
+            std::snprintf(buffer, sizeof(buffer), "%*g", largura, (double)f);
+            break;
+        }
+        case TRACE_T_F64: {
+            double d;
+            std::memcpy(&d, &v64, 8);
+            std::snprintf(buffer, sizeof(buffer), "%*g", largura, d);
+            break;
+        }
+        case TRACE_T_STR:
+            return lo < strings.size() ? strings[lo] : "?";
+        default:
+            return "?";
+    }
+    return buffer;
+}
+
+// Substitui cada "{...}" do formato pelo próximo argumento do registro
+static std::string formatar(const std::string& formato, const TraceRecordArquivo& r,
+                            const std::vector<std::string>& strings) {
+    std::string out;
+    uint32_t arg = 0;
+    size_t slot = 0;
+    for (size_t i = 0; i < formato.size(); i++) {
+        size_t fecha = formato[i] == '{' ? formato.find('}', i) : std::string::npos;
+        if (fecha == std::string::npos) {
+            out += formato[i];
+            continue;
+        }
+        out += formatar_arg(r, arg++, slot, formato.substr(i + 1, fecha - i - 1), strings);
+        i = fecha;
+    }
+    return out;
+}
+
+// =======================================================================
+// 3. PRINCIPAL
+// =======================================================================
+
+int main(int argc, char* argv[]) {
+    const char* caminho = argc > 1 ? argv[1] : "jvm.trace";
+    FILE* f = std::fopen(caminho, "rb");
+    if (!f) {
+        std::fprintf(stderr, "Nao foi possivel abrir %s\n", caminho);
+        return 1;
+    }
+
+    try {
+        Leitor in{f};
+        char magic[8];
+        in.ler(magic, 8);
+        if (std::memcmp(magic, TRACE_ARQUIVO_MAGIC, 8) != 0) throw std::runtime_error("nao e um arquivo de trace da JVM");
+        uint32_t versao = in.u32();
+        if (versao != TRACE_ARQUIVO_VERSAO) throw std::runtime_error("versao de trace nao suportada: " + std::to_string(versao));
+
+        std::vector<std::string> formatos(in.u32());
+        for (auto& s : formatos) s = in.str();
+
+        uint32_t threads = in.u32();
+        for (uint32_t t = 0; t < threads; t++) {
+            uint32_t thread = in.u32();
+            uint64_t escritos = in.u64();
+            std::vector<std::string> strings(in.u32());
+            for (auto& s : strings) s = in.str();
+
+            uint32_t count = in.u32();
+            std::printf("=== Thread %u: %u registros (%llu escritos, %llu descartados pelo anel) ===\n",
+                        thread, count, (unsigned long long)escritos, (unsigned long long)(escritos - count));
+
+            uint64_t inicio = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                TraceRecordArquivo r;
+                in.ler(&r, sizeof(r));
+                if (i == 0) inicio = r.tempo_ns;
+                const std::string& formato = r.formato < formatos.size() ? formatos[r.formato] : std::string("?");
+                std::printf("%12.3f us [%s] %s\n", (double)(r.tempo_ns - inicio) / 1000.0,
+                            trace_nome_categoria(r.categoria), formatar(formato, r, strings).c_str());
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "ERRO: %s\n", e.what());
+        std::fclose(f);
+        return 1;
+    }
+    std::fclose(f);
+    return 0;
+}